@@ -0,0 +1,2509 @@
+/**
+ * Benchmarks for the xyz library.
+ *
+ * Stand-alone executable that only needs the xyz code, no SDL or IMGUI, so it
+ * can be run on machines without a display.
+ *
+ * The ring buffer benchmarks run the writer and reader on separate threads,
+ * and the reader checks every value it receives, so a benchmark run is also
+ * a stress test of the cross-thread ordering.  The stress suite runs first,
+ * it pushes the original RBAM through tiny rings so the reader and writer
+ * meet at the full and empty boundaries on nearly every element, and an RBOW
+ * writer laps its readers, which must account for every element as read,
+ * lost or torn and never keep a torn copy.  RBVL records of mixed sizes are
+ * checked byte for byte, with pads at the wrap and again in a mirrored
+ * buffer, after checking which payload sizes are taken and which rejected.
+ * Before its spsc run, xyz::ring is checked on one thread for wraparound,
+ * element order and destructor counts.  The ingest suite runs producers that
+ * drop lines when the queue is full, the way the console does, and checks
+ * every line is either received in order or counted as a drop for its
+ * producer.
+ *
+ * The decimal suite checks xyz_d64 and xyz_d128 results against known
+ * answers, then times the arithmetic on money-like values against double, the
+ * cost of exact decimal results.  The utf8 suite first checks that the
+ * scalar, SSE2 and AVX2 code agree on invalid input (overlongs, surrogates,
+ * values above U+10FFFF, truncated sequences at a block end and at the end),
+ * then times UTF-8 validation and counting against memcpy, the param column
+ * is the xyz_simd_level() in use.  The int suite first round trips values
+ * through each integer class and checks the limits, sign-only and empty
+ * text, leading zeros and digit grouping, then times integer formatting and
+ * parsing against snprintf and strtoll.  The meta suite first checks
+ * xyz_meta copy, move and free across every storage mode, then times copies
+ * in each mode.
+ *
+ * Run with --csv to get machine-readable results that can be kept and
+ * compared between releases.
+ *
+ * @file bench.cpp
+ * @date Oct 16, 2026
+ */
+
+
+#include <stdio.h>   // printf, snprintf
+#include <stdlib.h>  // exit, strtoll
+#include <string.h>  // strcmp
+
+#if defined(__linux__)
+#include <pthread.h> // pthread_setaffinity_np
+#include <sched.h>   // cpu_set_t
+#endif
+
+#include <algorithm> // sort
+#include <atomic>    // atomic
+#include <chrono>    // steady_clock
+#include <mutex>     // mutex, lock_guard
+#include <thread>    // thread, yield
+#include <vector>    // vector
+
+#include "xyz.h"
+#include "xyz_ring.h"
+
+
+/// Dimension of the ring buffers being tested.
+#define BENCH_RING_DIM 1024
+
+/// Number of elements to pass through a ring buffer for each test.
+#define BENCH_RING_OPS (20 * 1000 * 1000)
+
+/// Number of elements to pass through each ring in the stress test.
+#define BENCH_STRESS_OPS (2 * 1000 * 1000)
+
+/// Words in each RBOW stress element, enough that a copy can be torn.
+#define BENCH_RBOW_WORDS 8
+
+/// Reader threads in the RBOW stress test.
+#define BENCH_RBOW_READERS 2
+
+/// Byte dimension of the plain RBVL in the stress test, small so records
+/// wrap (and pad) every few dozen records.
+#define BENCH_RBVL_DIM 1024
+
+/// Spins before giving up the CPU when a ring buffer is full or empty.
+#define BENCH_SPIN_MAX 256
+
+/// Dimension of the multi-producer multi-consumer queues being tested.
+#define BENCH_MPMC_DIM 1024
+
+/// Number of elements to pass through a queue for each thread count.
+#define BENCH_MPMC_OPS (4 * 1000 * 1000)
+
+/// Maximum number of producer (and consumer) threads for the queue tests.
+#define BENCH_MPMC_THREADS_MAX 8
+
+/// Lines each producer writes in the console ingest test.
+#define BENCH_INGEST_LINES (500 * 1000)
+
+/// Lines a producer writes back to back before it notifies the consumer,
+/// twice the queue so a burst overflows it unless the consumer keeps up.
+#define BENCH_INGEST_BURST (2 * BENCH_MPMC_DIM)
+
+/// Number of round trips timed for the hand-off latency test.
+#define BENCH_LAT_OPS (200 * 1000)
+
+/// Number of allocations per thread for the allocator tests.
+#define BENCH_ALLOC_OPS (4 * 1000 * 1000)
+
+/// Block size for the allocator tests.
+#define BENCH_ALLOC_SIZE 64
+
+/// Blocks each thread holds at once in the allocator tests.
+#define BENCH_ALLOC_BATCH 16
+
+/// Number of values in the decimal arithmetic tests.
+#define BENCH_DEC_DIM 4096
+
+/// Passes over the values for each decimal arithmetic test.
+#define BENCH_DEC_PASSES 256
+
+/// Bytes of text for the UTF-8 tests.
+#define BENCH_UTF8_DIM (64 * 1024)
+
+/// Passes over the text for each UTF-8 test.
+#define BENCH_UTF8_PASSES 4096
+
+/// Number of values for the integer formatting and parsing tests.
+#define BENCH_INT_DIM 4096
+
+/// Passes over the values for each integer formatting and parsing test.
+#define BENCH_INT_PASSES 512
+
+/// Number of copies timed for each meta copy test.
+#define BENCH_META_OPS (4 * 1000 * 1000)
+
+
+/// Print the results as CSV instead of a table.
+static bool bench_csv = false;
+
+/// Results of the decimal, UTF-8, integer and meta tests, so they are not
+/// optimized away.
+static volatile double bench_dec_sink;
+
+
+/// Data buffer managed by the ring buffer being tested.
+static u64 bench_data[BENCH_RING_DIM];
+
+/// Data buffer managed by the multi-producer multi-consumer queue being tested.
+static u64 bench_mpmc_data[BENCH_MPMC_DIM];
+
+/// Sequence numbers for the xyz_mpam queue.
+static u32 bench_mpmc_seq[BENCH_MPMC_DIM];
+
+/// Data buffers for the two directions of the latency test.
+static u64 bench_ping_data[BENCH_RING_DIM];
+static u64 bench_pong_data[BENCH_RING_DIM];
+
+
+// Adapters to give the different ring buffer access managers the same
+// interface so a single test function can drive all of them.
+
+/// Adapter for the original RBAM.
+struct bench_rbam {
+   xyz_rbam rb;
+   void init(void)  { xyz_rbam_init(&rb, BENCH_RING_DIM); }
+   bool full(void)  { return xyz_rbam_is_full(&rb) == XYZ_TRUE; }
+   u64  wr_idx(void){ return rb.wr; }
+   void write(void) { xyz_rbam_write(&rb); }
+   bool empty(void) { return xyz_rbam_is_empty(&rb) == XYZ_TRUE; }
+   u64  rd_idx(void){ return rb.rd; }
+   void read(void)  { xyz_rbam_read(&rb); }
+};
+
+/// Adapter for the power-of-two RBAM.
+struct bench_rbam_p2 {
+   xyz_rbam_p2 rb;
+   void init(void)  { xyz_rbam_p2_init(&rb, BENCH_RING_DIM); }
+   bool full(void)  { return xyz_rbam_p2_is_full(&rb) == XYZ_TRUE; }
+   u64  wr_idx(void){ return xyz_rbam_p2_wr_idx(&rb); }
+   void write(void) { xyz_rbam_p2_write(&rb); }
+   bool empty(void) { return xyz_rbam_p2_is_empty(&rb) == XYZ_TRUE; }
+   u64  rd_idx(void){ return xyz_rbam_p2_rd_idx(&rb); }
+   void read(void)  { xyz_rbam_p2_read(&rb); }
+};
+
+/// Adapter for the cache-line isolated RBAM.
+struct bench_rbam_cl {
+   xyz_rbam_cl rb;
+   void init(void)  { xyz_rbam_cl_init(&rb, BENCH_RING_DIM); }
+   bool full(void)  { return xyz_rbam_cl_is_full(&rb) == XYZ_TRUE; }
+   u64  wr_idx(void){ return xyz_rbam_cl_wr_idx(&rb); }
+   void write(void) { xyz_rbam_cl_write(&rb); }
+   bool empty(void) { return xyz_rbam_cl_is_empty(&rb) == XYZ_TRUE; }
+   u64  rd_idx(void){ return xyz_rbam_cl_rd_idx(&rb); }
+   void read(void)  { xyz_rbam_cl_read(&rb); }
+};
+
+/**
+ * Adapter for a bare power-of-two ring, used to compare counter layouts.
+ *
+ * The read and write counters are separated by PAD bytes, so a small PAD
+ * puts them on the same cache line (false sharing between the threads), and
+ * a PAD of two cache lines keeps them apart, even with adjacent line
+ * prefetching.  No cached counters, so only the layout differs.
+ */
+template <u32 PAD>
+struct bench_layout {
+   XYZ_ALIGN(XYZ_CACHE_LINE * 2) u64 wr;
+   u8   pad[PAD];
+   u64  rd;
+   u8   pad_end[XYZ_CACHE_LINE * 2];
+   void init(void)  { wr = 0; rd = 0; }
+   bool full(void)  { return wr - xyz_atomic_ld_acq_u64(&rd) == BENCH_RING_DIM; }
+   u64  wr_idx(void){ return wr & (BENCH_RING_DIM - 1); }
+   void write(void) { xyz_atomic_st_rel_u64(&wr, wr + 1); }
+   bool empty(void) { return xyz_atomic_ld_acq_u64(&wr) == rd; }
+   u64  rd_idx(void){ return rd & (BENCH_RING_DIM - 1); }
+   void read(void)  { xyz_atomic_st_rel_u64(&rd, rd + 1); }
+};
+
+/// Adapter for the lock-free multi-producer multi-consumer MPAM queue.
+struct bench_mpam {
+   xyz_mpam mp;
+   void init(void) { xyz_mpam_init(&mp, BENCH_MPMC_DIM, bench_mpmc_seq); }
+   bool push(u64 val) {
+      u32 ticket;
+      if ( xyz_mpam_reserve(&mp, &ticket) == XYZ_FALSE ) { return false; }
+      bench_mpmc_data[xyz_mpam_idx(&mp, ticket)] = val;
+      xyz_mpam_commit(&mp, ticket);
+      return true;
+   }
+   bool pop(u64 *val) {
+      u32 ticket;
+      if ( xyz_mpam_claim(&mp, &ticket) == XYZ_FALSE ) { return false; }
+      *val = bench_mpmc_data[xyz_mpam_idx(&mp, ticket)];
+      xyz_mpam_release(&mp, ticket);
+      return true;
+   }
+};
+
+/// Adapter for an RBAM protected by a mutex, the lock-based alternative.
+struct bench_mutex_rbam {
+   std::mutex lock;
+   xyz_rbam rb;
+   void init(void) { xyz_rbam_init(&rb, BENCH_MPMC_DIM); }
+   bool push(u64 val) {
+      std::lock_guard<std::mutex> guard(lock);
+      if ( xyz_rbam_is_full(&rb) == XYZ_TRUE ) { return false; }
+      bench_mpmc_data[rb.wr] = val;
+      xyz_rbam_write(&rb);
+      return true;
+   }
+   bool pop(u64 *val) {
+      std::lock_guard<std::mutex> guard(lock);
+      if ( xyz_rbam_is_empty(&rb) == XYZ_TRUE ) { return false; }
+      *val = bench_mpmc_data[rb.rd];
+      xyz_rbam_read(&rb);
+      return true;
+   }
+};
+
+
+// Adapters to give decimal64, decimal128 and double the same interface for
+// the decimal arithmetic tests.
+
+/// Adapter for xyz_d64, big() only takes the low part, the coefficient of
+/// a decimal64 fits an s64.
+struct bench_d64
+{
+   typedef xyz_d64 type;
+   static type make(s64 coef, s32 exp) { return xyz_d64_make(coef, exp); }
+   static type big(s64 hi, s64 lo, s32 exp) { (void)hi; return xyz_d64_make(lo, exp); }
+   static type add(type a, type b) { return xyz_d64_add(a, b); }
+   static type sub(type a, type b) { return xyz_d64_sub(a, b); }
+   static u32 str(type a, c8 *buf, u32 dim) { return xyz_d64_to_str(a, buf, dim); }
+   static type mul(type a, type b) { return xyz_d64_mul(a, b); }
+   static s32 cmp(type a, type b) { return xyz_d64_cmp(a, b); }
+   static double value(type a) { return xyz_d64_to_double(a); }
+};
+
+/// Adapter for xyz_d128.
+struct bench_d128
+{
+   typedef xyz_d128 type;
+   static type make(s64 coef, s32 exp) { return xyz_d128_make(coef, exp); }
+   static type big(s64 hi, s64 lo, s32 exp) {  // hi * 10^17 + lo, exact.
+      return xyz_d128_add(xyz_d128_mul(xyz_d128_make(hi, exp), xyz_d128_make(1, 17)), xyz_d128_make(lo, exp)); }
+   static type add(type a, type b) { return xyz_d128_add(a, b); }
+   static type sub(type a, type b) { return xyz_d128_sub(a, b); }
+   static u32 str(type a, c8 *buf, u32 dim) { return xyz_d128_to_str(a, buf, dim); }
+   static type mul(type a, type b) { return xyz_d128_mul(a, b); }
+   static s32 cmp(type a, type b) { return xyz_d128_cmp(a, b); }
+   static double value(type a) { return xyz_d128_to_double(a); }
+};
+
+/// Adapter for double, the binary floating point baseline.
+struct bench_double
+{
+   typedef double type;
+   static type make(s64 coef, s32 exp) {
+      static const double p10[8] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7 };
+      return ( exp < 0 ? (double)coef / p10[-exp] : (double)coef * p10[exp] ); }
+   static type add(type a, type b) { return a + b; }
+   static type mul(type a, type b) { return a * b; }
+   static s32 cmp(type a, type b) { return ( a < b ? -1 : a > b ? 1 : 0 ); }
+   static double value(type a) { return a; }
+};
+
+
+/**
+ * Wait a little while a ring buffer is full or empty.
+ *
+ * Spins with a CPU relax hint for a while, then yields, so the test still
+ * makes progress when there are fewer cores than threads.
+ *
+ * @param[in,out] spins  Spin counter, reset by the caller after progress.
+ */
+static void
+bench_wait(u32 *spins)
+{
+   if ( *spins < BENCH_SPIN_MAX ) {
+      (*spins)++;
+      xyz_cpu_relax();
+   } else {
+      std::this_thread::yield();
+   }
+}
+// bench_wait()
+
+
+/**
+ * Single-writer single-reader throughput test.
+ *
+ * The writer stores an incrementing counter and the reader verifies the
+ * sequence.  Exits the program if the reader ever sees an out of order value.
+ *
+ * @param[in] name  Name of the ring buffer being tested.
+ *
+ * @return Elements passed through the ring buffer per second.
+ */
+template <typename T>
+static double
+bench_spsc(const c8 *name)
+{
+   static T ring;
+   ring.init();
+
+   auto start = std::chrono::steady_clock::now();
+
+   std::thread writer([]() {
+      u32 spins = 0;
+      for ( u64 i = 0 ; i < BENCH_RING_OPS ; )
+      {
+         if ( ring.full() == true ) { bench_wait(&spins); continue; }
+         bench_data[ring.wr_idx()] = i;
+         ring.write();
+         spins = 0;
+         i++;
+      }
+   });
+
+   u32 spins = 0;
+   for ( u64 i = 0 ; i < BENCH_RING_OPS ; )
+   {
+      if ( ring.empty() == true ) { bench_wait(&spins); continue; }
+      u64 val = bench_data[ring.rd_idx()];
+      if ( val != i ) {
+         printf("%s: sequence error, expected %llu got %llu\n", name,
+               (unsigned long long)i, (unsigned long long)val);
+         exit(1);
+      }
+      ring.read();
+      spins = 0;
+      i++;
+   }
+
+   writer.join();
+
+   std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+   return (double)BENCH_RING_OPS / secs.count();
+}
+// bench_spsc()
+
+
+/**
+ * Single-writer single-reader stress test of the original RBAM.
+ *
+ * The writer fills each element with a sequence number and its complement,
+ * in separate words, and the reader checks both.  A reader that sees an
+ * index before the data it protects, or a writer that reuses an element
+ * before the reader is done with it, shows up as a sequence error.  Exits
+ * the program on the first error.
+ *
+ * @param[in] dim  RBAM dimension, small to stay at the full and empty
+ *                 boundaries.
+ *
+ * @return Elements passed through the ring buffer per second.
+ */
+static double
+bench_stress(u32 dim)
+{
+   static xyz_rbam rb;
+   static u64 data[BENCH_RING_DIM][2];
+
+   if ( dim > BENCH_RING_DIM || xyz_rbam_init(&rb, dim) != XYZ_TRUE ) {
+      printf("stress: bad dimension %u\n", dim);
+      exit(1);
+   }
+
+   auto start = std::chrono::steady_clock::now();
+
+   std::thread writer([]() {
+      u32 spins = 0;
+      for ( u64 i = 0 ; i < BENCH_STRESS_OPS ; )
+      {
+         if ( xyz_rbam_is_full(&rb) == XYZ_TRUE ) { bench_wait(&spins); continue; }
+         data[rb.wr][0] = i;
+         data[rb.wr][1] = ~i;
+         xyz_rbam_write(&rb);
+         spins = 0;
+         i++;
+      }
+   });
+
+   u32 spins = 0;
+   for ( u64 i = 0 ; i < BENCH_STRESS_OPS ; )
+   {
+      if ( xyz_rbam_is_empty(&rb) == XYZ_TRUE ) { bench_wait(&spins); continue; }
+      u64 val = data[rb.rd][0];
+      u64 inv = data[rb.rd][1];
+      if ( val != i || inv != ~i ) {
+         printf("stress: dim %u, sequence error, expected %llu got %llu/%llu\n", dim,
+               (unsigned long long)i, (unsigned long long)val, (unsigned long long)~inv);
+         exit(1);
+      }
+      xyz_rbam_read(&rb);
+      spins = 0;
+      i++;
+   }
+
+   writer.join();
+
+   std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+   return (double)BENCH_STRESS_OPS / secs.count();
+}
+// bench_stress()
+
+
+/**
+ * Single-writer multi-reader stress test of the RBOW.
+ *
+ * The writer never waits, so on a small ring it laps the readers all the
+ * time.  Each element is BENCH_RBOW_WORDS copies of its position, stored a
+ * word at a time, so a copy the writer overwrote part way through has mixed
+ * words, and the readers sometimes yield in the middle of a copy to make
+ * that happen.  Every copy xyz_rbow_consume() accepts must be whole, and positions
+ * must increase.  Once the writer is done each reader drains the ring, and
+ * every position must have been counted exactly once, as read, lost or torn.
+ * Exits the program on the first error.
+ *
+ * @param[in]  dim   RBOW dimension.
+ * @param[out] lost  elements lost, summed over the readers.
+ * @param[out] torn  elements torn, summed over the readers.
+ *
+ * @return Elements written per second.
+ */
+static double
+bench_stress_rbow(u32 dim, u64 *lost, u64 *torn)
+{
+   static xyz_rbow rb;
+   static u64 seq[BENCH_RING_DIM];
+   static u64 data[BENCH_RING_DIM][BENCH_RBOW_WORDS];
+
+   if ( dim > BENCH_RING_DIM || xyz_rbow_init(&rb, dim, seq) != XYZ_TRUE ) {
+      printf("stress: rbow bad dimension %u\n", dim);
+      exit(1);
+   }
+
+   std::vector<xyz_rbow_rd> rds(BENCH_RBOW_READERS);
+   std::atomic<bool> done(false);
+   std::vector<std::thread> pool;
+
+   auto start = std::chrono::steady_clock::now();
+
+   for ( u32 t = 0 ; t < BENCH_RBOW_READERS ; t++ )
+   {
+      xyz_rbow_rd_init(&rb, &rds[t], dim);
+
+      pool.push_back(std::thread([dim, t, &rds, &done]() {
+         xyz_rbow_rd *rd = &rds[t];
+         u64 next = 0;
+         u32 copies = 0;
+         u32 spins = 0;
+
+         while ( 1 )
+         {
+            // Read the flag first, so a final drain sees every element.
+            bool last = done.load();
+
+            u64 pos;
+            while ( xyz_rbow_peek(&rb, rd, &pos) == XYZ_TRUE )
+            {
+               // Now and then give up the CPU half way through the copy,
+               // so the writer tears it even when they share a core.
+               u64 copy[BENCH_RBOW_WORDS];
+               for ( u32 w = 0 ; w < BENCH_RBOW_WORDS ; w++ ) {
+                  if ( w == BENCH_RBOW_WORDS / 2 && (++copies & 15) == 0 ) {
+                     std::this_thread::yield();
+                  }
+                  copy[w] = xyz_atomic_ld_rlx_u64(&data[xyz_rbow_idx(&rb, pos)][w]);
+               }
+               if ( xyz_rbow_consume(&rb, rd, pos) == XYZ_FALSE ) { continue; }
+
+               for ( u32 w = 0 ; w < BENCH_RBOW_WORDS ; w++ ) {
+                  if ( pos < next || copy[w] != pos ) {
+                     printf("stress: rbow dim %u, reader %u kept position %llu word %u = %llu\n",
+                           dim, t, (unsigned long long)pos, w, (unsigned long long)copy[w]);
+                     exit(1);
+                  }
+               }
+               next = pos + 1;
+               spins = 0;
+            }
+
+            if ( last == true ) { break; }
+            bench_wait(&spins);
+         }
+
+         if ( rd->pos != BENCH_STRESS_OPS || rd->reads + rd->lost + rd->torn != BENCH_STRESS_OPS ) {
+            printf("stress: rbow dim %u, reader %u at %llu, read %llu + lost %llu + torn %llu != %u\n",
+                  dim, t, (unsigned long long)rd->pos, (unsigned long long)rd->reads,
+                  (unsigned long long)rd->lost, (unsigned long long)rd->torn, BENCH_STRESS_OPS);
+            exit(1);
+         }
+      }));
+   }
+
+   for ( u64 i = 0 ; i < BENCH_STRESS_OPS ; i++ )
+   {
+      u64 pos = xyz_rbow_reserve(&rb);
+      for ( u32 w = 0 ; w < BENCH_RBOW_WORDS ; w++ ) {
+         xyz_atomic_st_rlx_u64(&data[xyz_rbow_idx(&rb, pos)][w], pos);
+      }
+      xyz_rbow_commit(&rb, pos);
+
+      // Let the readers run now and then when they share a core with the
+      // writer, so they are lapped part way through the ring.
+      if ( (i & 1023) == 1023 ) { std::this_thread::yield(); }
+   }
+
+   done.store(true);
+
+   for ( std::thread &th : pool ) {
+      th.join();
+   }
+
+   std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+
+   *lost = 0;
+   *torn = 0;
+   for ( const xyz_rbow_rd &rd : rds ) {
+      *lost += rd.lost;
+      *torn += rd.torn;
+   }
+
+   return (double)BENCH_STRESS_OPS / secs.count();
+}
+// bench_stress_rbow()
+
+
+/**
+ * Payload length of an RBVL stress record, the writer and reader make the
+ * same sequence.  Mostly short records, with one in 64 up to the largest
+ * that always fits.
+ *
+ * @param[in,out] rng  xorshift state.
+ * @param[in]     max  largest payload.
+ *
+ * @return The payload length.
+ */
+static u32
+bench_rbvl_len(u64 *rng, u32 max)
+{
+   *rng ^= *rng << 13; *rng ^= *rng >> 7; *rng ^= *rng << 17;
+   u32 len = (u32)((*rng >> 8) % 64);
+   if ( ((*rng >> 40) & 63) == 0 ) {
+      len = (u32)((*rng >> 16) % (max + 1));
+   }
+   return ( len > max ? max : len );
+}
+// bench_rbvl_len()
+
+
+/**
+ * Checks that an RBVL takes the payloads it promises and rejects the ones
+ * that cannot fit, with the buffer empty at every record offset.
+ *
+ * @param[in] rb    RBVL, empty.
+ * @param[in] what  description for a failure.
+ */
+static void
+bench_rbvl_check(xyz_rbvl *rb, const c8 *what)
+{
+   u32 mirror = ( (rb->flags & XYZ_RBVL_F_MIRROR) != 0 );
+   u32 fits = (u32)( mirror != 0 ? rb->dim - XYZ_RBVL_HDR : (rb->dim / 2) - XYZ_RBVL_HDR );
+
+   for ( u64 off = 0 ; off < rb->dim ; off += XYZ_RBVL_ALIGN )
+   {
+      if ( xyz_rbvl_reserve(rb, fits) == NULL ||
+           xyz_rbvl_reserve(rb, (u32)rb->dim - XYZ_RBVL_HDR + 1) != NULL ||
+           xyz_rbvl_reserve(rb, XYZ_RBVL_PAD - 1) != NULL ||
+           xyz_rbvl_reserve(rb, XYZ_RBVL_PAD) != NULL ||
+           xyz_rbvl_reserve(rb, 0xFFFFFFFF) != NULL ) {
+         printf("stress: %s, payload limits wrong at offset %llu\n", what, (unsigned long long)off);
+         exit(1);
+      }
+
+      // An empty record moves the buffer on by one alignment unit.
+      if ( xyz_rbvl_reserve(rb, 0) == NULL ) {
+         printf("stress: %s, empty record rejected at offset %llu\n", what, (unsigned long long)off);
+         exit(1);
+      }
+      xyz_rbvl_commit(rb, 0);
+      xyz_rbvl_consume(rb);
+   }
+
+   if ( xyz_rbvl_used(rb) != 0 ) {
+      printf("stress: %s, %llu bytes used after the limit checks\n", what,
+            (unsigned long long)xyz_rbvl_used(rb));
+      exit(1);
+   }
+}
+// bench_rbvl_check()
+
+
+/**
+ * Single-writer single-reader stress test of the RBVL.
+ *
+ * The writer reserves a little more than each record needs and commits the
+ * actual length.  Every payload byte depends on the record number and its
+ * offset, and the reader checks the length and every byte.  The reader also
+ * works out where each record should start: a plain buffer may only skip
+ * the tail of the buffer (a pad record) to start again at offset 0, and a
+ * mirrored buffer never skips anything, its records run across the end of
+ * the buffer instead.  Exits the program on the first error.
+ *
+ * @param[in]  rb     RBVL, empty, plain or XYZ_RBVL_F_MIRROR.
+ * @param[out] skips  pad records skipped (plain), or records that run across
+ *                    the end of the buffer (mirrored).
+ *
+ * @return Records passed through the buffer per second.
+ */
+static double
+bench_stress_rbvl(xyz_rbvl *rb, u64 *skips)
+{
+   static xyz_rbvl *srb;
+   srb = rb;
+
+   u32 mirror = ( (rb->flags & XYZ_RBVL_F_MIRROR) != 0 );
+   u32 max = (u32)( mirror != 0 ? rb->dim - XYZ_RBVL_HDR : (rb->dim / 2) - XYZ_RBVL_HDR );
+   const c8 *name = ( mirror != 0 ? "rbvl mirror" : "rbvl" );
+
+   auto start = std::chrono::steady_clock::now();
+
+   std::thread writer([max]() {
+      u64 rng = 0x9E3779B97F4A7C15ull;
+      u32 spins = 0;
+      for ( u64 i = 0 ; i < BENCH_STRESS_OPS ; )
+      {
+         u64 save = rng;
+         u32 len = bench_rbvl_len(&rng, max);
+         u32 extra = (u32)(i & 7);
+         u8 *p = xyz_rbvl_reserve(srb, ( len + extra > max ? max : len + extra ));
+         if ( p == NULL ) { rng = save; bench_wait(&spins); continue; }
+
+         for ( u32 k = 0 ; k < len ; k++ ) { p[k] = (u8)((i * 31) + k); }
+         xyz_rbvl_commit(srb, len);
+         spins = 0;
+         i++;
+      }
+   });
+
+   u64 rng = 0x9E3779B97F4A7C15ull;
+   u64 next = 0;
+   u32 spins = 0;
+   *skips = 0;
+
+   for ( u64 i = 0 ; i < BENCH_STRESS_OPS ; )
+   {
+      u32 len;
+      u8 *p = xyz_rbvl_peek(rb, &len);
+      if ( p == NULL ) { bench_wait(&spins); continue; }
+
+      u64 off = (u64)(p - rb->buf) - XYZ_RBVL_HDR;
+      u32 expect = bench_rbvl_len(&rng, max);
+
+      if ( len != expect || off >= rb->dim || (off & (XYZ_RBVL_ALIGN - 1)) != 0 ||
+           (off != next && (mirror != 0 || off != 0)) ) {
+         printf("stress: %s record %llu, %u bytes at %llu, expected %u bytes at %llu\n",
+               name, (unsigned long long)i, len, (unsigned long long)off, expect,
+               (unsigned long long)next);
+         exit(1);
+      }
+
+      for ( u32 k = 0 ; k < len ; k++ ) {
+         if ( p[k] != (u8)((i * 31) + k) ) {
+            printf("stress: %s record %llu, byte %u is wrong\n", name, (unsigned long long)i, k);
+            exit(1);
+         }
+      }
+
+      u64 size = ((len + XYZ_RBVL_HDR) + (XYZ_RBVL_ALIGN - 1)) & ~(u64)(XYZ_RBVL_ALIGN - 1);
+      if ( mirror != 0 ) {
+         *skips += ( off + size > rb->dim ? 1 : 0 );
+      } else {
+         *skips += ( off != next ? 1 : 0 );
+      }
+      next = (off + size) & rb->mask;
+
+      xyz_rbvl_consume(rb);
+      spins = 0;
+      i++;
+   }
+
+   writer.join();
+
+   std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+   return (double)BENCH_STRESS_OPS / secs.count();
+}
+// bench_stress_rbvl()
+
+
+/// Element for the xyz::ring checks, counts its live instances.
+struct bench_ring_elem {
+   static s32 live;
+   u64 val;
+   explicit bench_ring_elem(u64 v) : val(v) { live++; }
+   ~bench_ring_elem() { live--; }
+};
+
+s32 bench_ring_elem::live = 0;
+
+
+/**
+ * Checks xyz::ring on one thread.
+ *
+ * Pushes the counters around the ring many times, with the ring at several
+ * fill levels, and checks that range-for and operator[] walk the elements
+ * oldest to newest, that a full ring rejects emplace(), and that every
+ * element emplace() constructs is destroyed exactly once by pop(), clear()
+ * or the destructor.  Exits the program on the first error.
+ */
+static void
+bench_ring_check(void)
+{
+   {
+      xyz::ring<bench_ring_elem, 8> rg;
+      u64 next_wr = 0;
+      u64 next_rd = 0;
+
+      // Fill levels from empty to full, enough rounds to wrap many times.
+      for ( u32 round = 0 ; round < 1000 ; round++ )
+      {
+         u32 fill = round % 9;
+         while ( rg.used() < fill ) {
+            if ( rg.emplace(next_wr) == NULL ) {
+               printf("ring: emplace failed with %u used\n", rg.used());
+               exit(1);
+            }
+            next_wr++;
+         }
+
+         // It may have held more than asked for.
+         fill = rg.used();
+
+         if ( fill == 8 && (rg.is_full() == false || rg.emplace(0) != NULL) ) {
+            printf("ring: emplace into a full ring\n");
+            exit(1);
+         }
+
+         u64 expect = next_rd;
+         u32 i = 0;
+         for ( bench_ring_elem &el : rg ) {
+            if ( el.val != expect || rg[i].val != expect ) {
+               printf("ring: round %u element %u is %llu, expected %llu\n",
+                     round, i, (unsigned long long)el.val, (unsigned long long)expect);
+               exit(1);
+            }
+            expect++;
+            i++;
+         }
+
+         if ( i != fill || bench_ring_elem::live != (s32)fill ) {
+            printf("ring: round %u walked %u, %d live, expected %u\n",
+                  round, i, bench_ring_elem::live, fill);
+            exit(1);
+         }
+
+         // Pop a varying number, singly, or in a batch that may ask for
+         // more than there is.
+         u32 drop = (round * 7) % (fill + 1);
+         if ( (round & 1) == 0 ) {
+            for ( u32 d = 0 ; d < drop ; d++ ) { rg.pop(); }
+         } else {
+            u32 want = drop + 4;
+            drop = rg.pop(want);
+            if ( drop != std::min(fill, want) ) {
+               printf("ring: round %u batch pop removed %u\n", round, drop);
+               exit(1);
+            }
+         }
+         next_rd += drop;
+
+         if ( bench_ring_elem::live != (s32)(fill - drop) ) {
+            printf("ring: round %u, %d live after pop, expected %u\n",
+                  round, bench_ring_elem::live, fill - drop);
+            exit(1);
+         }
+      }
+
+      rg.pop(100);
+      if ( rg.is_empty() == false || rg.pop() == true || rg.pop(1) != 0 ) {
+         printf("ring: pop from an empty ring\n");
+         exit(1);
+      }
+
+      rg.emplace(1);
+      rg.emplace(2);
+      rg.clear();
+      rg.emplace(3);
+   }
+
+   // The destructor takes what clear() left.
+   if ( bench_ring_elem::live != 0 ) {
+      printf("ring: %d elements not destroyed\n", bench_ring_elem::live);
+      exit(1);
+   }
+}
+// bench_ring_check()
+
+
+/**
+ * Single-writer single-reader test of xyz::ring.
+ *
+ * The writer emplaces a sequence number and its complement, the reader
+ * checks both through front() and pops.  Exits the program on the first
+ * error.
+ *
+ * @return Elements passed through the ring per second.
+ */
+static double
+bench_ring_spsc(void)
+{
+   struct elem { u64 seq; u64 inv; };
+   static xyz::ring<elem, BENCH_RING_DIM> rg;
+
+   auto start = std::chrono::steady_clock::now();
+
+   std::thread writer([]() {
+      u32 spins = 0;
+      for ( u64 i = 0 ; i < BENCH_RING_OPS ; )
+      {
+         if ( rg.emplace(elem{ i, ~i }) == NULL ) { bench_wait(&spins); continue; }
+         spins = 0;
+         i++;
+      }
+   });
+
+   u32 spins = 0;
+   for ( u64 i = 0 ; i < BENCH_RING_OPS ; )
+   {
+      if ( rg.is_empty() == true ) { bench_wait(&spins); continue; }
+      const elem &el = rg.front();
+      if ( el.seq != i || el.inv != ~i ) {
+         printf("ring: sequence error, expected %llu got %llu\n",
+               (unsigned long long)i, (unsigned long long)el.seq);
+         exit(1);
+      }
+      rg.pop();
+      spins = 0;
+      i++;
+   }
+
+   writer.join();
+
+   std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+   return (double)BENCH_RING_OPS / secs.count();
+}
+// bench_ring_spsc()
+
+
+/**
+ * Multi-producer multi-consumer contention test.
+ *
+ * Runs the given number of producer threads and the same number of consumer
+ * threads against one queue.  Each producer writes the values 1..n, and the
+ * sum of everything the consumers read is checked at the end.  Exits the
+ * program if a value was lost or duplicated.
+ *
+ * @param[in] name     Name of the queue being tested.
+ * @param[in] threads  Number of producer threads, and of consumer threads.
+ *
+ * @return Elements passed through the queue per second.
+ */
+template <typename T>
+static double
+bench_mpmc(const c8 *name, u32 threads)
+{
+   static T queue;
+   queue.init();
+
+   const u64 per_thread = BENCH_MPMC_OPS / threads;
+   const u64 total = per_thread * threads;
+   std::atomic<u64> done(0);
+   std::atomic<u64> sum(0);
+   std::vector<std::thread> pool;
+
+   auto start = std::chrono::steady_clock::now();
+
+   for ( u32 t = 0 ; t < threads ; t++ )
+   {
+      pool.push_back(std::thread([per_thread]() {
+         u32 spins = 0;
+         for ( u64 i = 1 ; i <= per_thread ; )
+         {
+            if ( queue.push(i) == false ) { bench_wait(&spins); continue; }
+            spins = 0;
+            i++;
+         }
+      }));
+
+      pool.push_back(std::thread([total, &done, &sum]() {
+         u32 spins = 0;
+         u64 local = 0;
+         u64 val;
+         while ( done.load(std::memory_order_relaxed) < total )
+         {
+            if ( queue.pop(&val) == false ) { bench_wait(&spins); continue; }
+            local += val;
+            done.fetch_add(1, std::memory_order_relaxed);
+            spins = 0;
+         }
+         sum.fetch_add(local);
+      }));
+   }
+
+   for ( std::thread &th : pool ) {
+      th.join();
+   }
+
+   std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+
+   u64 expect = threads * ((per_thread * (per_thread + 1)) / 2);
+   if ( sum.load() != expect ) {
+      printf("%s: %u threads, checksum error, expected %llu got %llu\n", name,
+            threads, (unsigned long long)expect, (unsigned long long)sum.load());
+      exit(1);
+   }
+
+   return (double)total / secs.count();
+}
+// bench_mpmc()
+
+
+/// Condition callback for the ingest test, the queue has something to read.
+static u32
+bench_ingest_ready(void *arg)
+{
+   return ( xyz_mpam_used((xyz_mpam *)arg) > 0 ? XYZ_TRUE : XYZ_FALSE );
+}
+// bench_ingest_ready()
+
+
+/**
+ * Console ingest test, the way disco moves lines from any thread into the
+ * console.
+ *
+ * Producers never wait: a line that does not fit in the queue is dropped
+ * and counted for that producer, and each burst of lines notifies the
+ * consumer.  The single consumer sleeps on an xyz_evc until lines are
+ * queued and then drains the queue until it is empty.
+ *
+ * Every line carries its producer and sequence number.  For each producer
+ * the consumer checks that lines arrive in order, and at the end that the
+ * lines received plus the lines dropped is the number written.  Exits the
+ * program if a line was lost, duplicated, or reordered.
+ *
+ * @param[in]  threads  number of producer threads.
+ * @param[out] drops    total lines dropped because the queue was full.
+ *
+ * @return Lines written (received or dropped) per second.
+ */
+static double
+bench_ingest(u32 threads, u64 *drops)
+{
+   static xyz_mpam mp;
+   static xyz_evc ev;
+   xyz_mpam_init(&mp, BENCH_MPMC_DIM, bench_mpmc_seq);
+   xyz_evc_init(&ev, XYZ_EVC_SPIN);
+
+   std::vector<std::atomic<u64> > dropped(threads);
+   std::vector<u64> received(threads, 0);
+   std::vector<u64> next(threads, 0);
+   std::atomic<u32> running(threads);
+   std::vector<std::thread> pool;
+
+   for ( u32 t = 0 ; t < threads ; t++ ) { dropped[t].store(0); }
+
+   auto start = std::chrono::steady_clock::now();
+
+   for ( u32 t = 0 ; t < threads ; t++ )
+   {
+      pool.push_back(std::thread([t, &dropped, &running]() {
+         for ( u64 i = 0 ; i < BENCH_INGEST_LINES ; i++ )
+         {
+            u32 ticket;
+            if ( xyz_mpam_reserve(&mp, &ticket) == XYZ_FALSE ) {
+               dropped[t].fetch_add(1, std::memory_order_relaxed);
+            } else {
+               bench_mpmc_data[xyz_mpam_idx(&mp, ticket)] = ((u64)t << 32) | i;
+               xyz_mpam_commit(&mp, ticket);
+            }
+
+            if ( (i % BENCH_INGEST_BURST) == BENCH_INGEST_BURST - 1 ) {
+               xyz_evc_notify(&ev);
+               std::this_thread::yield();
+            }
+         }
+         running.fetch_sub(1);
+         xyz_evc_notify(&ev);
+      }));
+   }
+
+   while ( 1 )
+   {
+      // Read the flag first, so a final drain sees every line.
+      bool last = ( running.load() == 0 );
+
+      u32 ticket;
+      while ( xyz_mpam_peek(&mp, &ticket) == XYZ_TRUE )
+      {
+         u64 val = bench_mpmc_data[xyz_mpam_idx(&mp, ticket)];
+         xyz_mpam_consume(&mp, ticket);
+
+         u32 t = (u32)(val >> 32);
+         u64 seq = val & 0xFFFFFFFF;
+         if ( t >= threads || seq < next[t] ) {
+            printf("ingest: %u threads, producer %u line %llu out of order\n",
+                  threads, t, (unsigned long long)seq);
+            exit(1);
+         }
+         next[t] = seq + 1;
+         received[t]++;
+      }
+
+      if ( last == true ) { break; }
+      xyz_evc_await(&ev, bench_ingest_ready, &mp, 10);
+   }
+
+   for ( std::thread &th : pool ) {
+      th.join();
+   }
+
+   std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+
+   *drops = 0;
+   for ( u32 t = 0 ; t < threads ; t++ )
+   {
+      u64 d = dropped[t].load();
+      if ( received[t] + d != BENCH_INGEST_LINES ) {
+         printf("ingest: %u threads, producer %u received %llu + dropped %llu != %u\n",
+               threads, t, (unsigned long long)received[t], (unsigned long long)d,
+               BENCH_INGEST_LINES);
+         exit(1);
+      }
+      *drops += d;
+   }
+
+   return ((double)BENCH_INGEST_LINES * threads) / secs.count();
+}
+// bench_ingest()
+
+
+/**
+ * Report one result.
+ *
+ * Results are either printed as an aligned table for people, or as CSV for
+ * tracking regressions between releases (see main()).
+ *
+ * @param[in] suite   Test suite, i.e. "spsc" or "latency".
+ * @param[in] name    Name of the thing being tested.
+ * @param[in] param   Test parameter, i.e. a thread count or batch size.
+ * @param[in] metric  Name of the measurement, i.e. "ops_sec" or "p99_ns".
+ * @param[in] value   The measurement.
+ */
+static void
+bench_report(const c8 *suite, const c8 *name, u32 param, const c8 *metric,
+      double value)
+{
+   if ( bench_csv == true ) {
+      printf("%s,%s,%u,%s,%.3f\n", suite, name, param, metric, value);
+   } else {
+      printf("%-8s %-12s %6u %-10s %16.2f\n", suite, name, param, metric, value);
+   }
+   fflush(stdout);
+}
+// bench_report()
+
+
+/**
+ * Pin a thread to a CPU, so the cross-core tests really are cross-core.
+ *
+ * Only supported on Linux, elsewhere the scheduler decides.
+ *
+ * @param[in] th   The thread to pin.
+ * @param[in] cpu  CPU number, wrapped to the number of CPUs.
+ */
+static void
+bench_pin(std::thread &th, u32 cpu)
+{
+#if defined(__linux__)
+   u32 cpus = std::thread::hardware_concurrency();
+   if ( cpus < 2 ) { return; }
+   cpu_set_t set;
+   CPU_ZERO(&set);
+   CPU_SET(cpu % cpus, &set);
+   pthread_setaffinity_np(th.native_handle(), sizeof(set), &set);
+#else
+   (void)th;
+   (void)cpu;
+#endif
+}
+// bench_pin()
+
+
+/**
+ * Cross-core hand-off latency test.
+ *
+ * A ping-pong between two threads over two ring buffers, with one element in
+ * flight, so there is no queueing and every sample is two hand-offs.  Each
+ * round trip is timed and the one-way latency percentiles are reported.
+ *
+ * @param[in] name  Name of the ring buffer being tested.
+ */
+template <typename T>
+static void
+bench_latency(const c8 *name)
+{
+   static T ping;
+   static T pong;
+   ping.init();
+   pong.init();
+
+   std::vector<u64> samples(BENCH_LAT_OPS);
+
+   std::thread echo([]() {
+      u32 spins = 0;
+      for ( u64 i = 0 ; i < BENCH_LAT_OPS ; )
+      {
+         if ( ping.empty() == true || pong.full() == true ) {
+            bench_wait(&spins);
+            continue;
+         }
+         bench_pong_data[pong.wr_idx()] = bench_ping_data[ping.rd_idx()];
+         ping.read();
+         pong.write();
+         spins = 0;
+         i++;
+      }
+   });
+
+   std::thread self([&samples, name]() {
+      u32 spins = 0;
+      for ( u64 i = 0 ; i < BENCH_LAT_OPS ; i++ )
+      {
+         u64 start = xyz_time_ns();
+         bench_ping_data[ping.wr_idx()] = i;
+         ping.write();
+
+         while ( pong.empty() == true ) { bench_wait(&spins); }
+         spins = 0;
+
+         u64 val = bench_pong_data[pong.rd_idx()];
+         pong.read();
+         samples[i] = (xyz_time_ns() - start) / 2;
+
+         if ( val != i ) {
+            printf("%s: latency sequence error, expected %llu got %llu\n", name,
+                  (unsigned long long)i, (unsigned long long)val);
+            exit(1);
+         }
+      }
+   });
+
+   bench_pin(echo, 1);
+   bench_pin(self, 0);
+   self.join();
+   echo.join();
+
+   std::sort(samples.begin(), samples.end());
+
+   const u64 n = BENCH_LAT_OPS;
+   bench_report("latency", name, 1, "p50_ns", (double)samples[n / 2]);
+   bench_report("latency", name, 1, "p90_ns", (double)samples[(n * 90) / 100]);
+   bench_report("latency", name, 1, "p99_ns", (double)samples[(n * 99) / 100]);
+   bench_report("latency", name, 1, "p999_ns", (double)samples[(n * 999) / 1000]);
+   bench_report("latency", name, 1, "max_ns", (double)samples[n - 1]);
+}
+// bench_latency()
+
+
+/**
+ * Batch single-writer single-reader throughput test.
+ *
+ * Same as bench_spsc() with the RBAM, but moves up to batch elements per
+ * index update using the reserve/commit and peek/consume spans.
+ *
+ * @param[in] batch  Maximum elements per reserve or peek.
+ *
+ * @return Elements passed through the ring buffer per second.
+ */
+static double
+bench_spsc_batch(u32 batch)
+{
+   static xyz_rbam ring;
+   xyz_rbam_init(&ring, BENCH_RING_DIM);
+
+   auto start = std::chrono::steady_clock::now();
+
+   std::thread writer([batch]() {
+      u32 spins = 0;
+      xyz_rbam_span span;
+      for ( u64 i = 0 ; i < BENCH_RING_OPS ; )
+      {
+         u64 want = BENCH_RING_OPS - i;
+         u32 n = xyz_rbam_reserve(&ring, (want < batch ? (u32)want : batch), &span);
+         if ( n == 0 ) { bench_wait(&spins); continue; }
+
+         for ( u32 run = 0 ; run < 2 ; run++ ) {
+            u64 *p = bench_data + span.idx[run];
+            for ( u32 k = 0 ; k < span.len[run] ; k++ ) { p[k] = i++; }
+         }
+
+         xyz_rbam_commit(&ring, n);
+         spins = 0;
+      }
+   });
+
+   u32 spins = 0;
+   xyz_rbam_span span;
+   for ( u64 i = 0 ; i < BENCH_RING_OPS ; )
+   {
+      u32 n = xyz_rbam_peek(&ring, batch, &span);
+      if ( n == 0 ) { bench_wait(&spins); continue; }
+
+      for ( u32 run = 0 ; run < 2 ; run++ )
+      {
+         u64 *p = bench_data + span.idx[run];
+         for ( u32 k = 0 ; k < span.len[run] ; k++, i++ )
+         {
+            if ( p[k] != i ) {
+               printf("rbam batch %u: sequence error, expected %llu got %llu\n",
+                     batch, (unsigned long long)i, (unsigned long long)p[k]);
+               exit(1);
+            }
+         }
+      }
+
+      xyz_rbam_consume(&ring, n);
+      spins = 0;
+   }
+
+   writer.join();
+
+   std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+   return (double)BENCH_RING_OPS / secs.count();
+}
+// bench_spsc_batch()
+
+
+/**
+ * Small block allocator test, xyz_pool versus malloc.
+ *
+ * Each thread repeatedly allocates a batch of blocks, writes to them, and
+ * frees them.  Every other batch is freed by the next thread over, so blocks
+ * also move between threads.
+ *
+ * @param[in] use_pool  true to use an xyz_pool, false to use malloc.
+ * @param[in] threads   number of threads.
+ *
+ * @return Allocations (each with a free) per second.
+ */
+static double
+bench_alloc(bool use_pool, u32 threads)
+{
+   static xyz_pool pool;
+   static thread_local xyz_pool_mag mag;
+
+   const u64 blocks = (u64)threads * ((BENCH_ALLOC_BATCH * 3) + XYZ_POOL_MAG);
+   u8 *mem = (u8 *)xyz_aligned_malloc(XYZ_POOL_SIZE(BENCH_ALLOC_SIZE, blocks), XYZ_CACHE_LINE);
+   if ( mem == NULL ) {
+      printf("alloc: could not allocate the pool region\n");
+      exit(1);
+   }
+
+   if ( xyz_pool_init(&pool, mem, XYZ_POOL_SIZE(BENCH_ALLOC_SIZE, blocks), BENCH_ALLOC_SIZE) != XYZ_TRUE ||
+        pool.count < blocks ) {
+      printf("alloc: pool has %llu of %llu blocks\n", (unsigned long long)pool.count, (unsigned long long)blocks);
+      exit(1);
+   }
+
+   // One hand-off slot per thread, filled by the previous thread.
+   std::vector<std::atomic<void **> > handoff(threads);
+   for ( u32 t = 0 ; t < threads ; t++ ) { handoff[t].store(NULL); }
+
+   std::vector<std::thread> pool_threads;
+   auto start = std::chrono::steady_clock::now();
+
+   for ( u32 t = 0 ; t < threads ; t++ )
+   {
+      pool_threads.push_back(std::thread([use_pool, t, threads, &handoff]() {
+         void *batch[2][BENCH_ALLOC_BATCH];
+         u32 which = 0;
+         u32 spins = 0;
+
+         for ( u64 i = 0 ; i < BENCH_ALLOC_OPS ; i += BENCH_ALLOC_BATCH )
+         {
+            void **blk = batch[which];
+            for ( u32 k = 0 ; k < BENCH_ALLOC_BATCH ; k++ ) {
+               blk[k] = (use_pool ? xyz_pool_alloc(&pool, &mag) : malloc(BENCH_ALLOC_SIZE));
+               if ( blk[k] == NULL ) { printf("alloc: out of blocks\n"); exit(1); }
+               *(u64 *)blk[k] = i;
+            }
+
+            // Free a batch from the previous thread, if one is waiting.
+            void **theirs = handoff[t].exchange(NULL);
+            if ( theirs != NULL ) {
+               for ( u32 k = 0 ; k < BENCH_ALLOC_BATCH ; k++ ) {
+                  if ( use_pool ) { xyz_pool_free(&pool, &mag, theirs[k]); } else { free(theirs[k]); }
+               }
+               delete [] theirs;
+            }
+
+            // Pass every other batch on, free the rest locally.
+            if ( threads > 1 && (i / BENCH_ALLOC_BATCH) % 2 == 0 ) {
+               void **mine = new void *[BENCH_ALLOC_BATCH];
+               for ( u32 k = 0 ; k < BENCH_ALLOC_BATCH ; k++ ) { mine[k] = blk[k]; }
+               std::atomic<void **> &next = handoff[(t + 1) % threads];
+               void **expected = NULL;
+               while ( next.compare_exchange_weak(expected, mine) == false ) {
+                  expected = NULL;
+                  bench_wait(&spins);
+               }
+               spins = 0;
+            } else {
+               for ( u32 k = 0 ; k < BENCH_ALLOC_BATCH ; k++ ) {
+                  if ( use_pool ) { xyz_pool_free(&pool, &mag, blk[k]); } else { free(blk[k]); }
+               }
+            }
+            which ^= 1;
+         }
+
+         if ( use_pool ) { xyz_pool_mag_flush(&pool, &mag); }
+      }));
+   }
+
+   for ( std::thread &th : pool_threads ) {
+      th.join();
+   }
+
+   std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+
+   // Free any batches left in the hand-off slots.
+   for ( u32 t = 0 ; t < threads ; t++ )
+   {
+      void **theirs = handoff[t].exchange(NULL);
+      if ( theirs == NULL ) { continue; }
+      for ( u32 k = 0 ; k < BENCH_ALLOC_BATCH ; k++ ) {
+         if ( use_pool ) { xyz_pool_free(&pool, NULL, theirs[k]); } else { free(theirs[k]); }
+      }
+      delete [] theirs;
+   }
+
+   if ( use_pool )
+   {
+      if ( pool.stats.out != 0 || pool.stats.allocs != pool.stats.frees ) {
+         printf("pool: %llu blocks leaked\n", (unsigned long long)pool.stats.out);
+         exit(1);
+      }
+      bench_report("alloc", "pool", threads, "peak", (double)pool.stats.peak);
+      bench_report("alloc", "pool", threads, "refills", (double)pool.stats.refills);
+      bench_report("alloc", "pool", threads, "contended", (double)pool.stats.contended);
+   }
+
+   xyz_aligned_free(mem);
+
+   return ((double)BENCH_ALLOC_OPS * threads) / secs.count();
+}
+// bench_alloc()
+
+
+/**
+ * Decimal arithmetic test, xyz_d64 and xyz_d128 versus double.
+ *
+ * Prices are two-place decimals like money.  The operations are:
+ *
+ *   0  add     running total of prices, the same exponent throughout
+ *   1  mixed   running total of values with 2 to 7 places
+ *   2  mul     price times quantity
+ *   3  cmp     compare prices against values with 2 to 7 places
+ *
+ * Every type sees the same values.
+ *
+ * @param[in] op  operation, see above.
+ *
+ * @return Operations per second.
+ */
+template <typename T>
+static double
+bench_decimal(u32 op)
+{
+   std::vector<typename T::type> a(BENCH_DEC_DIM);
+   std::vector<typename T::type> b(BENCH_DEC_DIM);
+   std::vector<typename T::type> c(BENCH_DEC_DIM);
+
+   u64 rng = 0x9E3779B97F4A7C15ull;
+   for ( u32 i = 0 ; i < BENCH_DEC_DIM ; i++ )
+   {
+      rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+      s32 places = 2 + (s32)((rng >> 32) % 6);
+      a[i] = T::make((s64)(rng % 100000), -2);
+      b[i] = ( op == 2 ? T::make((s64)((rng >> 20) % 100), 0)
+                       : T::make((s64)((rng >> 20) % 10000000), -places) );
+   }
+
+   typename T::type acc = T::make(0, -2);
+   u32 less = 0;
+
+   auto start = std::chrono::steady_clock::now();
+
+   for ( u32 pass = 0 ; pass < BENCH_DEC_PASSES ; pass++ )
+   {
+      switch ( op )
+      {
+      case 0 : for ( u32 i = 0 ; i < BENCH_DEC_DIM ; i++ ) { acc = T::add(acc, a[i]); } break;
+      case 1 : for ( u32 i = 0 ; i < BENCH_DEC_DIM ; i++ ) { acc = T::add(acc, b[i]); } break;
+      case 2 : for ( u32 i = 0 ; i < BENCH_DEC_DIM ; i++ ) { c[i] = T::mul(a[i], b[i]); } break;
+      default : for ( u32 i = 0 ; i < BENCH_DEC_DIM ; i++ ) { less += ( T::cmp(a[i], b[i]) < 0 ? 1 : 0 ); } break;
+      }
+   }
+
+   std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+
+   // Keep the results live.
+   bench_dec_sink = T::value(acc) + T::value(c[BENCH_DEC_DIM - 1]) + less;
+
+   return ((double)BENCH_DEC_DIM * BENCH_DEC_PASSES) / secs.count();
+}
+// bench_decimal()
+
+
+/// A decimal arithmetic check, a op b with the coefficients given as
+/// hi * 10^17 + lo so decimal128 can have all 34 digits.
+struct bench_dec_case
+{
+   c8          op;       ///< 'a' add, 's' sub, 'm' mul, 'c' cmp.
+   s64         a_hi;     ///< First operand coefficient, high digits.
+   s64         a_lo;     ///< First operand coefficient, low 17 digits.
+   s32         a_exp;    ///< First operand exponent.
+   s64         b_hi;     ///< Second operand coefficient, high digits.
+   s64         b_lo;     ///< Second operand coefficient, low 17 digits.
+   s32         b_exp;    ///< Second operand exponent.
+   const c8   *expect;   ///< Result as a string, or -1, 0, 1 for cmp.
+};
+
+/// decimal64 checks, the results are from an IEEE 754 reference with 16
+/// digits, rounding half-even.
+static const bench_dec_case bench_d64_cases[] = {
+   { 'a', 0, 1990ll, -2, 0, 1ll, -3, "19.901" },  // mixed exponents
+   { 'a', 0, 150ll, -2, 0, 125ll, -2, "2.75" },  // same exponent
+   { 'a', 0, 150ll, -2, 0, 150ll, -2, "3.00" },  // scale kept
+   { 's', 0, 1000ll, -2, 0, 1ll, -3, "9.999" },  // mixed exponents
+   { 's', 0, 125ll, -2, 0, 150ll, -2, "-0.25" },  // negative result
+   { 'a', 0, 1234567890123456ll, 0, 0, 5ll, -1, "1234567890123456" },  // tie, even stays
+   { 'a', 0, 1234567890123457ll, 0, 0, 5ll, -1, "1234567890123458" },  // tie, odd rounds up
+   { 'a', 0, 1234567890123456ll, 0, 0, 51ll, -2, "1234567890123457" },  // above tie
+   { 'a', 0, 9999999999999999ll, 0, 0, 1ll, 0, "1.000000000000000E+16" },  // carry into a new digit
+   { 'a', 0, 9999999999999999ll, 0, 0, 5ll, -1, "1.000000000000000E+16" },  // tie with carry
+   { 's', 0, 1000000000000000ll, 1, 0, 1ll, -20, "1.000000000000000E+16" },  // borrow, sticky
+   { 'a', 0, -1234ll, -2, 0, 1234ll, -2, "0.00" },  // exact zero
+   { 'm', 0, 1999ll, -2, 0, 3ll, 0, "59.97" },  // price times quantity
+   { 'm', 0, 5000000000000001ll, 0, 0, 5ll, 0, "2.500000000000000E+16" },  // product tie
+   { 'm', 0, 9999999999999999ll, 0, 0, 9999999999999999ll, 0, "9.999999999999998E+31" },  // wide product
+   { 'm', 0, -25ll, -1, 0, 4ll, -3, "-0.0100" },  // negative
+   { 'c', 0, 150ll, -2, 0, 15ll, -1, "0" },  // equal, different scale
+   { 'c', 0, 1990ll, -2, 0, 19901ll, -3, "-1" },  // less
+   { 'c', 0, -1ll, 0, 0, -2ll, 0, "1" },  // negative greater
+   { 'c', 0, 1ll, 20, 0, 9999999999999999ll, 3, "1" },  // large exponent
+};
+
+/// decimal128 checks, the results are from an IEEE 754 reference with 34
+/// digits, rounding half-even.
+static const bench_dec_case bench_d128_cases[] = {
+   { 'a', 0ll, 1ll, 38, 48857088063677475ll, 92676148611650008ll, 0, "1.000048857088063677475926761486117E+38" },  // sticky digit past 64 bits
+   { 'a', 99999999999999999ll, 99999999999999999ll, 0, 0ll, 1ll, 0, "1.000000000000000000000000000000000E+34" },  // carry into a new digit
+   { 'a', 12345678901234567ll, 89012345678901234ll, 0, 0ll, 5ll, -1, "1234567890123456789012345678901234" },  // tie, even stays
+   { 'a', 12345678901234567ll, 89012345678901235ll, 0, 0ll, 5ll, -1, "1234567890123456789012345678901236" },  // tie, odd rounds up
+   { 'a', 12345678901234567ll, 89012345678901234ll, 0, 0ll, 500000000001ll, -12, "1234567890123456789012345678901235" },  // above tie
+   { 's', 10000000000000000ll, 0ll, 1, 0ll, 1ll, -40, "1.000000000000000000000000000000000E+34" },  // borrow, sticky
+   { 's', 99999999999999999ll, 99999999999999999ll, 0, 99999999999999999ll, 99999999999999999ll, -1, "8999999999999999999999999999999999" },  // mixed exponents
+   { 'a', 0ll, 1990ll, -2, 0ll, 1ll, -3, "19.901" },  // mixed exponents
+   { 'a', -50000000000000000ll, 0ll, -2, 50000000000000000ll, 0ll, -2, "0.00" },  // exact zero
+   { 'm', 99999999999999999ll, 99999999999999999ll, 0, 99999999999999999ll, 99999999999999999ll, 0, "9.999999999999999999999999999999998E+67" },  // wide product
+   { 'm', 20000000000000000ll, 1ll, 0, 0ll, 5ll, 0, "1.000000000000000000000000000000000E+34" },  // product tie
+   { 'm', 33333333333333333ll, 33333333333333333ll, -34, 0ll, 3ll, 0, "0.9999999999999999999999999999999999" },  // mixed
+   { 'm', 0ll, -1999ll, -2, 123ll, 45678901234567890ll, -5, "-2467901212356790.1212110" },  // negative
+   { 'c', 99999999999999999ll, 99999999999999999ll, 0, 0ll, 1ll, 34, "-1" },  // less
+   { 'c', 10000000000000000ll, 0ll, -33, 0ll, 1ll, 0, "0" },  // equal, different scale
+   { 'c', -99999999999999999ll, -99999999999999999ll, 0, -99999999999999999ll, -99999999999999999ll, -1, "-1" },  // negative less
+};
+
+
+/**
+ * Check decimal arithmetic results against known answers: mixed exponents,
+ * exact ties, carries into a new digit, and full width coefficients.
+ * Exits the program on the first wrong result.
+ *
+ * @param[in] name   type name for the error message.
+ * @param[in] cases  the checks.
+ * @param[in] n      number of checks.
+ */
+template <typename T>
+static void
+bench_decimal_check(const c8 *name, const bench_dec_case *cases, u32 n)
+{
+   for ( u32 i = 0 ; i < n ; i++ )
+   {
+      const bench_dec_case *dc = &cases[i];
+      typename T::type a = T::big(dc->a_hi, dc->a_lo, dc->a_exp);
+      typename T::type b = T::big(dc->b_hi, dc->b_lo, dc->b_exp);
+      c8 buf[XYZ_DEC_STR_DIM];
+
+      switch ( dc->op )
+      {
+      case 'a' : T::str(T::add(a, b), buf, sizeof(buf)); break;
+      case 's' : T::str(T::sub(a, b), buf, sizeof(buf)); break;
+      case 'm' : T::str(T::mul(a, b), buf, sizeof(buf)); break;
+      default : snprintf(buf, sizeof(buf), "%d", T::cmp(a, b)); break;
+      }
+
+      if ( strcmp(buf, dc->expect) != 0 ) {
+         printf("decimal: %s check %u (%c), expected %s got %s\n", name, i, dc->op, dc->expect, buf);
+         exit(1);
+      }
+   }
+}
+// bench_decimal_check()
+
+
+/**
+ * UTF-8 validation and counting throughput, against memcpy of the same text.
+ *
+ * The text is mostly ASCII with two, three and four byte characters mixed
+ * in, like typical metadata.
+ *
+ * @param[in] op  0 validate and count, 1 count only, 2 memcpy.
+ *
+ * @return Bytes per second.
+ */
+static double
+bench_utf8(u32 op)
+{
+   static const c8 *words[6] = { "value ", "name ", "caf\xC3\xA9 ", "\xE2\x82\xAC" "12 ",
+                                 "\xF0\x9F\x98\x80 ", "0123456789 " };
+   std::vector<u8> text;
+   std::vector<u8> copy(BENCH_UTF8_DIM);
+
+   u64 rng = 0x9E3779B97F4A7C15ull;
+   while ( text.size() < BENCH_UTF8_DIM - 16 )
+   {
+      rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+      const c8 *w = words[(rng >> 32) % 6];
+      text.insert(text.end(), w, w + strlen(w));
+   }
+
+   u64 sum = 0;
+   auto start = std::chrono::steady_clock::now();
+
+   for ( u32 pass = 0 ; pass < BENCH_UTF8_PASSES ; pass++ )
+   {
+      u64 units = 0;
+      if ( op == 0 ) {
+         if ( xyz_utf8_units(text.data(), text.size(), &units) != XYZ_OK ) {
+            printf("utf8: text is not valid\n");
+            exit(1);
+         }
+      } else if ( op == 1 ) {
+         units = xyz_utf8_count(text.data(), text.size());
+      } else {
+         memcpy(copy.data(), text.data(), text.size());
+         units = copy[pass % text.size()];
+      }
+      sum += units;
+   }
+
+   std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+   bench_dec_sink = (double)sum;
+
+   return ((double)text.size() * BENCH_UTF8_PASSES) / secs.count();
+}
+// bench_utf8()
+
+
+/// A byte sequence for the UTF-8 checks, and whether it is well formed.
+struct bench_utf8_case {
+   const c8 *bytes;
+   bool valid;
+};
+
+static const bench_utf8_case bench_utf8_cases[] = {
+   { "\xC2\x80", true },                  // U+0080, first two byte
+   { "\xDF\xBF", true },                  // U+07FF
+   { "\xE0\xA0\x80", true },              // U+0800, first three byte
+   { "\xED\x9F\xBF", true },              // U+D7FF, below the surrogates
+   { "\xEE\x80\x80", true },              // U+E000, above the surrogates
+   { "\xEF\xBF\xBF", true },              // U+FFFF
+   { "\xF0\x90\x80\x80", true },          // U+10000, first four byte
+   { "\xF4\x8F\xBF\xBF", true },          // U+10FFFF, the last code point
+   { "\xC0\x80", false },                 // overlong U+0000
+   { "\xC1\xBF", false },                 // overlong U+007F
+   { "\xE0\x80\x80", false },             // overlong U+0000
+   { "\xE0\x9F\xBF", false },             // overlong U+07FF
+   { "\xF0\x80\x80\x80", false },         // overlong U+0000
+   { "\xF0\x8F\xBF\xBF", false },         // overlong U+FFFF
+   { "\xED\xA0\x80", false },             // U+D800, surrogate
+   { "\xED\xBF\xBF", false },             // U+DFFF, surrogate
+   { "\xF4\x90\x80\x80", false },         // U+110000
+   { "\xF5\x80\x80\x80", false },         // lead above F4
+   { "\xF7\xBF\xBF\xBF", false },         // U+1FFFFF
+   { "\xFF", false },                     // never valid
+   { "\x80", false },                     // continuation with no lead
+   { "\xC3\xA9\xA9", false },             // one continuation too many
+   { "\xC3", false },                     // truncated two byte
+   { "\xE2\x82", false },                 // truncated three byte
+   { "\xF0\x9F\x98", false },             // truncated four byte
+   { "\xF0\x9F", false },                 // truncated four byte
+   { "\xC3\x41", false },                 // lead followed by ASCII
+   { "\xE2\x41\x82", false },             // ASCII inside a sequence
+};
+
+
+/**
+ * Validate and count the same bytes at every SIMD level.
+ *
+ * @param[in] text   bytes.
+ * @param[in] len    length in bytes.
+ * @param[in] valid  expected validity.
+ * @param[in] what   description for the error message.
+ *
+ * Exits the program if a level gets the validity wrong, or the levels
+ * disagree on a count.
+ */
+static void
+bench_utf8_agree(const u8 *text, u64 len, bool valid, const c8 *what)
+{
+   u32 max = xyz_simd_level_set(XYZ_SIMD_AVX2);
+   u64 conts = 0;
+   for ( u64 i = 0 ; i < len ; i++ ) {
+      conts += ( (text[i] & 0xC0) == 0x80 ? 1 : 0 );
+   }
+
+   for ( u32 level = XYZ_SIMD_SCALAR ; level <= max ; level++ )
+   {
+      xyz_simd_level_set(level);
+
+      u64 units = 0;
+      bool ok = ( xyz_utf8_units(text, len, &units) == XYZ_OK );
+      u64 count = xyz_utf8_count(text, len);
+
+      if ( ok != valid || (ok == true && units != len - conts) || count != len - conts ) {
+         printf("utf8: %s, level %u said %s with %llu units, count %llu\n", what,
+               level, ( ok == true ? "valid" : "invalid" ),
+               (unsigned long long)units, (unsigned long long)count);
+         exit(1);
+      }
+   }
+
+   xyz_simd_level_set(max);
+}
+// bench_utf8_agree()
+
+
+/**
+ * Checks UTF-8 validation on invalid input, at every SIMD level.
+ *
+ * Each case is placed at every offset across two 32 byte blocks, so it
+ * sits inside a block, straddles the 16 and 32 byte block ends, and ends
+ * the buffer, in ASCII and in multibyte text.  Then bytes of the timed text
+ * are corrupted at random and the levels must agree with the scalar code.
+ * Exits the program on the first error.
+ */
+static void
+bench_utf8_check(void)
+{
+   static const c8 *fills[2] = { "abcd", "\xC3\xA9\xE2\x82\xAC" };
+   u8 buf[128];
+   c8 what[96];
+
+   for ( const bench_utf8_case &uc : bench_utf8_cases )
+   {
+      u32 n = (u32)strlen(uc.bytes);
+
+      for ( u32 f = 0 ; f < 2 ; f++ )
+      {
+         u32 flen = (u32)strlen(fills[f]);
+
+         for ( u32 at = 0 ; at <= 66 ; at++ )
+         {
+            // Whole fill characters up to the offset, so only the case can
+            // be invalid.
+            u32 pos = 0;
+            while ( pos + flen <= at ) { memcpy(buf + pos, fills[f], flen); pos += flen; }
+            while ( pos < at ) { buf[pos++] = 'x'; }
+
+            memcpy(buf + pos, uc.bytes, n);
+            pos += n;
+
+            // At the end of the buffer, then followed by more text.
+            snprintf(what, sizeof(what), "case %u at %u, fill %u, at the end",
+                  (u32)(&uc - bench_utf8_cases), at, f);
+            bench_utf8_agree(buf, pos, uc.valid, what);
+
+            while ( pos < sizeof(buf) - flen ) { memcpy(buf + pos, fills[f], flen); pos += flen; }
+            snprintf(what, sizeof(what), "case %u at %u, fill %u, then text",
+                  (u32)(&uc - bench_utf8_cases), at, f);
+            bench_utf8_agree(buf, pos, uc.valid, what);
+         }
+      }
+   }
+
+   // Random corruption, the scalar code decides what is valid.
+   static const c8 *words[4] = { "ab ", "caf\xC3\xA9 ", "\xE2\x82\xAC" "1 ", "\xF0\x9F\x98\x80 " };
+   u64 rng = 0x2545F4914F6CDD1Dull;
+   u32 max = xyz_simd_level_set(XYZ_SIMD_AVX2);
+
+   for ( u32 round = 0 ; round < 20000 ; round++ )
+   {
+      u32 len = 0;
+      while ( len < 100 ) {
+         rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+         const c8 *w = words[(rng >> 32) % 4];
+         memcpy(buf + len, w, strlen(w));
+         len += (u32)strlen(w);
+      }
+
+      rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+      buf[(rng >> 8) % len] = (u8)(rng >> 40);
+      len -= (u32)((rng >> 20) % 4);
+
+      xyz_simd_level_set(XYZ_SIMD_SCALAR);
+      bool valid = ( xyz_utf8_valid(buf, len) == XYZ_TRUE );
+      xyz_simd_level_set(max);
+
+      snprintf(what, sizeof(what), "random round %u", round);
+      bench_utf8_agree(buf, len, valid, what);
+   }
+}
+// bench_utf8_check()
+
+
+/// A parse case for the integer checks.
+struct bench_int_case {
+   const c8 *str;
+   u32 digits;    ///< Class: 4, 9 or 19.
+   bool ok;
+   s64 val;
+};
+
+static const bench_int_case bench_int_cases[] = {
+   { "", 4, false, 0 },  { "", 9, false, 0 },  { "", 19, false, 0 },
+   { "-", 4, false, 0 }, { "-", 9, false, 0 }, { "-", 19, false, 0 },
+   { "+", 4, false, 0 }, { "+", 9, false, 0 }, { "+", 19, false, 0 },
+   { "--1", 19, false, 0 },
+   { " 1", 19, false, 0 },
+   { "1 ", 19, false, 0 },
+   { "1-", 19, false, 0 },
+   { "12345678a", 19, false, 0 },               // bad digit after a SWAR chunk
+   { "1234567:", 19, false, 0 },                // ':' is '9' + 1
+   { "1234567/", 19, false, 0 },                // '/' is '0' - 1
+   { "0", 4, true, 0 },
+   { "-0", 4, true, 0 },
+   { "+7", 4, true, 7 },
+   { "9999", 4, true, 9999 },
+   { "-9999", 4, true, -9999 },
+   { "10000", 4, false, 0 },
+   { "-10000", 4, false, 0 },
+   { "00009999", 4, true, 9999 },               // leading zeros do not count
+   { "-000000000000000000009999", 4, true, -9999 },
+   { "00010000", 4, false, 0 },
+   { "0000", 4, true, 0 },
+   { "999999999", 9, true, 999999999 },
+   { "-999999999", 9, true, -999999999 },
+   { "1000000000", 9, false, 0 },
+   { "-1000000000", 9, false, 0 },
+   { "2147483647", 9, false, 0 },
+   { "000000000999999999", 9, true, 999999999 },
+   { "9223372036854775807", 19, true, INT64_MAX },
+   { "-9223372036854775807", 19, true, -INT64_MAX },
+   { "9223372036854775808", 19, false, 0 },
+   { "-9223372036854775808", 19, false, 0 },    // INT64_MIN
+   { "9999999999999999999", 19, false, 0 },
+   { "10000000000000000000", 19, false, 0 },
+   { "00000000000000000009223372036854775807", 19, true, INT64_MAX },
+   { "+0000000012345678", 19, true, 12345678 },
+};
+
+/// A grouping case for the integer checks.
+struct bench_int_sep_case {
+   u64 val;
+   c8 sep;
+   const c8 *str;
+};
+
+static const bench_int_sep_case bench_int_sep_cases[] = {
+   { 0, ',', "0" },
+   { 999, ',', "999" },
+   { 1000, ',', "1,000" },
+   { 12345, ',', "12,345" },
+   { 123456, ',', "123,456" },
+   { 1234567, '.', "1.234.567" },
+   { 1000000000, ',', "1,000,000,000" },
+   { 1234567, 0, "1234567" },
+   { UINT64_MAX, ',', "18,446,744,073,709,551,615" },
+   { UINT64_MAX, 0, "18446744073709551615" },
+};
+
+
+/**
+ * Parse with the function for a class.
+ *
+ * @param[in]  str     text.
+ * @param[in]  len     length of the text.
+ * @param[in]  digits  class, 4, 9 or 19.
+ * @param[out] v       value.
+ *
+ * @return XYZ_OK on success, otherwise XYZ_ERR.
+ */
+static s32
+bench_int_parse(const c8 *str, u32 len, u32 digits, s64 *v)
+{
+   s32 r = 0;
+   s32 rc;
+
+   switch ( digits )
+   {
+   case 4 : rc = xyz_str_to_s4(str, len, &r); *v = r; break;
+   case 9 : rc = xyz_str_to_s9(str, len, &r); *v = r; break;
+   default : rc = xyz_str_to_s19(str, len, v); break;
+   }
+
+   return rc;
+}
+// bench_int_parse()
+
+
+/**
+ * Format with the function for a class.
+ *
+ * @param[in]  v       value.
+ * @param[in]  digits  class, 4, 9 or 19.
+ * @param[out] buf     output, XYZ_INT_STR_DIM bytes.
+ *
+ * @return The length of the string, 0 if v is out of range.
+ */
+static u32
+bench_int_format(s64 v, u32 digits, c8 *buf)
+{
+   // The S4 and S9 functions take an s32, past that is out of range too.
+   if ( digits != 19 && (v < INT32_MIN || v > INT32_MAX) ) {
+      buf[0] = XYZ_NTERM;
+      return 0;
+   }
+
+   switch ( digits )
+   {
+   case 4 : return xyz_s4_to_str((s32)v, buf);
+   case 9 : return xyz_s9_to_str((s32)v, buf);
+   default : return xyz_s19_to_str(v, buf);
+   }
+}
+// bench_int_format()
+
+
+/**
+ * Checks integer formatting and parsing against snprintf and known answers.
+ *
+ * Round trips values of every digit count, and the values at and just past
+ * each class limit, through each class, checks the parse cases (empty and
+ * sign-only text, stray characters, leading zeros, limits), and the
+ * grouping of xyz_u64_to_str_sep().  Exits the program on the first error.
+ */
+static void
+bench_int_check(void)
+{
+   static const u32 classes[3] = { 4, 9, 19 };
+   static const u64 limits[3] = { XYZ_S4_MAX, XYZ_S9_MAX, XYZ_S19_MAX };
+   c8 buf[XYZ_INT_STR_DIM];
+   c8 ref[XYZ_INT_STR_DIM + 8];
+
+   // Values around every power of ten and every limit, then random ones.
+   std::vector<s64> vals = { 0, INT64_MAX, INT64_MIN, INT64_MIN + 1, INT32_MAX, INT32_MIN };
+   u64 p10 = 1;
+   for ( u32 d = 0 ; d < 19 ; d++, p10 *= 10 ) {
+      for ( s64 v : { (s64)p10 - 1, (s64)p10, (s64)p10 + 1 } ) {
+         vals.push_back(v);
+         vals.push_back(-v);
+      }
+   }
+
+   u64 rng = 0x9E3779B97F4A7C15ull;
+   for ( u32 i = 0 ; i < 20000 ; i++ ) {
+      rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+      s64 v = (s64)((rng >> 1) >> (rng % 63));
+      vals.push_back( (rng & 1) != 0 ? -v : v );
+   }
+
+   for ( s64 v : vals )
+   {
+      snprintf(ref, sizeof(ref), "%lld", (long long)v);
+
+      // The full range formats, INT64_MIN included.
+      u32 len = xyz_s64_to_str(v, buf);
+      if ( len != strlen(ref) || strcmp(buf, ref) != 0 ) {
+         printf("int: xyz_s64_to_str(%s) gave %s\n", ref, buf);
+         exit(1);
+      }
+
+      u64 u = (u64)v;
+      snprintf(ref, sizeof(ref), "%llu", (unsigned long long)u);
+      len = xyz_u64_to_str(u, buf);
+      if ( len != strlen(ref) || strcmp(buf, ref) != 0 ) {
+         printf("int: xyz_u64_to_str(%s) gave %s\n", ref, buf);
+         exit(1);
+      }
+
+      snprintf(ref, sizeof(ref), "%lld", (long long)v);
+      u64 mag = ( v < 0 ? (u64)0 - (u64)v : (u64)v );
+
+      for ( u32 c = 0 ; c < 3 ; c++ )
+      {
+         bool in = ( mag <= limits[c] );
+
+         len = bench_int_format(v, classes[c], buf);
+         if ( (in == true && (len != strlen(ref) || strcmp(buf, ref) != 0)) ||
+              (in == false && (len != 0 || buf[0] != XYZ_NTERM)) ) {
+            printf("int: S%u format of %s gave \"%s\" (%u)\n", classes[c], ref, buf, len);
+            exit(1);
+         }
+
+         s64 back = 0;
+         s32 rc = bench_int_parse(ref, (u32)strlen(ref), classes[c], &back);
+         if ( (in == true && (rc != XYZ_OK || back != v)) || (in == false && rc == XYZ_OK) ) {
+            printf("int: S%u parse of %s gave %d (%lld)\n", classes[c], ref, rc, (long long)back);
+            exit(1);
+         }
+      }
+   }
+
+   for ( const bench_int_case &ic : bench_int_cases )
+   {
+      s64 v = -1;
+      s32 rc = bench_int_parse(ic.str, (u32)strlen(ic.str), ic.digits, &v);
+      if ( (rc == XYZ_OK) != ic.ok || (ic.ok == true && v != ic.val) ) {
+         printf("int: S%u parse of \"%s\" gave %d (%lld)\n", ic.digits, ic.str, rc, (long long)v);
+         exit(1);
+      }
+   }
+
+   // The length excludes the text after it, "1234x" parses as 1234.
+   s64 v = 0;
+   if ( bench_int_parse("1234x", 4, 4, &v) != XYZ_OK || v != 1234 ) {
+      printf("int: parse stopped at the length\n");
+      exit(1);
+   }
+
+   for ( const bench_int_sep_case &sc : bench_int_sep_cases )
+   {
+      u32 len = xyz_u64_to_str_sep(sc.val, buf, sc.sep);
+      if ( len != strlen(sc.str) || strcmp(buf, sc.str) != 0 ) {
+         printf("int: xyz_u64_to_str_sep(%s) gave %s\n", sc.str, buf);
+         exit(1);
+      }
+   }
+}
+// bench_int_check()
+
+
+/**
+ * Integer formatting and parsing throughput, against snprintf and strtoll.
+ *
+ * The values are counter-like, spread over every digit count up to S19.
+ *
+ * @param[in] op  0 xyz_s19_to_str, 1 snprintf, 2 xyz_str_to_s19, 3 strtoll.
+ *
+ * @return Conversions per second.
+ */
+static double
+bench_int(u32 op)
+{
+   std::vector<s64> vals(BENCH_INT_DIM);
+   std::vector<c8> text((size_t)BENCH_INT_DIM * XYZ_INT_STR_DIM);
+   std::vector<u32> lens(BENCH_INT_DIM);
+
+   u64 rng = 0x9E3779B97F4A7C15ull;
+   for ( u32 i = 0 ; i < BENCH_INT_DIM ; i++ )
+   {
+      rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+      vals[i] = (s64)((rng >> 1) >> (rng % 63));
+      lens[i] = xyz_s19_to_str(vals[i], &text[(size_t)i * XYZ_INT_STR_DIM]);
+   }
+
+   c8 buf[XYZ_INT_STR_DIM];
+   u64 sum = 0;
+   auto start = std::chrono::steady_clock::now();
+
+   for ( u32 pass = 0 ; pass < BENCH_INT_PASSES ; pass++ )
+   {
+      for ( u32 i = 0 ; i < BENCH_INT_DIM ; i++ )
+      {
+         const c8 *str = &text[(size_t)i * XYZ_INT_STR_DIM];
+         s64 v = 0;
+
+         switch ( op )
+         {
+         case 0 : sum += xyz_s19_to_str(vals[i], buf); break;
+         case 1 : sum += (u64)snprintf(buf, sizeof(buf), "%lld", (long long)vals[i]); break;
+         case 2 : xyz_str_to_s19(str, lens[i], &v); sum += (u64)v; break;
+         default : sum += (u64)strtoll(str, NULL, 10); break;
+         }
+      }
+   }
+
+   std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+   bench_dec_sink = (double)sum;
+
+   return ((double)BENCH_INT_DIM * BENCH_INT_PASSES) / secs.count();
+}
+// bench_int()
+
+
+/**
+ * Fail the meta suite if a check is false.
+ *
+ * @param[in] ok    check result.
+ * @param[in] what  description of the check.
+ */
+static void
+bench_meta_expect(bool ok, const c8 *what)
+{
+   if ( ok == false ) {
+      printf("meta: %s\n", what);
+      exit(1);
+   }
+}
+// bench_meta_expect()
+
+
+/**
+ * Check a string meta value against the expected text and storage.
+ *
+ * @param[in] mt      meta value.
+ * @param[in] str     expected text.
+ * @param[in] units   expected unit_len.
+ * @param[in] format  expected XYZ_META_F_* format.
+ * @param[in] what    description for a failure.
+ */
+static void
+bench_meta_expect_str(const xyz_meta *mt, const c8 *str, u32 units, u16 format, const c8 *what)
+{
+   const c8 *p = (const c8 *)xyz_meta_ptr(mt);
+   bench_meta_expect(mt->format == format, what);
+   bench_meta_expect(p != NULL && strcmp(p, str) == 0, what);
+   bench_meta_expect(mt->byte_len == (u32)strlen(str), what);
+   bench_meta_expect(mt->unit_len == units, what);
+   bench_meta_expect(mt->byte_dim > mt->byte_len, what);
+   bench_meta_expect(mt->unit_dim == mt->byte_dim - 1, what);
+   if ( format == XYZ_META_F_INLINE ) {
+      bench_meta_expect(p == mt->buf.inl, what);
+   }
+}
+// bench_meta_expect_str()
+
+
+/**
+ * Check xyz_meta copy, move and free for every combination of source and
+ * destination storage: STATIC, DYNAMIC inline, DYNAMIC heap, FIXED, and
+ * numbers.  Exits the program on the first failure.
+ */
+static void
+bench_meta_check(void)
+{
+   static const c8 *inl_str = "short";
+   static const c8 *heap_str = "a string that is too long to be kept inline";
+   static const c8 *utf8_str = "caf\xC3\xA9";
+
+   xyz_meta src[5];
+   xyz_meta dst;
+   c8 src_fixed[64];
+   c8 dst_fixed[64];
+   c8 small_fixed[8];
+
+   // Integers record the value's digits, not the type's limit.
+   s64 si = -1234;
+   bench_meta_expect(xyz_meta_init(&dst, XYZ_META_T_INTEGER_S9, XYZ_META_P_STATIC, 0, &si) == XYZ_OK, "init S9");
+   bench_meta_expect(dst.unit_dim == 9 && dst.unit_len == 4, "S9 digits");
+   si = 0;
+   bench_meta_expect(xyz_meta_init(&dst, XYZ_META_T_INTEGER_S4, XYZ_META_P_STATIC, 0, &si) == XYZ_OK, "init S4");
+   bench_meta_expect(dst.unit_dim == 4 && dst.unit_len == 1, "S4 digits");
+   si = 10000;
+   bench_meta_expect(xyz_meta_init(&dst, XYZ_META_T_INTEGER_S4, XYZ_META_P_STATIC, 0, &si) == XYZ_ERR, "S4 limit");
+
+   // Sources, one per storage mode.
+   si = 987654321;
+   bench_meta_expect(xyz_meta_init(&src[0], XYZ_META_T_ASCII_VARCHAR, XYZ_META_P_STATIC, 0, inl_str) == XYZ_OK, "init STATIC");
+   bench_meta_expect(xyz_meta_init(&src[1], XYZ_META_T_ASCII_VARCHAR, XYZ_META_P_DYNAMIC, 0, inl_str) == XYZ_OK, "init inline");
+   bench_meta_expect(xyz_meta_init(&src[2], XYZ_META_T_ASCII_VARCHAR, XYZ_META_P_DYNAMIC, 0, heap_str) == XYZ_OK, "init heap");
+   bench_meta_expect(xyz_meta_init(&src[3], XYZ_META_T_ASCII_VARCHAR, XYZ_META_P_FIXED, sizeof(src_fixed), src_fixed) == XYZ_OK, "init FIXED");
+   bench_meta_expect(xyz_meta_init(&src[4], XYZ_META_T_INTEGER_S9, XYZ_META_P_STATIC, 0, &si) == XYZ_OK, "init S9");
+   bench_meta_expect(xyz_meta_copy(&src[3], &src[2]) == XYZ_OK, "copy into FIXED source");
+
+   bench_meta_expect_str(&src[0], inl_str, 5, XYZ_META_F_POINTER, "STATIC source");
+   bench_meta_expect_str(&src[1], inl_str, 5, XYZ_META_F_INLINE, "inline source");
+   bench_meta_expect_str(&src[2], heap_str, (u32)strlen(heap_str), XYZ_META_F_POINTER, "heap source");
+   bench_meta_expect_str(&src[3], heap_str, (u32)strlen(heap_str), XYZ_META_F_POINTER, "FIXED source");
+   bench_meta_expect(xyz_meta_ptr(&src[3]) == src_fixed, "FIXED source buffer");
+
+   // The format each source copies to in a non-FIXED destination.
+   static const u16 formats[4] = { XYZ_META_F_POINTER, XYZ_META_F_INLINE,
+                                   XYZ_META_F_POINTER, XYZ_META_F_POINTER };
+
+   for ( u32 d = 0 ; d < 4 ; d++ )
+   {
+      for ( u32 s = 0 ; s < 5 ; s++ )
+      {
+         // Destination: 0 zeroed, 1 inline, 2 heap, 3 FIXED.
+         memset(&dst, 0, sizeof(dst));
+         if ( d == 1 ) { xyz_meta_init(&dst, XYZ_META_T_UTF8_VARCHAR, XYZ_META_P_DYNAMIC, 0, "old"); }
+         if ( d == 2 ) { xyz_meta_init(&dst, XYZ_META_T_UTF8_VARCHAR, XYZ_META_P_DYNAMIC, 100, "old"); }
+         if ( d == 3 ) { xyz_meta_init(&dst, XYZ_META_T_UTF8_CHAR, XYZ_META_P_FIXED, sizeof(dst_fixed), dst_fixed); }
+
+         bench_meta_expect(xyz_meta_copy(&dst, &src[s]) == XYZ_OK, "copy");
+         bench_meta_expect(dst.type == src[s].type, "copy type");
+
+         if ( s == 4 ) {
+            bench_meta_expect(dst.format == XYZ_META_F_SINT && dst.buf.si == si, "copy number");
+            bench_meta_expect(dst.unit_len == 9 && dst.unit_dim == 9, "copy number digits");
+         } else if ( d == 3 ) {
+            // A FIXED destination keeps its own buffer and dimension.
+            bench_meta_expect_str(&dst, (const c8 *)xyz_meta_ptr(&src[s]), src[s].unit_len,
+                  XYZ_META_F_POINTER, "copy into FIXED");
+            bench_meta_expect(xyz_meta_ptr(&dst) == dst_fixed, "copy into FIXED buffer");
+            bench_meta_expect(dst.alloc == XYZ_META_P_FIXED && dst.byte_dim == sizeof(dst_fixed), "copy into FIXED dim");
+         } else {
+            bench_meta_expect_str(&dst, (const c8 *)xyz_meta_ptr(&src[s]), src[s].unit_len,
+                  formats[s], "copy");
+            if ( s == 0 ) {
+               bench_meta_expect(xyz_meta_ptr(&dst) == xyz_meta_ptr(&src[0]), "copy STATIC shared");
+            } else {
+               bench_meta_expect(xyz_meta_ptr(&dst) != xyz_meta_ptr(&src[s]), "copy independent");
+               bench_meta_expect(dst.alloc == XYZ_META_P_DYNAMIC, "copy alloc");
+               bench_meta_expect(dst.byte_dim == src[s].byte_dim, "copy dim");
+            }
+         }
+
+         // Moving the copy on leaves it empty, and the data unchanged.
+         xyz_meta moved;
+         memset(&moved, 0, sizeof(moved));
+         xyz_meta_move(&moved, &dst);
+         bench_meta_expect(dst.format == XYZ_META_F_NOTVALID && xyz_meta_ptr(&dst) == NULL, "move source empty");
+         bench_meta_expect(moved.type == src[s].type, "move type");
+         if ( s != 4 ) {
+            bench_meta_expect(strcmp((const c8 *)xyz_meta_ptr(&moved), (const c8 *)xyz_meta_ptr(&src[s])) == 0, "move data");
+         }
+
+         xyz_meta_free(&moved);
+         bench_meta_expect(moved.format == XYZ_META_F_NOTVALID && moved.type == XYZ_META_T_UNDEF, "free");
+         xyz_meta_free(&dst);
+      }
+   }
+
+   // A copy into FIXED takes the source's units, and must fit.
+   bench_meta_expect(xyz_meta_init(&dst, XYZ_META_T_ASCII_CHAR, XYZ_META_P_FIXED, sizeof(small_fixed), small_fixed) == XYZ_OK, "init small FIXED");
+   xyz_meta_free(&src[1]);
+   bench_meta_expect(xyz_meta_init(&src[1], XYZ_META_T_UTF8_VARCHAR, XYZ_META_P_DYNAMIC, 0, utf8_str) == XYZ_OK, "init UTF8");
+   bench_meta_expect(xyz_meta_copy(&dst, &src[1]) == XYZ_OK, "copy UTF8 into FIXED");
+   bench_meta_expect_str(&dst, utf8_str, 4, XYZ_META_F_POINTER, "copy UTF8 into FIXED");
+   bench_meta_expect(dst.type == XYZ_META_T_UTF8_VARCHAR && dst.unit_dim == sizeof(small_fixed) - 1, "copy UTF8 into FIXED dim");
+   bench_meta_expect(xyz_meta_copy(&dst, &src[2]) == XYZ_ERR, "copy into small FIXED");
+   bench_meta_expect_str(&dst, utf8_str, 4, XYZ_META_F_POINTER, "failed copy leaves FIXED unchanged");
+
+   // A DYNAMIC copy of a FIXED source does not follow later writes to it.
+   bench_meta_expect(xyz_meta_copy(&dst, &src[3]) == XYZ_ERR, "copy long FIXED into small FIXED");
+   xyz_meta copy;
+   memset(&copy, 0, sizeof(copy));
+   bench_meta_expect(xyz_meta_copy(&copy, &src[3]) == XYZ_OK, "copy FIXED");
+   src_fixed[0] = 'A';
+   bench_meta_expect(strcmp((const c8 *)xyz_meta_ptr(&copy), heap_str) == 0, "copy of FIXED independent");
+
+   // Self copy and move are no-ops.
+   bench_meta_expect(xyz_meta_copy(&copy, &copy) == XYZ_OK, "self copy");
+   xyz_meta_move(&copy, &copy);
+   bench_meta_expect(strcmp((const c8 *)xyz_meta_ptr(&copy), heap_str) == 0, "self copy and move");
+
+   xyz_meta_free(&copy);
+   xyz_meta_free(&dst);
+   for ( u32 s = 0 ; s < 5 ; s++ ) { xyz_meta_free(&src[s]); }
+}
+// bench_meta_check()
+
+
+/**
+ * Meta value copy throughput, by source storage.
+ *
+ * @param[in] op  0 STATIC, 1 DYNAMIC inline, 2 DYNAMIC heap, 3 into FIXED.
+ *
+ * @return Copies per second.
+ */
+static double
+bench_meta(u32 op)
+{
+   static const c8 *inl_str = "short";
+   static const c8 *heap_str = "a string that is too long to be kept inline";
+
+   xyz_meta src;
+   xyz_meta dst;
+   c8 fixed[64];
+
+   xyz_meta_init(&src, XYZ_META_T_ASCII_VARCHAR, ( op == 0 ? XYZ_META_P_STATIC : XYZ_META_P_DYNAMIC ),
+         0, ( op == 1 ? inl_str : heap_str ));
+   memset(&dst, 0, sizeof(dst));
+   if ( op == 3 ) {
+      xyz_meta_init(&dst, XYZ_META_T_ASCII_VARCHAR, XYZ_META_P_FIXED, sizeof(fixed), fixed);
+   }
+
+   u64 sum = 0;
+   auto start = std::chrono::steady_clock::now();
+
+   for ( u32 i = 0 ; i < BENCH_META_OPS ; i++ )
+   {
+      if ( xyz_meta_copy(&dst, &src) != XYZ_OK ) {
+         printf("meta: copy failed\n");
+         exit(1);
+      }
+      sum += dst.byte_len;
+   }
+
+   std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+   bench_dec_sink = (double)sum;
+
+   xyz_meta_free(&dst);
+   xyz_meta_free(&src);
+
+   return (double)BENCH_META_OPS / secs.count();
+}
+// bench_meta()
+
+
+/**
+ * Main.
+ *
+ * Options:
+ *
+ *   --csv   print the results as CSV: suite,name,param,metric,value
+ *
+ * @param argc
+ * @param argv
+ *
+ * @return 0 on success, otherwise 1.
+ */
+int
+main(int argc, char *argv[])
+{
+   for ( s32 i = 1 ; i < argc ; i++ )
+   {
+      if ( strcmp(argv[i], "--csv") == 0 ) {
+         bench_csv = true;
+      } else {
+         printf("usage: %s [--csv]\n", argv[0]);
+         return 1;
+      }
+   }
+
+   if ( bench_csv == true ) {
+      printf("suite,name,param,metric,value\n");
+   } else {
+      printf("%-8s %-12s %6s %-10s %16s\n", "suite", "name", "param", "metric", "value");
+   }
+
+   // Cross-thread ordering of the original RBAM, at the full and empty
+   // boundaries.
+   static const u32 stress_dims[] = { 2, 3, 64 };
+   for ( u32 d : stress_dims ) {
+      bench_report("stress", "rbam", d, "ops_sec", bench_stress(d));
+   }
+
+   // The RBOW writer lapping its readers, every element accounted for.
+   static const u32 rbow_dims[] = { 2, 64 };
+   for ( u32 d : rbow_dims )
+   {
+      u64 lost, torn;
+      double rbow = bench_stress_rbow(d, &lost, &torn);
+      bench_report("stress", "rbow", d, "ops_sec", rbow);
+      bench_report("stress", "rbow", d, "lost", (double)lost);
+      bench_report("stress", "rbow", d, "torn", (double)torn);
+   }
+
+   // RBVL records of mixed sizes, pads at the wrap, then the mirrored
+   // buffer when the system can make one.
+   {
+      static u64 rbvl_buf[BENCH_RBVL_DIM / sizeof(u64)];
+      xyz_rbvl rbvl;
+      u64 skips;
+
+      xyz_rbvl_init(&rbvl, (u8 *)rbvl_buf, BENCH_RBVL_DIM, 0);
+      bench_rbvl_check(&rbvl, "rbvl");
+      double plain = bench_stress_rbvl(&rbvl, &skips);
+      bench_report("stress", "rbvl", BENCH_RBVL_DIM, "ops_sec", plain);
+      bench_report("stress", "rbvl", BENCH_RBVL_DIM, "pads", (double)skips);
+
+      u64 dim = BENCH_RBVL_DIM;
+      u8 *mbuf = xyz_vmirror_alloc(&dim);
+      if ( mbuf != NULL )
+      {
+         xyz_rbvl_init(&rbvl, mbuf, dim, XYZ_RBVL_F_MIRROR);
+         bench_rbvl_check(&rbvl, "rbvl mirror");
+         double mirror = bench_stress_rbvl(&rbvl, &skips);
+         bench_report("stress", "rbvl_mirror", (u32)dim, "ops_sec", mirror);
+         bench_report("stress", "rbvl_mirror", (u32)dim, "straddles", (double)skips);
+         xyz_vmirror_free(mbuf, dim);
+      }
+   }
+
+   // Single-writer single-reader throughput, relative to the original RBAM.
+   double rbam = bench_spsc<bench_rbam>("rbam");
+   double rbam_p2 = bench_spsc<bench_rbam_p2>("rbam_p2");
+   double rbam_cl = bench_spsc<bench_rbam_cl>("rbam_cl");
+   bench_ring_check();
+   double ring = bench_ring_spsc();
+
+   bench_report("spsc", "rbam", 1, "ops_sec", rbam);
+   bench_report("spsc", "rbam_p2", 1, "ops_sec", rbam_p2);
+   bench_report("spsc", "rbam_p2", 1, "gain", rbam_p2 / rbam);
+   bench_report("spsc", "rbam_cl", 1, "ops_sec", rbam_cl);
+   bench_report("spsc", "rbam_cl", 1, "gain", rbam_cl / rbam);
+   bench_report("spsc", "xyz::ring", 1, "ops_sec", ring);
+   bench_report("spsc", "xyz::ring", 1, "gain", ring / rbam);
+
+   // Batch versus single element index updates, param is the batch size.
+   static const u32 batches[] = { 1, 8, 64 };
+   for ( u32 b : batches )
+   {
+      double batch = bench_spsc_batch(b);
+      bench_report("batch", "rbam", b, "ops_sec", batch);
+      bench_report("batch", "rbam", b, "gain", batch / rbam);
+   }
+
+   // Padded versus unpadded counters, the same ring with and without the
+   // read and write counters on separate cache lines.
+   double unpadded = bench_spsc<bench_layout<1> >("unpadded");
+   double padded = bench_spsc<bench_layout<XYZ_CACHE_LINE * 2> >("padded");
+   bench_report("layout", "unpadded", 1, "ops_sec", unpadded);
+   bench_report("layout", "padded", 1, "ops_sec", padded);
+   bench_report("layout", "padded", 1, "gain", padded / unpadded);
+
+   // Cross-core hand-off latency.
+   bench_latency<bench_rbam>("rbam");
+   bench_latency<bench_rbam_p2>("rbam_p2");
+   bench_latency<bench_rbam_cl>("rbam_cl");
+
+   // Contention across 1..N producer/consumer thread pairs.
+   u32 threads_max = std::thread::hardware_concurrency();
+   if ( threads_max < 2 ) { threads_max = 2; }
+   if ( threads_max > BENCH_MPMC_THREADS_MAX ) { threads_max = BENCH_MPMC_THREADS_MAX; }
+
+   for ( u32 threads = 1 ; threads <= threads_max ; threads++ )
+   {
+      double mpam = bench_mpmc<bench_mpam>("mpam", threads);
+      double mutex = bench_mpmc<bench_mutex_rbam>("mutex_rbam", threads);
+      bench_report("mpmc", "mpam", threads, "ops_sec", mpam);
+      bench_report("mpmc", "mutex_rbam", threads, "ops_sec", mutex);
+      bench_report("mpmc", "mpam", threads, "gain", mpam / mutex);
+   }
+
+   // Console style ingest, producers that never wait and one consumer that
+   // sleeps until lines are queued, drops are per producer.
+   for ( u32 threads = 1 ; threads <= threads_max ; threads++ )
+   {
+      u64 drops;
+      double ingest = bench_ingest(threads, &drops);
+      bench_report("ingest", "mpam", threads, "ops_sec", ingest);
+      bench_report("ingest", "mpam", threads, "drops", (double)drops);
+   }
+
+   // Small block allocation, pool versus malloc.
+   for ( u32 threads = 1 ; threads <= threads_max ; threads++ )
+   {
+      double pool = bench_alloc(true, threads);
+      double heap = bench_alloc(false, threads);
+      bench_report("alloc", "pool", threads, "ops_sec", pool);
+      bench_report("alloc", "malloc", threads, "ops_sec", heap);
+      bench_report("alloc", "pool", threads, "gain", pool / heap);
+   }
+
+   // Decimal arithmetic results, then the cost relative to double.
+   bench_decimal_check<bench_d64>("d64", bench_d64_cases, sizeof(bench_d64_cases) / sizeof(bench_d64_cases[0]));
+   bench_decimal_check<bench_d128>("d128", bench_d128_cases, sizeof(bench_d128_cases) / sizeof(bench_d128_cases[0]));
+
+   static const c8 *dec_ops[4] = { "add", "mixed", "mul", "cmp" };
+   for ( u32 op = 0 ; op < 4 ; op++ )
+   {
+      c8 name[32];
+      double d64 = bench_decimal<bench_d64>(op);
+      double d128 = bench_decimal<bench_d128>(op);
+      double dbl = bench_decimal<bench_double>(op);
+      snprintf(name, sizeof(name), "d64_%s", dec_ops[op]);
+      bench_report("decimal", name, 1, "ops_sec", d64);
+      bench_report("decimal", name, 1, "vs_double", d64 / dbl);
+      snprintf(name, sizeof(name), "d128_%s", dec_ops[op]);
+      bench_report("decimal", name, 1, "ops_sec", d128);
+      bench_report("decimal", name, 1, "vs_double", d128 / dbl);
+      snprintf(name, sizeof(name), "double_%s", dec_ops[op]);
+      bench_report("decimal", name, 1, "ops_sec", dbl);
+   }
+
+   // UTF-8 validation and counting, relative to memcpy.
+   bench_utf8_check();
+   double utf8_valid = bench_utf8(0);
+   double utf8_count = bench_utf8(1);
+   double utf8_copy = bench_utf8(2);
+   bench_report("utf8", "valid", xyz_simd_level(), "bytes_sec", utf8_valid);
+   bench_report("utf8", "valid", xyz_simd_level(), "vs_memcpy", utf8_valid / utf8_copy);
+   bench_report("utf8", "count", xyz_simd_level(), "bytes_sec", utf8_count);
+   bench_report("utf8", "count", xyz_simd_level(), "vs_memcpy", utf8_count / utf8_copy);
+   bench_report("utf8", "memcpy", xyz_simd_level(), "bytes_sec", utf8_copy);
+
+   // Integer formatting and parsing, relative to the C library.
+   bench_int_check();
+   double int_fmt = bench_int(0);
+   double int_printf = bench_int(1);
+   double int_parse = bench_int(2);
+   double int_strtoll = bench_int(3);
+   bench_report("int", "format", 1, "ops_sec", int_fmt);
+   bench_report("int", "snprintf", 1, "ops_sec", int_printf);
+   bench_report("int", "format", 1, "gain", int_fmt / int_printf);
+   bench_report("int", "parse", 1, "ops_sec", int_parse);
+   bench_report("int", "strtoll", 1, "ops_sec", int_strtoll);
+   bench_report("int", "parse", 1, "gain", int_parse / int_strtoll);
+
+   // Meta value copy, move and free checks, then copy cost by storage mode.
+   bench_meta_check();
+   static const c8 *meta_ops[4] = { "static", "inline", "heap", "fixed" };
+   for ( u32 op = 0 ; op < 4 ; op++ ) {
+      bench_report("meta", meta_ops[op], 1, "ops_sec", bench_meta(op));
+   }
+
+   return 0;
+}
+// main()
+
+
+/*
+------------------------------------------------------------------------------
+This software is available under 2 licenses -- choose whichever you prefer.
+------------------------------------------------------------------------------
+ALTERNATIVE A - MIT License
+Copyright (c) 2020 Matthew Hagerty
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------------
+ALTERNATIVE B - Public Domain (www.unlicense.org)
+This is free and unencumbered software released into the public domain.
+Anyone is free to copy, modify, publish, use, compile, sell, or distribute this
+software, either in source code form or as a compiled binary, for any purpose,
+commercial or non-commercial, and by any means.
+In jurisdictions that recognize copyright laws, the author or authors of this
+software dedicate any and all copyright interest in the software to the public
+domain. We make this dedication for the benefit of the public at large and to
+the detriment of our heirs and successors. We intend this dedication to be an
+overt act of relinquishment in perpetuity of all present and future rights to
+this software under copyright law.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+------------------------------------------------------------------------------
+*/
@@ -12,14 +12,33 @@
 #include "SDL.h"
 #include "imgui.h"
 #include "program.h"
+#include "xyz_ring.h"
 #include "stb_sprintf.h"    // stbsp_snprintf
 #include "math.h"
+#include <stdlib.h>         // qsort
 
 
 // Draw the graphic console.  This is local to the program it will most likely
 // be highly customized.
 static void imgui_console_window(progdata_s *pd);
 
+#if defined(XYZ_MEM_TRACK)
+// Heap statistics per call site, only with memory tracking.
+static void imgui_heap_window(progdata_s *pd);
+#endif
+
+/// One line of overlay text, built from labels and counters and drawn with
+/// TextUnformatted(), so the counters redrawn every frame skip printf.
+typedef struct unused_tag_textline_s {
+   c8  buf[256];
+   u32 len;
+} textline_s;
+
+// Text line building for the per-frame counters.
+static void textline_str(textline_s *tl, const c8 *str);
+static void textline_pad(textline_s *tl, u32 col);
+static void textline_u64(textline_s *tl, u64 v, c8 sep);
+
 
 
 /// Moving point structure for the line example.
@@ -34,6 +53,9 @@ typedef struct unused_tag_linept_s {
 typedef struct unused_tag_pos_s {
    ImVec2 pt1;
    ImVec2 pt2;
+
+   unused_tag_pos_s(const linept_s &p1, const linept_s &p2)
+      : pt1((float)p1.x, (float)p1.y), pt2((float)p2.x, (float)p2.y) {}
 } pos_s;
 
 
@@ -48,6 +70,13 @@ imgui_draw(progdata_s *pd)
    static bool show_gconsole = false;
    static bool show_demo = false;
    static bool show_ball = true;
+#if defined(XYZ_MEM_TRACK)
+   static bool show_heap = false;
+#endif
+   static bool show_trail = true;
+   static xyz_rbow_rd trail_rd;
+   static bool trail_rd_init = false;
+   static xyz::ring<mousesample_s, MOUSE_TRAIL_DIM> trail;
 
    static float speed = 0.5;
    static u32 max_pts = 30;
@@ -76,6 +105,10 @@ imgui_draw(progdata_s *pd)
       ImGui::Checkbox("Demo", &show_demo);
       ImGui::SameLine();
       ImGui::Checkbox("Ball", &show_ball);
+#if defined(XYZ_MEM_TRACK)
+      ImGui::SameLine();
+      ImGui::Checkbox("Heap", &show_heap);
+#endif
 
       ImGui::SliderInt("##Lines", (s32 *)&max_pts, 2, 300, "Lines %d");
       ImGui::SameLine();
@@ -90,12 +123,138 @@ imgui_draw(progdata_s *pd)
       } else {
          ImGui::Text("Mouse: N/A");
       }
+
+      ImGui::Checkbox("Mouse Trail", &show_trail);
+
+      textline_s tl;
+      tl.len = 0;
+      textline_str(&tl, "Mouse samples: read ");
+      textline_u64(&tl, trail_rd.reads, 0);
+      textline_str(&tl, "  lost ");
+      textline_u64(&tl, trail_rd.lost, 0);
+      textline_str(&tl, "  torn ");
+      textline_u64(&tl, trail_rd.torn, 0);
+      ImGui::TextUnformatted(tl.buf, tl.buf + tl.len);
+
+      xyz_evc *ev = &(pd->disco.wake);
+      u64 parks = xyz_atomic_ld_rlx_u64(&ev->stats.parks);
+      u64 lat_total = xyz_atomic_ld_rlx_u64(&ev->stats.wake_ns_total);
+      tl.len = 0;
+      textline_str(&tl, "Wake: parks ");
+      textline_u64(&tl, parks, 0);
+      textline_str(&tl, "  spins ");
+      textline_u64(&tl, xyz_atomic_ld_rlx_u64(&ev->stats.spin_hits), 0);
+      textline_str(&tl, "  timeouts ");
+      textline_u64(&tl, xyz_atomic_ld_rlx_u64(&ev->stats.timeouts), 0);
+      ImGui::TextUnformatted(tl.buf, tl.buf + tl.len);
+      ImGui::Text("Wake: calls %llu  avoided %llu  lat avg %.1fus max %.1fus",
+            (unsigned long long)xyz_atomic_ld_rlx_u64(&ev->stats.wakes),
+            (unsigned long long)xyz_atomic_ld_rlx_u64(&ev->stats.wakes_avoided),
+            (parks > 0 ? (double)lat_total / (double)parks / 1000.0 : 0.0),
+            (double)xyz_atomic_ld_rlx_u64(&ev->stats.wake_ns_max) / 1000.0);
+
+      // The frame arena is reset after the frame is swapped, so the current
+      // use only covers this frame so far.  The peak is the useful number.
+      xyz_arena *frame = pd->mem.frame;
+      if ( frame != NULL ) {
+         tl.len = 0;
+         textline_str(&tl, "Frame arena: peak ");
+         textline_u64(&tl, frame->peak, ',');
+         textline_str(&tl, "/");
+         textline_u64(&tl, frame->dim, ',');
+         textline_str(&tl, " bytes  fails ");
+         textline_u64(&tl, frame->fails, 0);
+         ImGui::TextUnformatted(tl.buf, tl.buf + tl.len);
+      }
+
+      // A steady frame makes no ImGui allocations, a spike here is usually
+      // a draw list or window growing.
+      imguimem_s *im = &(pd->mem.imgui);
+      tl.len = 0;
+      textline_str(&tl, "ImGui heap: ");
+      textline_u64(&tl, xyz_atomic_ld_rlx_u64(&(im->live_bytes)), ',');
+      textline_str(&tl, " bytes  peak ");
+      textline_u64(&tl, xyz_atomic_ld_rlx_u64(&(im->peak_bytes)), ',');
+      textline_str(&tl, "  allocs/frame ");
+      textline_u64(&tl, im->last_frame_allocs, 0);
+      textline_str(&tl, "  max ");
+      textline_u64(&tl, im->max_frame_allocs, 0);
+      ImGui::TextUnformatted(tl.buf, tl.buf + tl.len);
+
+      for ( u32 i = 0 ; i < THEAP_DIM ; i++ )
+      {
+         xyz_theap *th = &(pd->mem.heap[i]);
+         if ( th->name == NULL ) { continue; }
+         tl.len = 0;
+         textline_str(&tl, th->name);
+         textline_pad(&tl, 7);
+         textline_str(&tl, " heap: allocs ");
+         textline_u64(&tl, th->stats.allocs, 0);
+         textline_str(&tl, "  frees ");
+         textline_u64(&tl, th->stats.frees, 0);
+         textline_str(&tl, "  remote ");
+         textline_u64(&tl, xyz_atomic_ld_rlx_u64(&th->remote_frees), 0);
+         textline_str(&tl, "  direct ");
+         textline_u64(&tl, xyz_atomic_ld_rlx_u64(&th->direct_frees), 0);
+         textline_str(&tl, "  large ");
+         textline_u64(&tl, th->stats.large, 0);
+         textline_str(&tl, "  spills ");
+         textline_u64(&tl, th->stats.spills, 0);
+         textline_str(&tl, "  live ");
+         textline_u64(&tl, th->stats.live_bytes, ',');
+         ImGui::TextUnformatted(tl.buf, tl.buf + tl.len);
+      }
    }
    ImGui::End();
 
    // The demo-window is nice to have for development and documentation.
    if ( show_demo == true ) { ImGui::ShowDemoWindow(&show_demo); };
    if ( show_gconsole == true ) { imgui_console_window(pd); }
+#if defined(XYZ_MEM_TRACK)
+   if ( show_heap == true ) { imgui_heap_window(pd); }
+#endif
+
+
+   // Draw the mouse trail from the newest telemetry samples.  The cursor
+   // is set up once and each frame only reads the samples written since
+   // the last, so the read count is samples, not frames.  The event loop
+   // keeps writing while this reads, any sample it overwrites first is
+   // counted as lost.
+   //
+   u64 pos;
+
+   if ( trail_rd_init == false ) {
+      xyz_rbow_rd_init(&(pd->mouse.rbow), &trail_rd, MOUSE_TRAIL_DIM);
+      trail_rd_init = true;
+   }
+
+   while ( xyz_rbow_peek(&(pd->mouse.rbow), &trail_rd, &pos) == XYZ_TRUE )
+   {
+      mousesample_s sample = pd->mouse.sample[xyz_rbow_idx(&(pd->mouse.rbow), pos)];
+      if ( xyz_rbow_consume(&(pd->mouse.rbow), &trail_rd, pos) == XYZ_TRUE ) {
+         if ( trail.is_full() ) { trail.pop(); }
+         trail.emplace(sample);
+      }
+   }
+
+   if ( show_trail == true && trail.used() > 1 )
+   {
+      ImDrawList *fg = ImGui::GetForegroundDrawList();
+      const mousesample_s *prev = NULL;
+      u32 i = 0;
+      for ( const mousesample_s &pt : trail )
+      {
+         if ( prev != NULL ) {
+            u32 alpha = (255 * i) / trail.used();
+            fg->AddLine(
+                  ImVec2(view->Pos.x + (float)prev->x, view->Pos.y + (float)prev->y),
+                  ImVec2(view->Pos.x + (float)pt.x, view->Pos.y + (float)pt.y),
+                  IM_COL32(255, 255, 0, alpha), 2.0f);
+         }
+         prev = &pt;
+         i++;
+      }
+   }
 
 
    // Draw a bouncing box on the foreground.
@@ -142,9 +301,8 @@ imgui_draw(progdata_s *pd)
    s32 size = 600;
    float thickness = 2.0f;
 
-   static xyz_rbam rbam;
-   #define PT_ARRAY 302
-   static pos_s points[PT_ARRAY];
+   #define PT_ARRAY 512
+   static xyz::ring<pos_s, PT_ARRAY> points;
    static linept_s pt1;
    static linept_s pt2;
 
@@ -153,7 +311,6 @@ imgui_draw(progdata_s *pd)
 
    if ( is_init == false )
    {
-      xyz_rbam_init(&rbam, PT_ARRAY);
       pt1.x = ox; pt1.y = oy;      pt1.dx = 0;    pt1.dy = step;
       pt2.x = ox; pt2.y = oy+size; pt2.dx = step; pt2.dy = 0;
       is_init = true;
@@ -163,15 +320,13 @@ imgui_draw(progdata_s *pd)
    {
       rate = 0.0f;
 
-      // Clear a point if necessary.
-      while ( xyz_rbam_is_full(&rbam) == XYZ_TRUE || rbam.used > max_pts ) {
-         xyz_rbam_read(&rbam);
+      // Clear points if necessary, leaving room for the new one.
+      if ( points.used() >= max_pts ) {
+         points.pop(points.used() - max_pts + 1);
       }
 
       // Add a new point.
-      points[rbam.wr].pt1 = ImVec2((float)pt1.x, (float)pt1.y);
-      points[rbam.wr].pt2 = ImVec2((float)pt2.x, (float)pt2.y);
-      xyz_rbam_write(&rbam);
+      points.emplace(pt1, pt2);
 
       // Update the points.
       pt1.x += pt1.dx; pt1.y += pt1.dy;
@@ -189,13 +344,11 @@ imgui_draw(progdata_s *pd)
 
    rate += speed;
 
-   // Draw the points.
+   // Draw the points, oldest first.
    u32 col = 255;
-
-   for ( u32 i = rbam.rd ; i != rbam.wr ; )
+   for ( const pos_s &pt : points )
    {
-      bg->AddLine(points[i].pt1, points[i].pt2, IM_COL32(0, 0, col, 255), thickness);
-      i = xyz_rbam_next(&rbam, i);
+      bg->AddLine(pt.pt1, pt.pt2, IM_COL32(0, 0, col, 255), thickness);
       col = (col < 10) ? 255 : (col - 10);
    }
 
@@ -203,6 +356,55 @@ imgui_draw(progdata_s *pd)
 // imgui_draw()
 
 
+/**
+ * Append a string to a text line, truncated to fit.
+ *
+ * @param[in,out] tl   Text line.
+ * @param[in]     str  Terminated string.
+ */
+static void
+textline_str(textline_s *tl, const c8 *str)
+{
+   while ( *str != XYZ_NTERM && tl->len < sizeof(tl->buf) - 1 ) {
+      tl->buf[tl->len++] = *str++;
+   }
+}
+// textline_str()
+
+
+/**
+ * Pad a text line with spaces up to a column, like %-Ns.
+ *
+ * @param[in,out] tl   Text line.
+ * @param[in]     col  Column to pad to.
+ */
+static void
+textline_pad(textline_s *tl, u32 col)
+{
+   while ( tl->len < col && tl->len < sizeof(tl->buf) - 1 ) {
+      tl->buf[tl->len++] = ' ';
+   }
+}
+// textline_pad()
+
+
+/**
+ * Append a counter to a text line, dropped if it does not fit.
+ *
+ * @param[in,out] tl   Text line.
+ * @param[in]     v    Value.
+ * @param[in]     sep  Thousands separator, or 0 for none.
+ */
+static void
+textline_u64(textline_s *tl, u64 v, c8 sep)
+{
+   if ( tl->len + XYZ_INT_STR_DIM <= sizeof(tl->buf) ) {
+      tl->len += xyz_u64_to_str_sep(v, tl->buf + tl->len, sep);
+   }
+}
+// textline_u64()
+
+
 /**
  * Display the graphic console.
  *
@@ -220,12 +422,17 @@ imgui_console_window(progdata_s *pd)
    ImVec2 sz = ImGui::GetWindowSize();
    ImGui::Text("Window Size: %.0f,%.0f", sz.x, sz.y);
 
-   u32 rdpos = pd->cons.linelist[pd->cons.rbam.rd].pos;
-   u32 wrpos = pd->cons.linelist[pd->cons.rbam.wr].pos;
-   u32 bufuse = rdpos <= wrpos ?
-         wrpos - rdpos : (pd->cons.bufdim - rdpos) + wrpos;
-   ImGui::Text("Console lines: %'u/%'u  Buffer: %_$u/%_$u"
-         , pd->cons.rbam.used, (pd->cons.rbam.dim - 1), bufuse, pd->cons.bufdim);
+   u32 bufuse = (u32)xyz_rbvl_used(&(pd->cons.rbvl));
+   ImGui::Text("Console lines: %'u/%'u  Buffer: %_$u/%_$u%s"
+         , pd->cons.rbam.used, (pd->cons.rbam.dim - 1), bufuse, pd->cons.bufdim
+         , (pd->cons.mirrored == XYZ_TRUE ? " (mirrored)" : ""));
+
+   u32 drops = 0;
+   for ( u32 i = 0 ; i < CONS_PRODUCER_DIM ; i++ ) {
+      drops += pd->cons.prod[i].drops;
+   }
+   ImGui::Text("Queued: %u/%u  Dropped: %'u"
+         , xyz_mpam_used(&(pd->cons.mpam)), pd->cons.mpam.dim, drops);
 
    // Console lines area.
    ImGui::Separator();
@@ -250,34 +457,31 @@ imgui_console_window(progdata_s *pd)
    clipper.Begin(pd->cons.rbam.used, text_height);
    while ( clipper.Step() == true )
    {
-      for ( s32 line_no = clipper.DisplayStart ; line_no < clipper.DisplayEnd ; line_no++ )
-      {
-         if ( line_no < 0 ) { continue; }
-
-         // Making an assumption here that line_no can never be higher than the
-         // dimension of the lines array.
-         u32 idx = pd->cons.rbam.rd + (u32)line_no;
+      if ( clipper.DisplayStart < 0 || clipper.DisplayEnd <= clipper.DisplayStart ) {
+         continue;
+      }
 
-         if ( pd->cons.rbam.rd <= pd->cons.rbam.wr ) {
-            if ( idx >= pd->cons.rbam.wr ) { break; }
-         }
+      // Jump straight to the visible lines, which are at most two runs in
+      // the line list.
+      xyz_rbam_span span;
+      xyz_rbam_peek_at(&(pd->cons.rbam), (u32)clipper.DisplayStart,
+            (u32)(clipper.DisplayEnd - clipper.DisplayStart), &span);
 
-         else if ( idx >= pd->cons.rbam.dim ) {
-            idx -= pd->cons.rbam.dim; // wrap the index.
-            if ( idx >= pd->cons.rbam.wr  ) { break; }
+      for ( u32 run = 0 ; run < 2 ; run++ )
+      {
+         const consline_s *line = pd->cons.linelist + span.idx[run];
+         for ( u32 i = 0 ; i < span.len[run] ; i++, line++ )
+         {
+            // TODO add ability to select text, copy to clip board, etc.
+
+            // TextUnformatted will not wrap lines at all, ever, but it also
+            // does not format the text.  Every line is contiguous in the
+            // buffer (across the wrap with a mirrored buffer), so the line
+            // can be passed directly.  The horizontal scroll bar only
+            // appears when the long lines are actually displayed.
+            const c8 *line_start = pd->cons.buf + line->pos;
+            ImGui::TextUnformatted(line_start, line_start + line->len - 1);
          }
-
-         // TODO add ability to select text, copy to clip board, etc.
-
-         // TextWrapped will, uh, wrap lines (sometimes, it is odd).
-         // TextUnformatted will not wrap lines at all, ever.
-         // Also, the horizontal scroll bar only appears when the long lines
-         // are actually displayed.
-         ImGui::TextWrapped("%s", pd->cons.buf + pd->cons.linelist[idx].pos);
-
-         //const c8 *line_start = pd->cons.buf + pd->cons.linelist[idx].pos;
-         //const c8 *line_end   = line_start + pd->cons.linelist[idx].len - 1;
-         //ImGui::TextUnformatted(line_start, line_end);
       }
    }
    clipper.End();
@@ -312,6 +516,89 @@ imgui_console_window(progdata_s *pd)
 // imgui_console_window()
 
 
+#if defined(XYZ_MEM_TRACK)
+
+/**
+ * Sort heap sites by live bytes, largest first.
+ *
+ * @param[in] a  first xyz_mem_site.
+ * @param[in] b  second xyz_mem_site.
+ *
+ * @return qsort ordering.
+ */
+static int
+heap_site_cmp(const void *a, const void *b)
+{
+   u64 la = ((const xyz_mem_site *)a)->live_bytes;
+   u64 lb = ((const xyz_mem_site *)b)->live_bytes;
+   return (la < lb) - (la > lb);
+}
+// heap_site_cmp()
+
+
+/**
+ * Display the heap statistics per call site.
+ *
+ * @param[in] pd  Pointer to the program data structure.
+ */
+static void
+imgui_heap_window(progdata_s *pd)
+{
+   // The snapshot only lives for this frame.
+   xyz_mem_site *sites = (xyz_mem_site *)xyz_arena_alloc(pd->mem.frame,
+         sizeof(xyz_mem_site) * XYZ_MEM_SITE_DIM);
+   if ( sites == NULL ) { return; }
+
+   xyz_mem_site total;
+   u32 n = xyz_mem_snapshot(sites, XYZ_MEM_SITE_DIM, &total);
+   qsort(sites, n, sizeof(xyz_mem_site), heap_site_cmp);
+
+   ImGui::SetNextWindowSize(ImVec2(720, 320), ImGuiCond_FirstUseEver);
+   ImGui::Begin("Heap");
+
+   ImGui::Text("Sites: %u  Live: %'llu allocations, %'llu bytes  Peak: %'llu bytes  Waste: %'llu bytes",
+         n, (unsigned long long)total.live, (unsigned long long)total.live_bytes,
+         (unsigned long long)total.peak_bytes, (unsigned long long)total.waste);
+
+   ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg
+         | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable;
+
+   if ( ImGui::BeginTable("heap_sites", 8, flags) == true )
+   {
+      ImGui::TableSetupScrollFreeze(0, 1);
+      ImGui::TableSetupColumn("Site");
+      ImGui::TableSetupColumn("Allocs");
+      ImGui::TableSetupColumn("Frees");
+      ImGui::TableSetupColumn("Bytes");
+      ImGui::TableSetupColumn("Live");
+      ImGui::TableSetupColumn("Live Bytes");
+      ImGui::TableSetupColumn("Peak Bytes");
+      ImGui::TableSetupColumn("Waste");
+      ImGui::TableHeadersRow();
+
+      for ( u32 i = 0 ; i < n ; i++ )
+      {
+         ImGui::TableNextRow();
+         ImGui::TableNextColumn(); ImGui::Text("%s:%u", sites[i].file, sites[i].line);
+         ImGui::TableNextColumn(); ImGui::Text("%'llu", (unsigned long long)sites[i].allocs);
+         ImGui::TableNextColumn(); ImGui::Text("%'llu", (unsigned long long)sites[i].frees);
+         ImGui::TableNextColumn(); ImGui::Text("%'llu", (unsigned long long)sites[i].bytes);
+         ImGui::TableNextColumn(); ImGui::Text("%'llu", (unsigned long long)sites[i].live);
+         ImGui::TableNextColumn(); ImGui::Text("%'llu", (unsigned long long)sites[i].live_bytes);
+         ImGui::TableNextColumn(); ImGui::Text("%'llu", (unsigned long long)sites[i].peak_bytes);
+         ImGui::TableNextColumn(); ImGui::Text("%'llu", (unsigned long long)sites[i].waste);
+      }
+
+      ImGui::EndTable();
+   }
+
+   ImGui::End();
+}
+// imgui_heap_window()
+
+#endif // XYZ_MEM_TRACK
+
+
 /*
 ------------------------------------------------------------------------------
 This software is available under 2 licenses -- choose whichever you prefer.
@@ -41,6 +41,7 @@
 
 
 #include <stdio.h>   // NULL, stdout, fwrite, fflush
+#include <string.h>  // memset
 
 // IMGUI has pre-build wrappers for many graphics subsystems.
 #include "imgui.h"
@@ -70,14 +71,36 @@
 /// to window creation or during startup.
 #define ERROR_BUF_DIM 1024
 
+/// Size of the program lifetime arena, everything main() allocates.  Each
+/// allocation can be padded by up to XYZ_ARENA_ALIGN bytes.
+#define MAIN_ARENA_DIM ( \
+      sizeof(progdata_s) + ERROR_BUF_DIM + TTY_LINEBUF_DIM + \
+      (CONS_LINELIST_DIM * sizeof(consline_s)) + \
+      (CONS_INGEST_DIM * (sizeof(consmsg_s) + sizeof(u32))) + \
+      (8 * XYZ_ARENA_ALIGN) + (2 * XYZ_CACHE_LINE) )
+
+/// Backing options for the long-lived hot buffers (the main arena, the
+/// console mirror, and the frame arena), so the first burst of logging or
+/// drawing does not take a page fault per page.  Add XYZ_VMEM_F_LOCK to
+/// keep them from being paged out, within the process lock limit.
+#define HOT_BUFFER_VMEM (XYZ_VMEM_F_POPULATE | XYZ_VMEM_F_HUGE)
+
+/// Size header in front of every ImGui allocation, keeps malloc alignment.
+#define IMGUI_MEM_HDR 16
+
 
 // Local private function forward declarations.
 //
 
 static s32 disco(progdata_s *pd);
 static s32 render_thread(void *arg);
+static s32 program_thread(void *arg);
 static u32 out_tty(void *arg, const c8 *text, u32 len);
 static u32 out_cons(void *arg, const c8 *text, u32 len);
+static void cons_ingest(progdata_s *pd);
+static u32 cons_pending(void *arg);
+static void *imgui_alloc(size_t sz, void *user_data);
+static void imgui_free(void *ptr, void *user_data);
 
 
 /**
@@ -97,11 +120,30 @@ main(int argc, char *argv[])
    (void)argc;
    (void)argv;
 
-   // TODO Set up memory allocator so malloc/calloc is only called once for
-   //      the entire run of the program.
+   // A mirrored console buffer keeps every line contiguous across the wrap,
+   // without one the RBVL pads the tail instead.  The mirror is its own
+   // mapping, otherwise the console buffer comes from the arena.
+   u64 consdim = CONS_BUF_DIM;
+   u8 *consmirror = xyz_vmirror_alloc(&consdim);
+   if ( consmirror != NULL && consdim != CONS_BUF_DIM ) {
+      xyz_vmirror_free(consmirror, consdim);
+      consmirror = NULL;
+   }
+
+   // Both views share the pages, but each view has its own page table
+   // entries to fault in.
+   xyz_vmem_resident(consmirror, consdim * 2, HOT_BUFFER_VMEM);
+
+   // Everything else for the entire run of the program is allocated from one
+   // region, and released all at once on exit.
+   u64 arenadim = MAIN_ARENA_DIM + (consmirror == NULL ? CONS_BUF_DIM : 0);
+   xyz_arena arena;
+   if ( xyz_arena_init_vmem(&arena, arenadim, HOT_BUFFER_VMEM) != XYZ_TRUE ) {
+      xyz_arena_init(&arena, arenadim);
+   }
 
    // Allocate the program data and zero all fields.
-   progdata_s *pd = (progdata_s *)xyz_calloc(1, sizeof(progdata_s));
+   progdata_s *pd = (progdata_s *)xyz_arena_calloc(&arena, 1, sizeof(progdata_s));
 
    XYZ_BLOCK
 
@@ -116,7 +158,9 @@ main(int argc, char *argv[])
       XYZ_BREAK
    }
 
-   pd->err.buf = (c8 *)xyz_malloc(ERROR_BUF_DIM);
+   pd->mem.arena = &arena;
+
+   pd->err.buf = (c8 *)xyz_arena_alloc(&arena, ERROR_BUF_DIM);
    if ( pd->err.buf == NULL ) {
       SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, APP_NAME,
             "Cannot continue: the error message buffer could not "
@@ -128,17 +172,32 @@ main(int argc, char *argv[])
    pd->prg_name = APP_NAME;
 
    // Default initialization.
-   pd->tty.buf  = (c8 *)xyz_malloc(TTY_LINEBUF_DIM);
-   pd->cons.buf = (c8 *)xyz_malloc(CONS_BUF_DIM);
-   pd->cons.linelist = (consline_s *)xyz_calloc(CONS_LINELIST_DIM, sizeof(consline_s));
-   pd->cons.mutex = SDL_CreateMutex();
-   pd->cons.lockfailures = 0;
+   pd->tty.buf  = (c8 *)xyz_arena_alloc(&arena, TTY_LINEBUF_DIM);
+
+   if ( consmirror != NULL ) {
+      pd->cons.buf = (c8 *)consmirror;
+      pd->cons.mirrored = XYZ_TRUE;
+   } else {
+      pd->cons.buf = (c8 *)xyz_arena_alloc(&arena, CONS_BUF_DIM);
+   }
+
+   pd->cons.linelist = (consline_s *)xyz_arena_calloc(&arena, CONS_LINELIST_DIM, sizeof(consline_s));
+
+   // The ingest queue is written by any thread, so it starts on its own
+   // cache line rather than sharing one with the end of the line list.
+   pd->cons.ingest = (consmsg_s *)xyz_arena_alloc_aligned(&arena,
+         CONS_INGEST_DIM * sizeof(consmsg_s), XYZ_CACHE_LINE);
+   pd->cons.ingest_seq = (u32 *)xyz_arena_alloc_aligned(&arena,
+         CONS_INGEST_DIM * sizeof(u32), XYZ_CACHE_LINE);
+   if ( pd->cons.ingest != NULL ) { memset(pd->cons.ingest, 0, CONS_INGEST_DIM * sizeof(consmsg_s)); }
+   if ( pd->cons.ingest_seq != NULL ) { memset(pd->cons.ingest_seq, 0, CONS_INGEST_DIM * sizeof(u32)); }
 
    if (
       pd->tty.buf == NULL ||
       pd->cons.buf == NULL ||
       pd->cons.linelist == NULL ||
-      pd->cons.mutex == NULL ) {
+      pd->cons.ingest == NULL ||
+      pd->cons.ingest_seq == NULL ) {
       SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, pd->prg_name,
             "Cannot continue: the TTY and Console message buffer could not "
             "be allocated.", NULL);
@@ -148,6 +207,12 @@ main(int argc, char *argv[])
    pd->tty.bufdim = TTY_LINEBUF_DIM;
    pd->cons.bufdim = CONS_BUF_DIM;
    xyz_rbam_init(&(pd->cons.rbam), CONS_LINELIST_DIM);
+   xyz_rbvl_init(&(pd->cons.rbvl), (u8 *)pd->cons.buf, CONS_BUF_DIM,
+         (pd->cons.mirrored == XYZ_TRUE ? XYZ_RBVL_F_MIRROR : 0));
+   xyz_mpam_init(&(pd->cons.mpam), CONS_INGEST_DIM, pd->cons.ingest_seq);
+   xyz_evc_init(&(pd->cons.ingest_wake), XYZ_EVC_SPIN);
+   xyz_evc_init(&(pd->disco.wake), XYZ_EVC_SPIN);
+   xyz_rbow_init(&(pd->mouse.rbow), MOUSE_TRAIL_DIM, pd->mouse.seq);
 
    pd->tty.out = out_tty;
    pd->cons.out = out_cons;
@@ -222,33 +287,32 @@ main(int argc, char *argv[])
    // Memory cleanup.
    if ( pd != NULL )
    {
-      if ( pd->cons.lockfailures != 0 ) {
-         TTYF(pd, "Warning: Console mutex lock failure count: %u\n",
-               pd->cons.lockfailures);
+      // The other threads are gone, move any lines still queued (written
+      // before the render loop started or after it stopped) into the
+      // console buffer.
+      if ( pd->cons.mpam.dim != 0 ) {
+         cons_ingest(pd);
       }
 
-      if ( pd->tty.buf != NULL ) {
-         xyz_free(pd->tty.buf);
-      }
-
-      if ( pd->cons.buf != NULL ) {
-         xyz_free(pd->cons.buf);
-      }
-
-      if ( pd->cons.linelist != NULL ) {
-         xyz_free(pd->cons.linelist);
-      }
-
-      if ( pd->cons.mutex != NULL ) {
-         SDL_DestroyMutex(pd->cons.mutex);
+      for ( u32 i = 0 ; i < CONS_PRODUCER_DIM ; i++ )
+      {
+         if ( pd->cons.prod[i].drops != 0 ) {
+            TTYF(pd, "Warning: Console writer thread %llu dropped %u of %u lines.\n",
+                  (unsigned long long)pd->cons.prod[i].thread_id,
+                  pd->cons.prod[i].drops,
+                  pd->cons.prod[i].lines + pd->cons.prod[i].drops);
+         }
       }
+   }
 
-      if ( pd->err.buf != NULL ) {
-         xyz_free(pd->err.buf);
-      }
+   // Everything but the console mirror came from the arena.
+   xyz_vmirror_free(consmirror, CONS_BUF_DIM);
+   xyz_arena_free(&arena);
 
-      xyz_free(pd);
-   }
+#if defined(XYZ_MEM_TRACK)
+   // Anything still live now is a leak.
+   xyz_mem_dump();
+#endif
 
    return rtn;
 }
@@ -299,6 +363,9 @@ disco(progdata_s *pd)
    SDL_Thread *render_h = NULL;
    SDL_Thread *program_h = NULL;
 
+   // The event loop runs on this thread, so its heap lives for the call.
+   xyz_theap_init(&(pd->mem.heap[THEAP_EVENT]), "Event", THEAP_ARENA_DIM);
+
    XYZ_BLOCK
 
    // TODO Support for multiple monitors.
@@ -400,8 +467,10 @@ disco(progdata_s *pd)
    // TODO Set context in pd to allow for hot-loading.  Need to look into
    // IMGUI requirements a little closer first.
 
-   // Set up singleton ImGui context.
+   // Set up singleton ImGui context.  The allocator hooks are global, not
+   // per context, and must be set before the context is created.
    IMGUI_CHECKVERSION();
+   ImGui::SetAllocatorFunctions(imgui_alloc, imgui_free, &(pd->mem.imgui));
    ImGui::CreateContext();
 
    // Set the IMGUI ini file.
@@ -449,7 +518,7 @@ disco(progdata_s *pd)
 
    if ( pd->main_thread != NULL )
    {
-      program_h = SDL_CreateThread(pd->main_thread, "ProgramThread", pd);
+      program_h = SDL_CreateThread(program_thread, "ProgramThread", pd);
       if ( program_h == NULL )
       {
          const char *sdlerr = SDL_GetError();
@@ -485,6 +554,17 @@ disco(progdata_s *pd)
       pd->disco.event_counter++;
       ImGui_ImplSDL2_ProcessEvent(event);
 
+      // Mouse telemetry never blocks, the oldest sample is overwritten.
+      if ( event->type == SDL_MOUSEMOTION )
+      {
+         u64 pos = xyz_rbow_reserve(&(pd->mouse.rbow));
+         mousesample_s *ms = &(pd->mouse.sample[xyz_rbow_idx(&(pd->mouse.rbow), pos)]);
+         ms->x = event->motion.x;
+         ms->y = event->motion.y;
+         ms->time_ns = xyz_time_ns();
+         xyz_rbow_commit(&(pd->mouse.rbow), pos);
+      }
+
       // Give the program event call-back a chance to handle events first.
       s32 handled = XYZ_FALSE;
       if ( pd->callback.event != NULL ) {
@@ -511,6 +591,9 @@ disco(progdata_s *pd)
       }
    }
 
+   // Wake the program thread so it sees disco.running right away.
+   xyz_evc_notify(&(pd->disco.wake));
+
    rtn = XYZ_OK;
    XYZ_END
 
@@ -536,6 +619,9 @@ disco(progdata_s *pd)
 
    SDL_Quit();
 
+   // The other threads are done, anything they freed is taken back here.
+   xyz_theap_fini(&(pd->mem.heap[THEAP_EVENT]));
+
    return rtn;
 }
 // disco()
@@ -564,6 +650,17 @@ render_thread(void *arg)
    // Set up a program data pointer.
    progdata_s *pd = (progdata_s *)(arg);
 
+   // Per-frame scratch memory for the drawing call-backs.  Allocations only
+   // live until the end of the frame, so the whole arena is released with a
+   // single reset after the buffers are swapped.
+   xyz_theap_init(&(pd->mem.heap[THEAP_RENDER]), "Render", THEAP_ARENA_DIM);
+
+   xyz_arena frame;
+   u32 have_frame = xyz_arena_init_vmem(&frame, FRAME_ARENA_DIM, HOT_BUFFER_VMEM);
+   if ( have_frame != XYZ_TRUE ) {
+      have_frame = xyz_arena_init(&frame, FRAME_ARENA_DIM);
+   }
+
 
    XYZ_BLOCK
 
@@ -633,6 +730,15 @@ render_thread(void *arg)
    ImVec4 clear_color = ImColor(0, 0, 0);
 
 
+   if ( have_frame != XYZ_TRUE )
+   {
+      TTYF(pd, "%s:%d Failed to allocate the frame arena.\n", XYZ_CFL);
+      XYZ_BREAK
+   }
+
+   pd->mem.frame = &frame;
+
+
    // Update status flag that the rendering thread is active.
    pd->disco.render_thread_running = XYZ_TRUE;
    pd->disco.render_time_us = 0;
@@ -642,12 +748,16 @@ render_thread(void *arg)
    // Render until signaled to quit.
    while ( pd->disco.running == XYZ_TRUE )
    {
-      // Do not render if minimized.
+      // Move lines written by any thread into the console buffer.
+      cons_ingest(pd);
+
+      // Do not render if minimized, but wake to drain the ingest queue as
+      // soon as a line is queued so a burst does not fill it.
       // TODO Might still need to issue some call-backs?
       if ( (SDL_GetWindowFlags(pd->disco.window) & SDL_WINDOW_MINIMIZED) ==
             SDL_WINDOW_MINIMIZED) {
          const u32 NOTHING_TO_DO = 250;
-         SDL_Delay(NOTHING_TO_DO);
+         xyz_evc_await(&(pd->cons.ingest_wake), cons_pending, pd, NOTHING_TO_DO);
          continue;
       }
 
@@ -689,6 +799,18 @@ render_thread(void *arg)
       // render-loop at a constant frame rate.
       SDL_GL_SwapWindow(pd->disco.window);
       pd->disco.render_counter++;
+
+      // Everything allocated from the frame arena is now dead.
+      xyz_arena_reset(&frame);
+
+      // ImGui allocations during this frame, usually draw list growth.
+      // The event thread can allocate at the same time, so subtract what
+      // was counted instead of storing zero over its updates.
+      imguimem_s *im = &(pd->mem.imgui);
+      u64 frame_allocs = xyz_atomic_ld_rlx_u64(&(im->frame_allocs));
+      xyz_atomic_add_u64(&(im->frame_allocs), (u64)0 - frame_allocs);
+      im->last_frame_allocs = frame_allocs;
+      if ( frame_allocs > im->max_frame_allocs ) { im->max_frame_allocs = frame_allocs; }
    }
 
    rtn = XYZ_OK;
@@ -704,11 +826,37 @@ render_thread(void *arg)
       SDL_GL_DeleteContext(pd->disco.gl_context);
    }
 
+   pd->mem.frame = NULL;
+   xyz_arena_free(&frame);
+
+   xyz_theap_fini(&(pd->mem.heap[THEAP_RENDER]));
+
    return rtn;
 }
 // render_thread()
 
 
+/**
+ * Program thread, runs the program's main thread function with its own heap.
+ *
+ * @param[in] arg  Pointer to the program data structure.
+ *
+ * @return The program's main thread return value.
+ */
+static s32
+program_thread(void *arg)
+{
+   progdata_s *pd = (progdata_s *)(arg);
+
+   xyz_theap_init(&(pd->mem.heap[THEAP_PROGRAM]), "Program", THEAP_ARENA_DIM);
+   s32 rtn = pd->main_thread(pd);
+   xyz_theap_fini(&(pd->mem.heap[THEAP_PROGRAM]));
+
+   return rtn;
+}
+// program_thread()
+
+
 /**
  * Write to the default TTY, usually stdout.
  *
@@ -737,6 +885,38 @@ out_tty(void *arg, const c8 *text, u32 len)
 // out_tty()
 
 
+/**
+ * Get the statistics entry for the calling console writer thread.
+ *
+ * Each thread claims an entry the first time it writes to the console, and
+ * keeps it for the life of the thread.  Threads beyond CONS_PRODUCER_DIM
+ * share the last entry.
+ *
+ * @param[in] pd  Pointer to the program data structure.
+ *
+ * @return Pointer to the producer statistics entry.
+ */
+static consprod_s *
+cons_producer(progdata_s *pd)
+{
+   static thread_local consprod_s *prod = NULL;
+
+   if ( prod == NULL )
+   {
+      u32 slot = xyz_atomic_add_u32(&(pd->cons.nprod), 1);
+      if ( slot >= CONS_PRODUCER_DIM ) {
+         slot = CONS_PRODUCER_DIM - 1;
+      }
+
+      prod = &(pd->cons.prod[slot]);
+      xyz_atomic_cas_u64(&(prod->thread_id), 0, (u64)SDL_ThreadID());
+   }
+
+   return prod;
+}
+// cons_producer()
+
+
 /**
  * Write to the console buffer.
  *
@@ -745,6 +925,12 @@ out_tty(void *arg, const c8 *text, u32 len)
  * This is a line-oriented buffer, so input text will be split on newline
  * as well as lines longer than a maximum number of characters.
  *
+ * Any thread can call this function.  The lines are put in a lock-free
+ * multi-producer queue, and the render thread moves them into the console
+ * buffer (see cons_ingest()).  Writers never wait on a lock or sleep, a line
+ * is only dropped if the queue is full, and drops are counted for each
+ * writer thread.
+ *
  * @param[in] arg    Pointer to the program data structure.
  * @param[in] text   The text to write.
  * @param[in] len    The length of text.
@@ -756,7 +942,7 @@ out_cons(void *arg, const c8 *text, u32 len)
 {
    progdata_s *pd = (progdata_s *)arg;
 
-   s32 locked = -1;
+   u32 queued = 0;
 
    XYZ_BLOCK
 
@@ -772,28 +958,7 @@ out_cons(void *arg, const c8 *text, u32 len)
       len = CONS_MAX_LINE * 4;
    }
 
-   // The design is a ring-buffer list of line positions and lengths, and a
-   // byte buffer holding the line data.
-   //
-   // Both the line list and buffer are fixed arrays, so which ever buffer
-   // fills up first determines how many lines there are for display.
-
-
-   locked = SDL_TryLockMutex(pd->cons.mutex);
-   if ( locked != 0 )
-   {
-      pd->cons.lockfailures++;
-
-      // Yield and wait the minimum time, and try the lock once more.
-      SDL_Delay(1);
-      locked = SDL_TryLockMutex(pd->cons.mutex);
-
-      if ( locked != 0 ) {
-         pd->cons.lockfailures++;
-         XYZ_BREAK
-      }
-   }
-
+   consprod_s *prod = cons_producer(pd);
 
    u32 idx = 0;
    u32 linelen = 0;
@@ -832,85 +997,199 @@ out_cons(void *arg, const c8 *text, u32 len)
          linelen++;
       }
 
-      // A terminator will be added to the line to prevent buffer overflows
-      // and make it compatible with other functions that expect / need
-      // terminated buffers.
-      linelen += 1;
-
-      // Sanity.
-      if ( linelen > pd->cons.bufdim ) {
+      if ( linelen == 0 ) {
          continue;
       }
 
-      // Convenience.
-      consline_s *list = pd->cons.linelist;
-      u32 *rd = &(pd->cons.rbam.rd);
-      u32 *wr = &(pd->cons.rbam.wr);
-      xyz_rbam *rbam = &(pd->cons.rbam);
-
-      // If the line list is full, make room for the new line.
-      if ( xyz_rbam_is_full(rbam) == XYZ_TRUE ) {
-         xyz_rbam_read(rbam);
+      // Queue the line for the render thread.
+      u32 ticket;
+      if ( xyz_mpam_reserve(&(pd->cons.mpam), &ticket) == XYZ_FALSE ) {
+         xyz_atomic_add_u32(&(prod->drops), 1);
+         continue;
       }
 
-      // Calculate the position of the end of the line in the buffer, which is
-      // also the "new position" for the line after this one.
-      u32 newpos = list[*wr].pos + linelen;
+      consmsg_s *msg = &(pd->cons.ingest[xyz_mpam_idx(&(pd->cons.mpam), ticket)]);
+      memcpy(msg->text, text + start_idx, linelen);
+      msg->len = linelen;
+      xyz_mpam_commit(&(pd->cons.mpam), ticket);
 
-      // Clear any top lines that would be overwritten by the new line.
-      while ( list[*rd].pos >= list[*wr].pos &&
-              list[*rd].pos < newpos &&
-              xyz_rbam_is_empty(rbam) == XYZ_FALSE )
-      { xyz_rbam_read(rbam); }
+      xyz_atomic_add_u32(&(prod->lines), 1);
+      queued += linelen;
+   }
 
-      // Adjust the new starting location if out of bounds.
-      if ( newpos > pd->cons.bufdim )
-      {
-         // The new line will not fit in the remainder of the buffer,
-         // so restart at position 0.
-         list[*wr].pos = 0;
-         newpos = linelen;
-
-         // Clear any lines that will be overwritten by the new line.
-         while ( list[*rd].pos < newpos &&
-                 xyz_rbam_is_empty(rbam) == XYZ_FALSE )
-         { xyz_rbam_read(rbam); }
-      }
+   // Only makes a system call if the render thread is parked.
+   if ( queued > 0 ) {
+      xyz_evc_notify(&(pd->cons.ingest_wake));
+   }
 
-      // The line has been checked to be shorter than the size of the buffer.
-      list[*wr].len = linelen;
+   len = queued;
 
+   XYZ_END
 
-      // The line data is (linelen - 1), since it was increased to account for
-      // the terminator that will be written in the buffer.
-      memcpy(pd->cons.buf + list[*wr].pos, text + start_idx, linelen - 1);
+   return len;
+}
+// out_cons()
 
-      // Set the last reserved byte to the terminator.
-      pd->cons.buf[newpos - 1] = XYZ_NTERM;
 
-      // Indicate that a new line has been written.
-      xyz_rbam_write(rbam);
+/**
+ * Store a line in the console buffer.
+ *
+ * Render thread only.
+ *
+ * The line text is a record in the buffer's RBVL, and the line list is an
+ * index of the records for random access by the display.  There is always one
+ * record per line in the list, so the oldest line is evicted from both when
+ * either one fills up.
+ *
+ * @param[in] pd       Pointer to the program data structure.
+ * @param[in] text     The line text.
+ * @param[in] linelen  The length of the line, not including a terminator.
+ */
+static void
+cons_store(progdata_s *pd, const c8 *text, u32 linelen)
+{
+   // A terminator will be added to the line to prevent buffer overflows
+   // and make it compatible with other functions that expect / need
+   // terminated buffers.
+   linelen += 1;
+
+   // Convenience.
+   consline_s *list = pd->cons.linelist;
+   xyz_rbam *rbam = &(pd->cons.rbam);
+   xyz_rbvl *rbvl = &(pd->cons.rbvl);
+
+   // If the line list is full, make room for the new line.
+   if ( xyz_rbam_is_full(rbam) == XYZ_TRUE ) {
+      xyz_rbam_read(rbam);
+      xyz_rbvl_consume(rbvl);
+   }
 
-      // If the line list is now full, read at least one line so the new
-      // position can be stored.
-      if ( xyz_rbam_is_full(rbam) == XYZ_TRUE ) {
-         xyz_rbam_read(rbam);
+   // Evict the oldest lines until the new line fits in the buffer.
+   c8 *dst;
+   while ( (dst = (c8 *)xyz_rbvl_reserve(rbvl, linelen)) == NULL )
+   {
+      // Sanity, the line can never fit.
+      if ( xyz_rbam_is_empty(rbam) == XYZ_TRUE ) {
+         return;
       }
 
-      // Prepare for the next line.
-      list[*wr].pos = newpos;
-      list[*wr].len = 0;
+      xyz_rbam_read(rbam);
+      xyz_rbvl_consume(rbvl);
    }
 
-   XYZ_END
+   // The line data is (linelen - 1), since it was increased to account for
+   // the terminator that will be written in the buffer.
+   memcpy(dst, text, linelen - 1);
+   dst[linelen - 1] = XYZ_NTERM;
+   xyz_rbvl_commit(rbvl, linelen);
+
+   // Index the line.
+   list[rbam->wr].pos = (u32)(dst - pd->cons.buf);
+   list[rbam->wr].len = linelen;
+   xyz_rbam_write(rbam);
+}
+// cons_store()
+
+
+/**
+ * Move queued lines from the ingest queue into the console buffer, until the
+ * queue is empty.
+ *
+ * Render thread only, called once per frame (and by main() once the other
+ * threads are gone).  The render thread is the only thread that touches the
+ * console buffer and line list, so no lock is needed.
+ *
+ * @param[in] pd  Pointer to the program data structure.
+ */
+static void
+cons_ingest(progdata_s *pd)
+{
+   u32 ticket;
+   while ( xyz_mpam_peek(&(pd->cons.mpam), &ticket) == XYZ_TRUE )
+   {
+      consmsg_s *msg = &(pd->cons.ingest[xyz_mpam_idx(&(pd->cons.mpam), ticket)]);
+      cons_store(pd, msg->text, msg->len);
+      xyz_mpam_consume(&(pd->cons.mpam), ticket);
+   }
+}
+// cons_ingest()
+
 
-   if ( locked == 0 ) {
-      SDL_UnlockMutex(pd->cons.mutex);
+/**
+ * Condition callback for xyz_evc_await(), lines are waiting to be ingested.
+ *
+ * @param[in] arg  Pointer to the program data structure.
+ *
+ * @return XYZ_TRUE if the ingest queue is not empty.
+ */
+static u32
+cons_pending(void *arg)
+{
+   progdata_s *pd = (progdata_s *)arg;
+   return ( xyz_mpam_used(&(pd->cons.mpam)) > 0 ? XYZ_TRUE : XYZ_FALSE );
+}
+// cons_pending()
+
+
+/**
+ * ImGui allocation hook, routes ImGui's heap use through the calling
+ * thread's heap.
+ *
+ * Each allocation has a small header with its size, so the free can be
+ * credited back.  The event thread (ImGui_ImplSDL2_ProcessEvent) and the
+ * render thread both allocate through ImGui, so the statistics are updated
+ * atomically.
+ *
+ * @param[in] sz         number of bytes.
+ * @param[in] user_data  pointer to the imguimem_s statistics.
+ *
+ * @return Pointer to the memory, or NULL on failure.
+ */
+static void *
+imgui_alloc(size_t sz, void *user_data)
+{
+   imguimem_s *im = (imguimem_s *)user_data;
+
+   // Whichever thread ImGui calls from, usually the render thread.
+   u64 *hdr = (u64 *)xyz_theap_alloc(xyz_theap_current(), IMGUI_MEM_HDR + sz);
+   if ( hdr == NULL ) { return NULL; }
+
+   hdr[0] = sz;
+
+   xyz_atomic_add_u64(&(im->allocs), 1);
+   xyz_atomic_add_u64(&(im->frame_allocs), 1);
+   u64 live = xyz_atomic_add_u64(&(im->live_bytes), sz) + sz;
+
+   u64 peak = xyz_atomic_ld_rlx_u64(&(im->peak_bytes));
+   while ( live > peak && xyz_atomic_cas_u64(&(im->peak_bytes), peak, live) == XYZ_FALSE ) {
+      peak = xyz_atomic_ld_rlx_u64(&(im->peak_bytes));
    }
 
-   return len;
+   return (u8 *)hdr + IMGUI_MEM_HDR;
 }
-// out_cons()
+// imgui_alloc()
+
+
+/**
+ * ImGui free hook, the pair to imgui_alloc().
+ *
+ * @param[in] ptr        memory from imgui_alloc(), can be NULL.
+ * @param[in] user_data  pointer to the imguimem_s statistics.
+ */
+static void
+imgui_free(void *ptr, void *user_data)
+{
+   if ( ptr == NULL ) { return; }
+
+   imguimem_s *im = (imguimem_s *)user_data;
+   u64 *hdr = (u64 *)((u8 *)ptr - IMGUI_MEM_HDR);
+
+   xyz_atomic_add_u64(&(im->frees), 1);
+   xyz_atomic_add_u64(&(im->live_bytes), (u64)0 - hdr[0]);
+
+   xyz_theap_free(hdr);
+}
+// imgui_free()
 
 
 /*
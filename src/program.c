@@ -22,6 +22,7 @@ static s32 cleanup(void *arg);
 static s32 main_program(void *arg);
 static s32 events(void *arg);
 static s32 draw(void *arg);
+static u32 disco_stopped(void *arg);
 
 
 /**
@@ -66,22 +67,13 @@ program_init(progdata_s *pd)
    pd->ver_minor = VER_MINOR;
 
 
-   // The program name is a "metadata" type.  Still experimental, needs some
-   // support functions.
-   pd->prg_metaname.format = XYZ_META_F_POINTER;
-   pd->prg_metaname.alloc  = XYZ_META_P_DYNAMIC;
-   pd->prg_metaname.type   = XYZ_META_T_ASCII_VARCHAR;
-   pd->prg_metaname.byte_dim = 80;
-   pd->prg_metaname.buf.vp = xyz_malloc(pd->prg_metaname.byte_dim);
-   if ( pd->prg_metaname.buf.vp == NULL ) {
-      pd->prg_metaname.byte_dim = 0;
-   } else {
-      pd->prg_metaname.unit_dim = pd->prg_metaname.byte_dim;
-      pd->prg_metaname.unit_len = stbsp_snprintf(
-            pd->prg_metaname.buf.vp, pd->prg_metaname.unit_dim, "%s v%d.%d",
-            APP_NAME, pd->ver_major, pd->ver_minor);
-      pd->prg_metaname.byte_len = pd->prg_metaname.unit_len;
-      pd->prg_name = (c8 *)pd->prg_metaname.buf.vp;
+   // The program name is a "metadata" type.  A short name is kept inline
+   // in the meta value, a long one is allocated.
+   c8 name[80];
+   stbsp_snprintf(name, sizeof(name), "%s v%d.%d", APP_NAME, pd->ver_major, pd->ver_minor);
+   if ( xyz_meta_init(&(pd->prg_metaname), XYZ_META_T_ASCII_VARCHAR,
+         XYZ_META_P_DYNAMIC, 0, name) == XYZ_OK ) {
+      pd->prg_name = (c8 *)xyz_meta_ptr(&(pd->prg_metaname));
    }
 
 
@@ -118,12 +110,9 @@ cleanup(void *arg)
 
    XYZ_BLOCK
 
-   if ( pd->prg_metaname.alloc == XYZ_META_P_DYNAMIC &&
-         pd->prg_metaname.buf.vp != NULL && pd->prg_metaname.byte_dim > 0 )
-   {
-      xyz_free(pd->prg_metaname.buf.vp);
-      pd->prg_metaname.byte_dim = 0;
-   }
+   // The program name points into the meta value.
+   pd->prg_name = APP_NAME;
+   xyz_meta_free(&(pd->prg_metaname));
 
    rtn = XYZ_OK;
    XYZ_END
@@ -133,6 +122,22 @@ cleanup(void *arg)
 // cleanup()
 
 
+/**
+ * Wait condition for the main program thread.
+ *
+ * @param[in] arg Pointer to the program data structure.
+ *
+ * @return XYZ_TRUE if disco is no longer running.
+ */
+static u32
+disco_stopped(void *arg)
+{
+   progdata_s *pd = (progdata_s *)arg;
+   return (pd->disco.running == XYZ_TRUE ? XYZ_FALSE : XYZ_TRUE);
+}
+// disco_stopped()
+
+
 /**
  * Main Program Thread.
  *
@@ -172,7 +177,9 @@ main_program(void *arg)
    while ( pd->program_running == XYZ_TRUE && pd->disco.running == XYZ_TRUE )
    {
       // TODO lots of program kinds of stuff here.
-      SDL_Delay(100);
+
+      // Sleep until disco stops or 100ms pass, whichever is first.
+      xyz_evc_await(&(pd->disco.wake), disco_stopped, pd, 100);
 
       // TODO if the program errors, break and make sure to set
       // program_running to XYZ_FALSE.
@@ -23,7 +23,7 @@
 /// buffer will be truncated.
 #define TTY_LINEBUF_DIM 2048
 
-/// The dimension of the graphical console buffer.
+/// The dimension of the graphical console buffer, must be a power of two.
 #define CONS_BUF_DIM (1024 * 1024)
 
 /// The dimension of line list for the graphical console.
@@ -32,6 +32,33 @@
 /// Lines longer than this will be split in the graphical console buffer.
 #define CONS_MAX_LINE 512
 
+/// The dimension of the graphical console ingest queue, must be a power of
+/// two.  This is the number of lines that can be waiting to be moved into the
+/// console buffer by the render thread, which drains it every frame, or as
+/// soon as a line is queued when minimized.
+#define CONS_INGEST_DIM 2048
+
+/// The number of console writer threads that get their own statistics.  Any
+/// threads beyond this share the last entry.
+#define CONS_PRODUCER_DIM 8
+
+/// The dimension of the mouse telemetry ring, must be a power of two.  Also
+/// the length of the mouse trail drawn in the overlay.
+#define MOUSE_TRAIL_DIM 64
+
+/// Per-thread heaps for the threads disco runs, indexes into pd->mem.heap.
+#define THEAP_EVENT   0   ///< Event loop, the thread that calls disco().
+#define THEAP_RENDER  1   ///< Render thread.
+#define THEAP_PROGRAM 2   ///< Program thread.
+#define THEAP_DIM     3   ///< Number of per-thread heaps.
+
+/// The dimension of the arena of each per-thread heap.
+#define THEAP_ARENA_DIM (4 * 1024 * 1024)
+
+/// The dimension of the per-frame scratch arena owned by the render thread.
+/// Drawing call-backs allocate from it and it is reset after every frame.
+#define FRAME_ARENA_DIM (1024 * 1024)
+
 
 // The ## in front of __VA_ARGS__ is required to deal with the case where there
 // are no arguments.
@@ -44,11 +71,12 @@
    pd->tty.out(pd, pd->tty.buf, len);}
 
 
-/// Console buffer formatted output (printf equivalent).
-/// TODO Not thread-safe, make a real function for this to use the mutex.
-#define CONSF(pd, fmt, ...) {s32 slen = stbsp_snprintf(pd->tty.buf, pd->tty.bufdim, fmt, ##__VA_ARGS__); \
-   u32 len = slen < 0 ? 0 : (u32)slen; len = len > pd->tty.bufdim ? pd->tty.bufdim : len; \
-   pd->cons.out(pd, pd->tty.buf, len);}
+/// Console buffer formatted output (printf equivalent).  Thread-safe, the
+/// text is formatted on the caller's stack.
+#define CONSF(pd, fmt, ...) {c8 consf_buf[CONS_MAX_LINE * 4]; \
+   s32 slen = stbsp_snprintf(consf_buf, sizeof(consf_buf), fmt, ##__VA_ARGS__); \
+   u32 len = slen < 0 ? 0 : (u32)slen; len = len > sizeof(consf_buf) ? sizeof(consf_buf) : len; \
+   pd->cons.out(pd, consf_buf, len);}
 
 
 
@@ -69,9 +97,48 @@ typedef u32(out_fn)(void *arg, const c8 *text, u32 len);
 typedef struct unused_tag_consline_s
 {
    u32 pos; ///< Position in the buffer where the line starts.
-   u32 len; ///< Length of the line.
+   u32 len; ///< Length of the line, including the terminator.
 } consline_s;
 
+/// Console line waiting in the ingest queue.
+typedef struct unused_tag_consmsg_s
+{
+   u32 len;                      ///< Length of the line.
+   c8  text[CONS_MAX_LINE + 2];  ///< Line text (not terminated), room for a CRLF.
+} consmsg_s;
+
+/// Console writer (producer) statistics.
+typedef struct unused_tag_consprod_s
+{
+   u64 thread_id;  ///< SDL thread ID of the first thread to use the entry.
+   u32 lines;      ///< Number of lines queued.
+   u32 drops;      ///< Number of lines dropped because the queue was full.
+} consprod_s;
+
+
+/// Mouse telemetry sample.
+typedef struct unused_tag_mousesample_s
+{
+   s32 x;          ///< Mouse x position in the window.
+   s32 y;          ///< Mouse y position in the window.
+   u64 time_ns;    ///< Time stamp from xyz_time_ns().
+} mousesample_s;
+
+
+/// Dear ImGui heap statistics, from the allocator hooks set in disco().
+/// ImGui allocates on the event and render threads, so the counters the
+/// hooks update are accessed with the xyz_atomic helpers.
+typedef struct unused_tag_imguimem_s
+{
+   u64 allocs;             ///< Total allocations.
+   u64 frees;              ///< Total frees.
+   u64 live_bytes;         ///< Bytes not freed yet.
+   u64 peak_bytes;         ///< Highest live_bytes.
+   u64 frame_allocs;       ///< Allocations so far in the current frame.
+   u64 last_frame_allocs;  ///< Allocations in the last complete frame.
+   u64 max_frame_allocs;   ///< Most allocations in any one frame.
+} imguimem_s;
+
 
 /// Program Data Structure.
 typedef struct unused_tag_progdata_s
@@ -111,6 +178,7 @@ typedef struct unused_tag_progdata_s
    u64         render_time_us;         ///< Frame rendering time in microseconds.
    u64         render_counter;         ///< Increments for every frame rendered.
    u64         event_counter;          ///< Increments for every received event.
+   xyz_evc     wake;                   ///< Notified when disco stops running.
    } disco;                            ///< DISCO (Display and IO).
 
    struct {
@@ -126,19 +194,38 @@ typedef struct unused_tag_progdata_s
 
    struct {
    out_fn     *out;           ///< Output function for the console.
-   c8         *buf;           ///< Console buffer.
+   c8         *buf;           ///< Console buffer, render thread only.
    u32         bufdim;        ///< Dimension of the buffer.
-   consline_s *linelist;      ///< Ring buffer list of lines.
+   u32         mirrored;      ///< XYZ_TRUE if buf is from xyz_vmirror_alloc().
+   xyz_rbvl    rbvl;          ///< Record ring manager for the buffer.
+   consline_s *linelist;      ///< Ring buffer list of lines, render thread only.
    xyz_rbam    rbam;          ///< Ring buffer manager for the line list.
-   SDL_mutex  *mutex;         ///< Mutex to make the console thread safe.
-   u32         lockfailures;  ///< Number of times a mutex lock failed.
+   consmsg_s  *ingest;        ///< Lines written by any thread, waiting for the render thread.
+   u32        *ingest_seq;    ///< Sequence numbers for the ingest queue.
+   xyz_mpam    mpam;          ///< Multi-producer manager for the ingest queue.
+   xyz_evc     ingest_wake;   ///< Notified when lines are queued.
+   u32         nprod;         ///< Number of producer entries handed out.
+   consprod_s  prod[CONS_PRODUCER_DIM]; ///< Per-producer statistics.
    } cons;                    ///< Internal console and log.
 
+   struct {
+   xyz_rbow       rbow;       ///< Overwrite-oldest ring, written by the event loop.
+   u64            seq[MOUSE_TRAIL_DIM];     ///< Sequence numbers for the ring.
+   mousesample_s  sample[MOUSE_TRAIL_DIM];  ///< Mouse motion samples.
+   } mouse;                   ///< Mouse telemetry, readable from any thread.
+
    struct {
    c8         *buf;           ///< Buffer for error messages.
    u32         bufdim;        ///< Dimension of the buffer.
    } err;
 
+   struct {
+   xyz_arena  *arena;         ///< Program lifetime arena, the data structure and buffers.
+   xyz_arena  *frame;         ///< Per-frame scratch arena, render thread only, reset every frame.
+   imguimem_s  imgui;         ///< ImGui heap use, see imguimem_s.
+   xyz_theap   heap[THEAP_DIM];  ///< Per-thread heaps, one for each thread disco runs.
+   } mem;                     ///< Memory management.
+
 } progdata_s;
 
 
@@ -5,8 +5,39 @@
  */
 
 
+// Needed for syscall() and the futex definitions.
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <string.h>             // memset, memcpy
+#include <stdio.h>              // fprintf, stderr
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>          // SSE2 and AVX2 intrinsics
+#endif
+
 #include "xyz.h"
 
+#if defined(_WIN32)
+#if !defined(_WIN32_WINNT) || (_WIN32_WINNT < 0x0602)
+#undef _WIN32_WINNT
+#define _WIN32_WINNT 0x0602     // WaitOnAddress needs Windows 8.
+#endif
+#include <windows.h>            // WaitOnAddress, QueryPerformanceCounter, VirtualAlloc
+#include <malloc.h>             // _aligned_malloc, _aligned_free
+#elif defined(__linux__)
+#include <linux/futex.h>        // FUTEX_WAIT_PRIVATE, FUTEX_WAKE_PRIVATE
+#include <sys/mman.h>           // mmap, munmap, memfd_create, madvise, mlock
+#include <sys/syscall.h>        // SYS_futex
+#include <unistd.h>             // syscall, ftruncate, sysconf
+#include <time.h>               // clock_gettime, nanosleep
+#else
+#include <pthread.h>            // pthread_mutex_t, pthread_cond_t
+#include <sys/time.h>           // gettimeofday
+#include <time.h>               // clock_gettime, nanosleep
+#endif
+
 
 /**
  * Finds the last segment of a string given a separator.
@@ -91,6 +122,19 @@ xyz_path_lastpart(const c8 *filepath)
 // To keep the management lock-free and simple, the full-condition is true when
 // there are size-1 elements in the buffer.  For example, a 100-element buffer
 // can only ever contain 99 elements when it is full.
+//
+// The writer owns wr and next, the reader owns rd.  Each side only ever stores
+// to its own index, with release ordering, and loads the other side's index
+// with acquire ordering.  That is all that is needed for the reader and writer
+// to run on different threads without a lock:
+//
+//  - The writer's release-store of wr happens after the element was written,
+//    so a reader that sees the new wr also sees the element data.
+//  - The reader's release-store of rd happens after the element was used, so
+//    a writer that sees the new rd can safely overwrite that element.
+//
+// The used and free fields are written by both sides with relaxed stores, and
+// are only a status snapshot.
 
 
 /**
@@ -108,11 +152,11 @@ xyz_rbam_init(xyz_rbam *rbam, u32 dim)
 {
    if ( dim < 2 ) { return XYZ_FALSE; }
    rbam->dim = dim;
-   rbam->rd = 0;
-   rbam->wr = 0;
    rbam->next = 1;
-   rbam->used = 0;
-   rbam->free = dim - 1;
+   xyz_atomic_st_rlx_u32(&rbam->used, 0);
+   xyz_atomic_st_rlx_u32(&rbam->free, dim - 1);
+   xyz_atomic_st_rel_u32(&rbam->rd, 0);
+   xyz_atomic_st_rel_u32(&rbam->wr, 0);
 
    return XYZ_TRUE;
 }
@@ -166,7 +210,7 @@ xyz_rbam_prev(xyz_rbam *rbam, u32 index)
 u32
 xyz_rbam_is_full(xyz_rbam *rbam)
 {
-   return (rbam->next == rbam->rd ? XYZ_TRUE : XYZ_FALSE);
+   return (rbam->next == xyz_atomic_ld_acq_u32(&rbam->rd) ? XYZ_TRUE : XYZ_FALSE);
 }
 // xyz_rbam_is_full()
 
@@ -196,17 +240,19 @@ xyz_rbam_is_full(xyz_rbam *rbam)
 u32
 xyz_rbam_write(xyz_rbam *rbam)
 {
-   if ( xyz_rbam_is_full(rbam) == XYZ_TRUE ) { return XYZ_FALSE; }
+   u32 rd = xyz_atomic_ld_acq_u32(&rbam->rd);
+   if ( rbam->next == rd ) { return XYZ_FALSE; }
 
    // The buffer is not full, so the location pointed to by 'next' is
-   // available for writing.
-   rbam->wr = rbam->next;
-   rbam->next = xyz_rbam_next(rbam, rbam->next);
+   // available for writing.  Publishing wr makes the element readable.
+   u32 wr = rbam->next;
+   rbam->next = xyz_rbam_next(rbam, wr);
+   xyz_atomic_st_rel_u32(&rbam->wr, wr);
 
    // Calculate the buffer use.
-   u32 rd = rbam->rd;
-   rbam->used = (rbam->wr >= rd ? rbam->wr - rd : (rbam->dim - rd) + rbam->wr);
-   rbam->free = rbam->dim - rbam->used - 1;
+   u32 used = (wr >= rd ? wr - rd : (rbam->dim - rd) + wr);
+   xyz_atomic_st_rlx_u32(&rbam->used, used);
+   xyz_atomic_st_rlx_u32(&rbam->free, rbam->dim - used - 1);
 
    return XYZ_TRUE;
 }
@@ -228,7 +274,7 @@ xyz_rbam_write(xyz_rbam *rbam)
 u32
 xyz_rbam_is_empty(xyz_rbam *rbam)
 {
-   return (rbam->rd == rbam->wr ? XYZ_TRUE : XYZ_FALSE);
+   return (rbam->rd == xyz_atomic_ld_acq_u32(&rbam->wr) ? XYZ_TRUE : XYZ_FALSE);
 }
 // xyz_rbam_is_empty()
 
@@ -260,15 +306,18 @@ xyz_rbam_is_empty(xyz_rbam *rbam)
 u32
 xyz_rbam_read(xyz_rbam *rbam)
 {
-   if ( xyz_rbam_is_empty(rbam) == XYZ_TRUE ) { return XYZ_FALSE; }
+   u32 wr = xyz_atomic_ld_acq_u32(&rbam->wr);
+   if ( rbam->rd == wr ) { return XYZ_FALSE; }
 
-   // The buffer is not empty, update the read index.
-   rbam->rd = xyz_rbam_next(rbam, rbam->rd);
+   // The buffer is not empty, update the read index.  Publishing rd gives the
+   // element back to the writer.
+   u32 rd = xyz_rbam_next(rbam, rbam->rd);
+   xyz_atomic_st_rel_u32(&rbam->rd, rd);
 
    // Calculate the buffer use.
-   u32 wr = rbam->wr;
-   rbam->used = (wr >= rbam->rd ? wr - rbam->rd : (rbam->dim - rbam->rd) + wr);
-   rbam->free = rbam->dim - rbam->used - 1;
+   u32 used = (wr >= rd ? wr - rd : (rbam->dim - rd) + wr);
+   xyz_atomic_st_rlx_u32(&rbam->used, used);
+   xyz_atomic_st_rlx_u32(&rbam->free, rbam->dim - used - 1);
 
    return XYZ_TRUE;
 }
@@ -285,76 +334,5651 @@ xyz_rbam_read(xyz_rbam *rbam)
 u32
 xyz_rbam_drain(xyz_rbam *rbam)
 {
-   u32 wr = rbam->wr;
+   u32 wr = xyz_atomic_ld_acq_u32(&rbam->wr);
    u32 drained = (wr >= rbam->rd ? wr - rbam->rd : (rbam->dim - rbam->rd) + wr);
-   rbam->rd = rbam->wr;
-   rbam->used = 0;
-   rbam->free = rbam->dim - 1;
+   xyz_atomic_st_rel_u32(&rbam->rd, wr);
+   xyz_atomic_st_rlx_u32(&rbam->used, 0);
+   xyz_atomic_st_rlx_u32(&rbam->free, rbam->dim - 1);
 
    return drained;
 }
 // xyz_rbam_drain()
 
 
+//
+// Batch Functions
+//
+// Instead of moving one element at a time, the writer can reserve a number of
+// free elements, fill them (memcpy, SIMD, etc.), and publish all of them with
+// a single commit.  The reader can likewise peek at a number of used elements
+// and consume all of them at once.  The elements are handed back as up to two
+// contiguous runs of indexes since the region might wrap.
+//
+// Example writer use:
+//
+// xyz_rbam_span span;
+// u32 n = xyz_rbam_reserve(rbam, count, &span);
+// memcpy(&data[span.idx[0]], src, span.len[0] * sizeof(data[0]));
+// memcpy(&data[span.idx[1]], src + span.len[0], span.len[1] * sizeof(data[0]));
+// xyz_rbam_commit(rbam, n);
+//
+
 
-// TODO Finish this basic idea, or dump it...
-#if 0
 /**
- * Initialize a meta data type.
+ * Fill in a span for n elements starting at an index.
  *
- * If the type requires malloc allocation
+ * @param[in]  rbam  pointer to the xyz_rbam structure for the RBAM.
+ * @param[in]  idx   starting index.
+ * @param[in]  n     number of elements, must be <= dim.
+ * @param[out] span  the runs of indexes.
+ */
+static void
+xyz_rbam_span_set(xyz_rbam *rbam, u32 idx, u32 n, xyz_rbam_span *span)
+{
+   u32 tail = rbam->dim - idx;
+   span->idx[0] = idx;
+   span->len[0] = (n < tail ? n : tail);
+   span->idx[1] = 0;
+   span->len[1] = n - span->len[0];
+}
+// xyz_rbam_span_set()
+
+
+/**
+ * Reserve up to n free elements for writing.
  *
+ * Writer function.  Nothing is visible to the reader until
+ * xyz_rbam_commit() is called.
  *
- * @param mt
- * @param type
- * @param alloc
+ * @param[in]  rbam  pointer to the xyz_rbam structure for the RBAM.
+ * @param[in]  n     number of elements wanted.
+ * @param[out] span  the runs of indexes that can be written.
  *
- * @return
+ * @return The number of elements reserved, which is less than n if there is
+ *         not enough free space.
  */
-s32 xyz_meta_init(xyz_meta *mt, u16 type, u16 alloc, u32 dim, void *value)
+u32
+xyz_rbam_reserve(xyz_rbam *rbam, u32 n, xyz_rbam_span *span)
 {
-   s32 rtn = XYZ_ERR;
+   u32 rd = xyz_atomic_ld_acq_u32(&rbam->rd);
+   u32 wr = rbam->wr;
+   u32 used = (wr >= rd ? wr - rd : (rbam->dim - rd) + wr);
+   u32 avail = rbam->dim - used - 1;
 
-   switch ( type )
-   {
-   case XYZ_META_T_ASCII_CHAR :    ///< ASCII padded character.
-   case XYZ_META_T_ASCII_VARCHAR : ///< ASCII variable character.
-   case XYZ_META_T_UTF8_CHAR :     ///< UTF8 padded character.
-   case XYZ_META_T_UTF8_VARCHAR :  ///< UTF8 variable character.
+   if ( n > avail ) { n = avail; }
+   xyz_rbam_span_set(rbam, wr, n, span);
 
-      mt->format = XYZ_META_F_POINTER;
-      mt->type = type;
-      mt->byte_dim = dim;
-      mt->unit_dim = dim; // this is wrong for anything other than ASCII.
+   return n;
+}
+// xyz_rbam_reserve()
 
-      if ( alloc == XYZ_META_P_STATIC )
-      {
-         if ( value != NULL ) {
-            mt->buf.vp = value;
-         } else {
-            // TODO error.
-            break;
-         }
-      }
 
-      else if ( alloc == XYZ_META_P_DYNAMIC )
-      {
+/**
+ * Publish n written elements to the reader with a single index update.
+ *
+ * Writer function, call after writing the elements obtained with
+ * xyz_rbam_reserve().
+ *
+ * @param[in] rbam  pointer to the xyz_rbam structure for the RBAM.
+ * @param[in] n     number of elements written.
+ *
+ * @return The number of elements committed, which is less than n if there
+ *         was not enough free space.
+ */
+u32
+xyz_rbam_commit(xyz_rbam *rbam, u32 n)
+{
+   u32 rd = xyz_atomic_ld_acq_u32(&rbam->rd);
+   u32 wr = rbam->wr;
+   u32 used = (wr >= rd ? wr - rd : (rbam->dim - rd) + wr);
+   u32 avail = rbam->dim - used - 1;
 
-      }
+   if ( n > avail ) { n = avail; }
+   if ( n == 0 ) { return 0; }
 
+   wr += n;
+   if ( wr >= rbam->dim ) { wr -= rbam->dim; }
+   rbam->next = xyz_rbam_next(rbam, wr);
+   xyz_atomic_st_rel_u32(&rbam->wr, wr);
 
-      rtn = XYZ_OK;
-      break;
+   used += n;
+   xyz_atomic_st_rlx_u32(&rbam->used, used);
+   xyz_atomic_st_rlx_u32(&rbam->free, rbam->dim - used - 1);
 
-   default :
-      // TODO unknown.
-      break;
-   }
+   return n;
+}
+// xyz_rbam_commit()
 
-   return rtn;
+
+/**
+ * Get up to n used elements for reading.
+ *
+ * Reader function.  The elements stay in the buffer until
+ * xyz_rbam_consume() is called.
+ *
+ * @param[in]  rbam  pointer to the xyz_rbam structure for the RBAM.
+ * @param[in]  n     number of elements wanted.
+ * @param[out] span  the runs of indexes that can be read.
+ *
+ * @return The number of elements available, which is less than n if there
+ *         is not enough data.
+ */
+u32
+xyz_rbam_peek(xyz_rbam *rbam, u32 n, xyz_rbam_span *span)
+{
+   u32 wr = xyz_atomic_ld_acq_u32(&rbam->wr);
+   u32 rd = rbam->rd;
+   u32 used = (wr >= rd ? wr - rd : (rbam->dim - rd) + wr);
+
+   if ( n > used ) { n = used; }
+   xyz_rbam_span_set(rbam, rd, n, span);
+
+   return n;
 }
-// xyz_meta_init()
-#endif
+// xyz_rbam_peek()
+
+
+/**
+ * Get up to n used elements for reading, starting first elements after the
+ * oldest one.
+ *
+ * Reader function.  Random access into the readable region, i.e. for showing
+ * a scrolled window of the elements, without walking the skipped elements.
+ * Iterate the result like any span:
+ *
+ *    for ( u32 run = 0 ; run < 2 ; run++ )
+ *       for ( u32 i = 0 ; i < span.len[run] ; i++ )
+ *          use(buf[span.idx[run] + i]);
+ *
+ * @param[in]  rbam   pointer to the xyz_rbam structure for the RBAM.
+ * @param[in]  first  number of elements to skip, 0 is the oldest element.
+ * @param[in]  n      number of elements wanted.
+ * @param[out] span   the runs of indexes that can be read.
+ *
+ * @return The number of elements available, which is less than n if there
+ *         is not enough data.
+ */
+u32
+xyz_rbam_peek_at(xyz_rbam *rbam, u32 first, u32 n, xyz_rbam_span *span)
+{
+   u32 wr = xyz_atomic_ld_acq_u32(&rbam->wr);
+   u32 rd = rbam->rd;
+   u32 used = (wr >= rd ? wr - rd : (rbam->dim - rd) + wr);
+
+   if ( first > used ) { first = used; }
+   if ( n > used - first ) { n = used - first; }
+
+   rd += first;
+   if ( rd >= rbam->dim ) { rd -= rbam->dim; }
+   xyz_rbam_span_set(rbam, rd, n, span);
+
+   return n;
+}
+// xyz_rbam_peek_at()
+
+
+/**
+ * Consume n elements with a single index update.
+ *
+ * Reader function, call when done with elements obtained with
+ * xyz_rbam_peek(), or to discard elements.
+ *
+ * @param[in] rbam  pointer to the xyz_rbam structure for the RBAM.
+ * @param[in] n     number of elements consumed.
+ *
+ * @return The number of elements consumed, which is less than n if there
+ *         was not enough data.
+ */
+u32
+xyz_rbam_consume(xyz_rbam *rbam, u32 n)
+{
+   u32 wr = xyz_atomic_ld_acq_u32(&rbam->wr);
+   u32 rd = rbam->rd;
+   u32 used = (wr >= rd ? wr - rd : (rbam->dim - rd) + wr);
+
+   if ( n > used ) { n = used; }
+   if ( n == 0 ) { return 0; }
+
+   rd += n;
+   if ( rd >= rbam->dim ) { rd -= rbam->dim; }
+   xyz_atomic_st_rel_u32(&rbam->rd, rd);
+
+   used -= n;
+   xyz_atomic_st_rlx_u32(&rbam->used, used);
+   xyz_atomic_st_rlx_u32(&rbam->free, rbam->dim - used - 1);
+
+   return n;
+}
+// xyz_rbam_consume()
+
+
+// ==========================================================================
+//
+// Power-of-two ring buffer access manager (RBAM-P2)
+//
+// ==========================================================================
+
+// Same ownership rules as the RBAM: the writer owns wr, the reader owns rd,
+// and each side release-stores its own counter and acquire-loads the other.
+//
+// Because the counters are free-running, (wr - rd) is always the number of
+// used elements, even after the u64 wraps, and no element has to be sacrificed
+// to tell full from empty.
+
+
+/**
+ * Initialize an RBAM-P2 structure for first use.
+ *
+ * @param[in] rb   pointer to the xyz_rbam_p2 structure.
+ * @param[in] dim  the number of elements in the data structure being
+ *                 managed, must be a power of two.
+ *
+ * @return XYZ_TRUE if initialization succeeded, otherwise XYZ_FALSE if dim
+ *         is zero or not a power of two.
+ */
+u32
+xyz_rbam_p2_init(xyz_rbam_p2 *rb, u64 dim)
+{
+   if ( dim == 0 || (dim & (dim - 1)) != 0 ) { return XYZ_FALSE; }
+   rb->dim = dim;
+   rb->mask = dim - 1;
+   xyz_atomic_st_rel_u64(&rb->rd, 0);
+   xyz_atomic_st_rel_u64(&rb->wr, 0);
+
+   return XYZ_TRUE;
+}
+// xyz_rbam_p2_init()
+
+
+/**
+ * Get the number of used elements.
+ *
+ * Exact when called by the reader or writer, a snapshot otherwise.
+ *
+ * @param[in] rb  pointer to the xyz_rbam_p2 structure.
+ *
+ * @return The number of elements available for reading.
+ */
+u64
+xyz_rbam_p2_used(xyz_rbam_p2 *rb)
+{
+   u64 rd = xyz_atomic_ld_acq_u64(&rb->rd);
+   return xyz_atomic_ld_acq_u64(&rb->wr) - rd;
+}
+// xyz_rbam_p2_used()
+
+
+/**
+ * Get the number of free elements.
+ *
+ * @param[in] rb  pointer to the xyz_rbam_p2 structure.
+ *
+ * @return The number of elements available for writing.
+ */
+u64
+xyz_rbam_p2_free(xyz_rbam_p2 *rb)
+{
+   return rb->dim - xyz_rbam_p2_used(rb);
+}
+// xyz_rbam_p2_free()
+
+
+//
+// Writer Functions
+//
+
+
+/**
+ * Checks if a buffer is full.
+ *
+ * @param[in] rb  pointer to the xyz_rbam_p2 structure.
+ *
+ * @return XYZ_TRUE if the buffer is full, otherwise XYZ_FALSE.
+ */
+u32
+xyz_rbam_p2_is_full(xyz_rbam_p2 *rb)
+{
+   return (rb->wr - xyz_atomic_ld_acq_u64(&rb->rd) == rb->dim ? XYZ_TRUE : XYZ_FALSE);
+}
+// xyz_rbam_p2_is_full()
+
+
+/**
+ * Call to indicate the current element has been written.
+ *
+ * Same use as xyz_rbam_write(), with the write index obtained from
+ * xyz_rbam_p2_wr_idx():
+ *
+ * if ( xyz_rbam_p2_is_full(rb) == XYZ_FALSE ) {
+ *   data[xyz_rbam_p2_wr_idx(rb)].field = 1;
+ *   xyz_rbam_p2_write(rb);
+ * }
+ *
+ * @param[in] rb  pointer to the xyz_rbam_p2 structure.
+ *
+ * @return XYZ_TRUE if the write was valid, XYZ_FALSE if the buffer is full.
+ */
+u32
+xyz_rbam_p2_write(xyz_rbam_p2 *rb)
+{
+   u64 wr = rb->wr;
+   if ( wr - xyz_atomic_ld_acq_u64(&rb->rd) == rb->dim ) { return XYZ_FALSE; }
+   xyz_atomic_st_rel_u64(&rb->wr, wr + 1);
+
+   return XYZ_TRUE;
+}
+// xyz_rbam_p2_write()
+
+
+//
+// Reader Functions
+//
+
+
+/**
+ * Checks if a buffer is empty.
+ *
+ * @param[in] rb  pointer to the xyz_rbam_p2 structure.
+ *
+ * @return XYZ_TRUE if the buffer is empty, otherwise XYZ_FALSE.
+ */
+u32
+xyz_rbam_p2_is_empty(xyz_rbam_p2 *rb)
+{
+   return (rb->rd == xyz_atomic_ld_acq_u64(&rb->wr) ? XYZ_TRUE : XYZ_FALSE);
+}
+// xyz_rbam_p2_is_empty()
+
+
+/**
+ * Call to indicate that the current element has been read (past-tense).
+ *
+ * Same use as xyz_rbam_read(), with the read index obtained from
+ * xyz_rbam_p2_rd_idx().
+ *
+ * @param[in] rb  pointer to the xyz_rbam_p2 structure.
+ *
+ * @return XYZ_TRUE if an element was consumed, XYZ_FALSE if the buffer is
+ *         empty.
+ */
+u32
+xyz_rbam_p2_read(xyz_rbam_p2 *rb)
+{
+   u64 rd = rb->rd;
+   if ( rd == xyz_atomic_ld_acq_u64(&rb->wr) ) { return XYZ_FALSE; }
+   xyz_atomic_st_rel_u64(&rb->rd, rd + 1);
+
+   return XYZ_TRUE;
+}
+// xyz_rbam_p2_read()
+
+
+/**
+ * Drains the buffer (makes the buffer empty).
+ *
+ * @param[in] rb  pointer to the xyz_rbam_p2 structure.
+ *
+ * @return The number of elements drained.
+ */
+u64
+xyz_rbam_p2_drain(xyz_rbam_p2 *rb)
+{
+   u64 wr = xyz_atomic_ld_acq_u64(&rb->wr);
+   u64 drained = wr - rb->rd;
+   xyz_atomic_st_rel_u64(&rb->rd, wr);
+
+   return drained;
+}
+// xyz_rbam_p2_drain()
+
+
+// ==========================================================================
+//
+// Cache-line isolated ring buffer access manager (RBAM-CL)
+//
+// ==========================================================================
+
+// The writer only stores to wr and rd_cache, and the reader only stores to rd
+// and wr_cache.  A cached counter is only ever behind the real one, so the
+// worst case of using a stale copy is reporting full or empty too early, at
+// which point the real counter is loaded (with acquire ordering) and the check
+// is repeated.
+
+
+/**
+ * Initialize an RBAM-CL structure for first use.
+ *
+ * @param[in] rb   pointer to the xyz_rbam_cl structure.
+ * @param[in] dim  the number of elements in the data structure being
+ *                 managed, must be a power of two.
+ *
+ * @return XYZ_TRUE if initialization succeeded, otherwise XYZ_FALSE if dim
+ *         is zero or not a power of two.
+ */
+u32
+xyz_rbam_cl_init(xyz_rbam_cl *rb, u64 dim)
+{
+   if ( dim == 0 || (dim & (dim - 1)) != 0 ) { return XYZ_FALSE; }
+   rb->dim = dim;
+   rb->mask = dim - 1;
+   rb->rd_cache = 0;
+   rb->wr_cache = 0;
+   xyz_atomic_st_rel_u64(&rb->rd, 0);
+   xyz_atomic_st_rel_u64(&rb->wr, 0);
+
+   return XYZ_TRUE;
+}
+// xyz_rbam_cl_init()
+
+
+/**
+ * Get the number of used elements.
+ *
+ * Loads both real counters, so this touches both cache lines.  Meant for
+ * status display, not for the hot path.
+ *
+ * @param[in] rb  pointer to the xyz_rbam_cl structure.
+ *
+ * @return The number of elements available for reading.
+ */
+u64
+xyz_rbam_cl_used(xyz_rbam_cl *rb)
+{
+   u64 rd = xyz_atomic_ld_acq_u64(&rb->rd);
+   return xyz_atomic_ld_acq_u64(&rb->wr) - rd;
+}
+// xyz_rbam_cl_used()
+
+
+//
+// Writer Functions
+//
+
+
+/**
+ * Checks if a buffer is full.
+ *
+ * @param[in] rb  pointer to the xyz_rbam_cl structure.
+ *
+ * @return XYZ_TRUE if the buffer is full, otherwise XYZ_FALSE.
+ */
+u32
+xyz_rbam_cl_is_full(xyz_rbam_cl *rb)
+{
+   if ( rb->wr - rb->rd_cache != rb->dim ) { return XYZ_FALSE; }
+
+   // Looks full, see how far the reader really is.
+   rb->rd_cache = xyz_atomic_ld_acq_u64(&rb->rd);
+   return (rb->wr - rb->rd_cache == rb->dim ? XYZ_TRUE : XYZ_FALSE);
+}
+// xyz_rbam_cl_is_full()
+
+
+/**
+ * Call to indicate the current element has been written.
+ *
+ * Same use as xyz_rbam_p2_write(), with the write index obtained from
+ * xyz_rbam_cl_wr_idx().
+ *
+ * @param[in] rb  pointer to the xyz_rbam_cl structure.
+ *
+ * @return XYZ_TRUE if the write was valid, XYZ_FALSE if the buffer is full.
+ */
+u32
+xyz_rbam_cl_write(xyz_rbam_cl *rb)
+{
+   if ( xyz_rbam_cl_is_full(rb) == XYZ_TRUE ) { return XYZ_FALSE; }
+   xyz_atomic_st_rel_u64(&rb->wr, rb->wr + 1);
+
+   return XYZ_TRUE;
+}
+// xyz_rbam_cl_write()
+
+
+//
+// Reader Functions
+//
+
+
+/**
+ * Checks if a buffer is empty.
+ *
+ * @param[in] rb  pointer to the xyz_rbam_cl structure.
+ *
+ * @return XYZ_TRUE if the buffer is empty, otherwise XYZ_FALSE.
+ */
+u32
+xyz_rbam_cl_is_empty(xyz_rbam_cl *rb)
+{
+   if ( rb->rd != rb->wr_cache ) { return XYZ_FALSE; }
+
+   // Looks empty, see how far the writer really is.
+   rb->wr_cache = xyz_atomic_ld_acq_u64(&rb->wr);
+   return (rb->rd == rb->wr_cache ? XYZ_TRUE : XYZ_FALSE);
+}
+// xyz_rbam_cl_is_empty()
+
+
+/**
+ * Call to indicate that the current element has been read (past-tense).
+ *
+ * Same use as xyz_rbam_p2_read(), with the read index obtained from
+ * xyz_rbam_cl_rd_idx().
+ *
+ * @param[in] rb  pointer to the xyz_rbam_cl structure.
+ *
+ * @return XYZ_TRUE if an element was consumed, XYZ_FALSE if the buffer is
+ *         empty.
+ */
+u32
+xyz_rbam_cl_read(xyz_rbam_cl *rb)
+{
+   if ( xyz_rbam_cl_is_empty(rb) == XYZ_TRUE ) { return XYZ_FALSE; }
+   xyz_atomic_st_rel_u64(&rb->rd, rb->rd + 1);
+
+   return XYZ_TRUE;
+}
+// xyz_rbam_cl_read()
+
+
+/**
+ * Drains the buffer (makes the buffer empty).
+ *
+ * @param[in] rb  pointer to the xyz_rbam_cl structure.
+ *
+ * @return The number of elements drained.
+ */
+u64
+xyz_rbam_cl_drain(xyz_rbam_cl *rb)
+{
+   rb->wr_cache = xyz_atomic_ld_acq_u64(&rb->wr);
+   u64 drained = rb->wr_cache - rb->rd;
+   xyz_atomic_st_rel_u64(&rb->rd, rb->wr_cache);
+
+   return drained;
+}
+// xyz_rbam_cl_drain()
+
+
+// ==========================================================================
+//
+// Multi-producer multi-consumer lock-free queue access manager (MPAM)
+//
+// ==========================================================================
+
+// Tickets are free-running u32 counters, the element for a ticket is
+// (ticket & mask), and the element's sequence number says what state it is
+// in for that ticket:
+//
+//   seq == ticket        free, the producer holding the ticket may write it.
+//   seq == ticket + 1    written, the consumer may read it.
+//   seq == ticket + dim  read, free for the producer of the next lap.
+//
+// Producers compete for tickets with a compare-and-swap on wr, and multiple
+// consumers do the same on rd.  A compare-and-swap only fails when another
+// thread got the ticket first, so some thread always makes progress.
+// Comparisons are done on the signed difference so the tickets can wrap.
+
+
+/**
+ * Initialize an MPAM structure for first use.
+ *
+ * @param[in] mp   pointer to the xyz_mpam structure.
+ * @param[in] dim  the number of elements in the data structure being
+ *                 managed, must be a power of two and >= 2.
+ * @param[in] seq  caller-owned array of dim sequence numbers.
+ *
+ * @return XYZ_TRUE if initialization succeeded, otherwise XYZ_FALSE.
+ */
+u32
+xyz_mpam_init(xyz_mpam *mp, u32 dim, u32 *seq)
+{
+   if ( seq == NULL || dim < 2 || dim > 0x80000000 || (dim & (dim - 1)) != 0 ) {
+      return XYZ_FALSE;
+   }
+
+   mp->dim = dim;
+   mp->mask = dim - 1;
+   mp->seq = seq;
+
+   for ( u32 i = 0 ; i < dim ; i++ ) {
+      xyz_atomic_st_rlx_u32(&seq[i], i);
+   }
+
+   xyz_atomic_st_rel_u32(&mp->rd, 0);
+   xyz_atomic_st_rel_u32(&mp->wr, 0);
+
+   return XYZ_TRUE;
+}
+// xyz_mpam_init()
+
+
+/**
+ * Get the approximate number of used elements, including elements that are
+ * reserved but not committed yet.
+ *
+ * @param[in] mp  pointer to the xyz_mpam structure.
+ *
+ * @return The number of elements in use.
+ */
+u32
+xyz_mpam_used(xyz_mpam *mp)
+{
+   u32 rd = xyz_atomic_ld_acq_u32(&mp->rd);
+   u32 used = xyz_atomic_ld_acq_u32(&mp->wr) - rd;
+   return (used > mp->dim ? mp->dim : used);
+}
+// xyz_mpam_used()
+
+
+//
+// Producer Functions
+//
+
+
+/**
+ * Reserve an element for writing.
+ *
+ * Never blocks.  Write the data to the element at xyz_mpam_idx(ticket), then
+ * call xyz_mpam_commit() with the ticket.
+ *
+ * @param[in]  mp      pointer to the xyz_mpam structure.
+ * @param[out] ticket  the ticket for the reserved element.
+ *
+ * @return XYZ_TRUE if an element was reserved, XYZ_FALSE if the queue is full.
+ */
+u32
+xyz_mpam_reserve(xyz_mpam *mp, u32 *ticket)
+{
+   u32 wr = xyz_atomic_ld_rlx_u32(&mp->wr);
+
+   while ( 1 )
+   {
+      u32 seq = xyz_atomic_ld_acq_u32(&mp->seq[wr & mp->mask]);
+      s32 diff = (s32)(seq - wr);
+
+      if ( diff == 0 )
+      {
+         // The element is free for this ticket, try to claim the ticket.
+         if ( xyz_atomic_cas_u32(&mp->wr, wr, wr + 1) == XYZ_TRUE ) {
+            *ticket = wr;
+            return XYZ_TRUE;
+         }
+      }
+
+      else if ( diff < 0 ) {
+         // The element still holds data from the previous lap.
+         return XYZ_FALSE;
+      }
+
+      // Another producer got the ticket, try the current one.
+      wr = xyz_atomic_ld_rlx_u32(&mp->wr);
+   }
+}
+// xyz_mpam_reserve()
+
+
+/**
+ * Make a written element available to the consumer.
+ *
+ * @param[in] mp      pointer to the xyz_mpam structure.
+ * @param[in] ticket  the ticket from xyz_mpam_reserve().
+ */
+void
+xyz_mpam_commit(xyz_mpam *mp, u32 ticket)
+{
+   xyz_atomic_st_rel_u32(&mp->seq[ticket & mp->mask], ticket + 1);
+}
+// xyz_mpam_commit()
+
+
+//
+// Single Consumer Functions
+//
+
+
+/**
+ * Get the oldest element that is ready for reading.
+ *
+ * Single consumer only.  Read the data at xyz_mpam_idx(ticket), then call
+ * xyz_mpam_consume() with the ticket.
+ *
+ * @param[in]  mp      pointer to the xyz_mpam structure.
+ * @param[out] ticket  the ticket of the element to read.
+ *
+ * @return XYZ_TRUE if an element is ready, XYZ_FALSE if the queue is empty or
+ *         the oldest element has not been committed yet.
+ */
+u32
+xyz_mpam_peek(xyz_mpam *mp, u32 *ticket)
+{
+   u32 rd = mp->rd;
+   if ( xyz_atomic_ld_acq_u32(&mp->seq[rd & mp->mask]) != rd + 1 ) {
+      return XYZ_FALSE;
+   }
+
+   *ticket = rd;
+   return XYZ_TRUE;
+}
+// xyz_mpam_peek()
+
+
+/**
+ * Give a read element back to the producers.
+ *
+ * @param[in] mp      pointer to the xyz_mpam structure.
+ * @param[in] ticket  the ticket from xyz_mpam_peek().
+ */
+void
+xyz_mpam_consume(xyz_mpam *mp, u32 ticket)
+{
+   xyz_atomic_st_rel_u32(&mp->rd, ticket + 1);
+   xyz_mpam_release(mp, ticket);
+}
+// xyz_mpam_consume()
+
+
+//
+// Multiple Consumer Functions
+//
+
+
+/**
+ * Claim the oldest element that is ready for reading.
+ *
+ * Any number of consumers.  Never blocks.  Read the data at
+ * xyz_mpam_idx(ticket), then call xyz_mpam_release() with the ticket.
+ *
+ * @param[in]  mp      pointer to the xyz_mpam structure.
+ * @param[out] ticket  the ticket for the claimed element.
+ *
+ * @return XYZ_TRUE if an element was claimed, XYZ_FALSE if the queue is empty
+ *         or the oldest element has not been committed yet.
+ */
+u32
+xyz_mpam_claim(xyz_mpam *mp, u32 *ticket)
+{
+   u32 rd = xyz_atomic_ld_rlx_u32(&mp->rd);
+
+   while ( 1 )
+   {
+      u32 seq = xyz_atomic_ld_acq_u32(&mp->seq[rd & mp->mask]);
+      s32 diff = (s32)(seq - (rd + 1));
+
+      if ( diff == 0 )
+      {
+         // The element is ready for this ticket, try to claim the ticket.
+         if ( xyz_atomic_cas_u32(&mp->rd, rd, rd + 1) == XYZ_TRUE ) {
+            *ticket = rd;
+            return XYZ_TRUE;
+         }
+      }
+
+      else if ( diff < 0 ) {
+         // The element has not been written for this lap.
+         return XYZ_FALSE;
+      }
+
+      // Another consumer got the ticket, try the current one.
+      rd = xyz_atomic_ld_rlx_u32(&mp->rd);
+   }
+}
+// xyz_mpam_claim()
+
+
+/**
+ * Give a read element back to the producers.
+ *
+ * @param[in] mp      pointer to the xyz_mpam structure.
+ * @param[in] ticket  the ticket from xyz_mpam_claim().
+ */
+void
+xyz_mpam_release(xyz_mpam *mp, u32 ticket)
+{
+   xyz_atomic_st_rel_u32(&mp->seq[ticket & mp->mask], ticket + mp->dim);
+}
+// xyz_mpam_release()
+
+
+// ==========================================================================
+//
+// Overwrite-oldest ring buffer access manager (RBOW)
+//
+// ==========================================================================
+
+// Element sequence numbers for position pos:
+//
+//   seq == 2 * pos + 1    the writer is storing element pos.
+//   seq == 2 * pos + 2    element pos is complete.
+//
+// Anything larger means the element was overwritten by a later lap.  The
+// writer publishes wr only after the element is complete, so any pos < wr
+// has been completed at least once.
+
+
+/**
+ * Initialize an RBOW structure for first use.
+ *
+ * @param[in] rb   pointer to the xyz_rbow structure.
+ * @param[in] dim  the number of elements in the data structure being
+ *                 managed, must be a power of two and >= 2.
+ * @param[in] seq  caller-owned array of dim sequence numbers.
+ *
+ * @return XYZ_TRUE if initialization succeeded, otherwise XYZ_FALSE.
+ */
+u32
+xyz_rbow_init(xyz_rbow *rb, u64 dim, u64 *seq)
+{
+   if ( seq == NULL || dim < 2 || (dim & (dim - 1)) != 0 ) {
+      return XYZ_FALSE;
+   }
+
+   rb->dim = dim;
+   rb->mask = dim - 1;
+   rb->seq = seq;
+
+   for ( u64 i = 0 ; i < dim ; i++ ) {
+      xyz_atomic_st_rlx_u64(&seq[i], 0);
+   }
+
+   xyz_atomic_st_rel_u64(&rb->wr, 0);
+
+   return XYZ_TRUE;
+}
+// xyz_rbow_init()
+
+
+//
+// Writer Functions
+//
+
+
+/**
+ * Writer: start writing the next element.
+ *
+ * Never fails, if the buffer is full the oldest element is overwritten.
+ * Write the element at xyz_rbow_idx(pos), then call xyz_rbow_commit(pos).
+ *
+ * @param[in] rb  pointer to the xyz_rbow structure.
+ *
+ * @return The position being written.
+ */
+u64
+xyz_rbow_reserve(xyz_rbow *rb)
+{
+   u64 pos = rb->wr;
+
+   // Mark the element as being written before any of the data stores.
+   xyz_atomic_st_rlx_u64(&rb->seq[pos & rb->mask], (pos * 2) + 1);
+   xyz_atomic_fence();
+
+   return pos;
+}
+// xyz_rbow_reserve()
+
+
+/**
+ * Writer: finish writing an element and make it visible to readers.
+ *
+ * @param[in] rb   pointer to the xyz_rbow structure.
+ * @param[in] pos  the position from xyz_rbow_reserve().
+ */
+void
+xyz_rbow_commit(xyz_rbow *rb, u64 pos)
+{
+   xyz_atomic_st_rel_u64(&rb->seq[pos & rb->mask], (pos * 2) + 2);
+   xyz_atomic_st_rel_u64(&rb->wr, pos + 1);
+}
+// xyz_rbow_commit()
+
+
+//
+// Reader Functions
+//
+
+
+/**
+ * Reader: initialize a cursor.
+ *
+ * The cursor starts back elements before the newest one, or at the oldest
+ * element still in the buffer if there are not that many.  Use 0 to only
+ * read new elements, or the buffer dimension to read everything available.
+ * Can be called again at any time to jump, i.e. every frame to get a
+ * snapshot of the newest elements.  The cursor statistics are not reset.
+ *
+ * @param[in] rb    pointer to the xyz_rbow structure.
+ * @param[in] rd    pointer to the reader's cursor.
+ * @param[in] back  number of elements back from the newest.
+ */
+void
+xyz_rbow_rd_init(xyz_rbow *rb, xyz_rbow_rd *rd, u64 back)
+{
+   u64 wr = xyz_atomic_ld_acq_u64(&rb->wr);
+   if ( back > rb->dim ) { back = rb->dim; }
+   rd->pos = (wr > back ? wr - back : 0);
+}
+// xyz_rbow_rd_init()
+
+
+/**
+ * Reader: get the next element to read.
+ *
+ * Skips ahead past any elements that were already overwritten, and counts
+ * them as lost.  Copy the element at xyz_rbow_idx(pos), then call
+ * xyz_rbow_consume(pos) to find out if the copy is good.
+ *
+ * @param[in]  rb   pointer to the xyz_rbow structure.
+ * @param[in]  rd   pointer to the reader's cursor.
+ * @param[out] pos  the position to read.
+ *
+ * @return XYZ_TRUE if there is an element to read, otherwise XYZ_FALSE.
+ */
+u32
+xyz_rbow_peek(xyz_rbow *rb, xyz_rbow_rd *rd, u64 *pos)
+{
+   while ( 1 )
+   {
+      u64 wr = xyz_atomic_ld_acq_u64(&rb->wr);
+      if ( rd->pos >= wr ) { return XYZ_FALSE; }
+
+      // The writer lapped the reader.
+      if ( wr - rd->pos > rb->dim ) {
+         rd->lost += (wr - rb->dim) - rd->pos;
+         rd->pos = wr - rb->dim;
+      }
+
+      // Complete and not overwritten (yet).
+      u64 seq = xyz_atomic_ld_acq_u64(&rb->seq[rd->pos & rb->mask]);
+      if ( seq == (rd->pos * 2) + 2 ) {
+         *pos = rd->pos;
+         return XYZ_TRUE;
+      }
+
+      // Already being overwritten, move on.
+      rd->lost++;
+      rd->pos++;
+   }
+}
+// xyz_rbow_peek()
+
+
+/**
+ * Reader: finish reading an element and advance the cursor.
+ *
+ * @param[in] rb   pointer to the xyz_rbow structure.
+ * @param[in] rd   pointer to the reader's cursor.
+ * @param[in] pos  the position from xyz_rbow_peek().
+ *
+ * @return XYZ_TRUE if the copy is good, XYZ_FALSE if the writer overwrote
+ *         the element during the copy and it must be discarded.
+ */
+u32
+xyz_rbow_consume(xyz_rbow *rb, xyz_rbow_rd *rd, u64 pos)
+{
+   // The element copy must complete before the sequence is checked again.
+   xyz_atomic_fence();
+   u64 seq = xyz_atomic_ld_rlx_u64(&rb->seq[pos & rb->mask]);
+
+   rd->pos = pos + 1;
+
+   if ( seq != (pos * 2) + 2 ) {
+      rd->torn++;
+      return XYZ_FALSE;
+   }
+
+   rd->reads++;
+   return XYZ_TRUE;
+}
+// xyz_rbow_consume()
+
+
+// ==========================================================================
+//
+// Variable-length record ring buffer access manager (RBVL)
+//
+// ==========================================================================
+
+// Bytes a record with a payload of len takes in the buffer.
+#define XYZ_RBVL_SIZE(len) ((((u64)(len) + XYZ_RBVL_HDR) + (XYZ_RBVL_ALIGN - 1)) & ~(u64)(XYZ_RBVL_ALIGN - 1))
+
+
+/**
+ * Allocate a mirrored buffer.
+ *
+ * The same physical pages are mapped twice, back-to-back, so buf[i] and
+ * buf[i + dim] are the same byte for i < dim, and any run of up to dim bytes
+ * starting in the buffer is contiguous.  Linux uses memfd_create and mmap,
+ * Windows uses a page-file mapping viewed twice.  Not available elsewhere.
+ *
+ * @param[in,out] dim  requested size in bytes, rounded up to the system
+ *                     allocation granularity on return.  A power of two
+ *                     stays a power of two.
+ *
+ * @return Pointer to the buffer, or NULL if a mirror could not be made (the
+ *         caller should fall back to a normal allocation).
+ */
+u8 *
+xyz_vmirror_alloc(u64 *dim)
+{
+#if defined(_WIN32)
+   SYSTEM_INFO si;
+   GetSystemInfo(&si);
+   u64 gran = si.dwAllocationGranularity;
+   u64 size = ((*dim + gran - 1) / gran) * gran;
+
+   HANDLE map = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+         (DWORD)(size >> 32), (DWORD)size, NULL);
+   if ( map == NULL ) { return NULL; }
+
+   // Find a free address range twice the size, release it, then map both
+   // views into it.  Another thread can take the range in between, so retry.
+   u8 *rtn = NULL;
+   for ( u32 tries = 0 ; tries < 16 && rtn == NULL ; tries++ )
+   {
+      u8 *addr = (u8 *)VirtualAlloc(NULL, (SIZE_T)(size * 2), MEM_RESERVE, PAGE_NOACCESS);
+      if ( addr == NULL ) { break; }
+      VirtualFree(addr, 0, MEM_RELEASE);
+
+      u8 *lo = (u8 *)MapViewOfFileEx(map, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)size, addr);
+      u8 *hi = (u8 *)MapViewOfFileEx(map, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)size, addr + size);
+
+      if ( lo == addr && hi == addr + size ) {
+         rtn = addr;
+      } else {
+         if ( lo != NULL ) { UnmapViewOfFile(lo); }
+         if ( hi != NULL ) { UnmapViewOfFile(hi); }
+      }
+   }
+
+   // The views keep the mapping alive.
+   CloseHandle(map);
+
+   if ( rtn != NULL ) { *dim = size; }
+   return rtn;
+
+#elif defined(__linux__)
+   u64 page = (u64)sysconf(_SC_PAGESIZE);
+   u64 size = ((*dim + page - 1) / page) * page;
+
+   s32 fd = memfd_create("xyz_vmirror", MFD_CLOEXEC);
+   if ( fd < 0 ) { return NULL; }
+
+   u8 *rtn = NULL;
+
+   XYZ_BLOCK
+
+   if ( ftruncate(fd, (off_t)size) != 0 ) { XYZ_BREAK }
+
+   // Reserve twice the size, then map the file over each half.
+   u8 *addr = (u8 *)mmap(NULL, size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if ( addr == MAP_FAILED ) { XYZ_BREAK }
+
+   if ( mmap(addr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(addr + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ) {
+      munmap(addr, size * 2);
+      XYZ_BREAK
+   }
+
+   rtn = addr;
+   *dim = size;
+   XYZ_END
+
+   // The mappings keep the memory alive.
+   close(fd);
+   return rtn;
+
+#else
+   (void)dim;
+   return NULL;
+#endif
+}
+// xyz_vmirror_alloc()
+
+
+/**
+ * Free a mirrored buffer.
+ *
+ * @param[in] buf  buffer from xyz_vmirror_alloc(), can be NULL.
+ * @param[in] dim  the dim returned by xyz_vmirror_alloc().
+ */
+void
+xyz_vmirror_free(u8 *buf, u64 dim)
+{
+   if ( buf == NULL ) { return; }
+
+#if defined(_WIN32)
+   UnmapViewOfFile(buf);
+   UnmapViewOfFile(buf + dim);
+#elif defined(__linux__)
+   munmap(buf, dim * 2);
+#else
+   (void)dim;
+#endif
+}
+// xyz_vmirror_free()
+
+
+/**
+ * Initialize an RBVL structure for first use.
+ *
+ * @param[in] rb     pointer to the xyz_rbvl structure.
+ * @param[in] buf    caller-owned byte buffer, XYZ_RBVL_ALIGN aligned.
+ * @param[in] dim    the size of the buffer in bytes, must be a power of two
+ *                   and at least 4 * XYZ_RBVL_HDR.
+ * @param[in] flags  XYZ_RBVL_F_MIRROR if buf is from xyz_vmirror_alloc(),
+ *                   otherwise 0.
+ *
+ * @return XYZ_TRUE if initialization succeeded, otherwise XYZ_FALSE.
+ */
+u32
+xyz_rbvl_init(xyz_rbvl *rb, u8 *buf, u64 dim, u32 flags)
+{
+   if ( buf == NULL || dim < (4 * XYZ_RBVL_HDR) || (dim & (dim - 1)) != 0 ||
+        dim > ((u64)XYZ_RBVL_PAD * 2) || ((size_t)buf & (XYZ_RBVL_ALIGN - 1)) != 0 ) {
+      return XYZ_FALSE;
+   }
+
+   rb->dim = dim;
+   rb->mask = dim - 1;
+   rb->buf = buf;
+   rb->rsv = 0;
+   rb->flags = flags;
+   xyz_atomic_st_rel_u64(&rb->rd, 0);
+   xyz_atomic_st_rel_u64(&rb->wr, 0);
+
+   return XYZ_TRUE;
+}
+// xyz_rbvl_init()
+
+
+/**
+ * Get the number of used bytes, including record headers and padding.
+ *
+ * Exact when called by the reader or writer, a snapshot otherwise.
+ *
+ * @param[in] rb  pointer to the xyz_rbvl structure.
+ *
+ * @return The number of bytes in use.
+ */
+u64
+xyz_rbvl_used(xyz_rbvl *rb)
+{
+   u64 rd = xyz_atomic_ld_acq_u64(&rb->rd);
+   return xyz_atomic_ld_acq_u64(&rb->wr) - rd;
+}
+// xyz_rbvl_used()
+
+
+/**
+ * Get the number of free bytes.
+ *
+ * Not all free bytes may be usable by a single record, since records are
+ * contiguous.
+ *
+ * @param[in] rb  pointer to the xyz_rbvl structure.
+ *
+ * @return The number of bytes not in use.
+ */
+u64
+xyz_rbvl_free(xyz_rbvl *rb)
+{
+   return rb->dim - xyz_rbvl_used(rb);
+}
+// xyz_rbvl_free()
+
+
+//
+// Writer Functions
+//
+
+
+/**
+ * Writer: reserve contiguous space for a record.
+ *
+ * Nothing is visible to the reader until xyz_rbvl_commit() is called.  A
+ * second reserve without a commit replaces the first.
+ *
+ * @param[in] rb   pointer to the xyz_rbvl structure.
+ * @param[in] len  payload length in bytes.
+ *
+ * @return Pointer to len contiguous payload bytes, or NULL if there is not
+ *         enough room right now.
+ */
+u8 *
+xyz_rbvl_reserve(xyz_rbvl *rb, u32 len)
+{
+   if ( len >= XYZ_RBVL_PAD ) { return NULL; }
+
+   u64 wr = rb->wr;
+   u64 size = XYZ_RBVL_SIZE(len);
+   u64 tail = rb->dim - (wr & rb->mask);
+   u64 pad = (size > tail && (rb->flags & XYZ_RBVL_F_MIRROR) == 0 ? tail : 0);
+
+   u64 rd = xyz_atomic_ld_acq_u64(&rb->rd);
+   if ( (wr - rd) + pad + size > rb->dim ) { return NULL; }
+
+   // Fill the rest of the buffer with a pad record, it is only published
+   // with the record on commit.
+   if ( pad > 0 ) {
+      *(u32 *)(rb->buf + (wr & rb->mask)) = XYZ_RBVL_PAD | (u32)pad;
+   }
+
+   rb->rsv = wr + pad;
+   return rb->buf + (rb->rsv & rb->mask) + XYZ_RBVL_HDR;
+}
+// xyz_rbvl_reserve()
+
+
+/**
+ * Writer: publish a reserved record.
+ *
+ * @param[in] rb   pointer to the xyz_rbvl structure.
+ * @param[in] len  the actual payload length, no more than was reserved.
+ */
+void
+xyz_rbvl_commit(xyz_rbvl *rb, u32 len)
+{
+   *(u32 *)(rb->buf + (rb->rsv & rb->mask)) = len;
+   xyz_atomic_st_rel_u64(&rb->wr, rb->rsv + XYZ_RBVL_SIZE(len));
+}
+// xyz_rbvl_commit()
+
+
+//
+// Reader Functions
+//
+
+
+/**
+ * Reader: get the oldest record.
+ *
+ * @param[in]  rb   pointer to the xyz_rbvl structure.
+ * @param[out] len  payload length of the record, can be NULL.
+ *
+ * @return Pointer to the payload, or NULL if the buffer is empty.
+ */
+u8 *
+xyz_rbvl_peek(xyz_rbvl *rb, u32 *len)
+{
+   u64 wr = xyz_atomic_ld_acq_u64(&rb->wr);
+   u64 rd = rb->rd;
+
+   while ( rd != wr )
+   {
+      u32 hdr = *(u32 *)(rb->buf + (rd & rb->mask));
+
+      if ( (hdr & XYZ_RBVL_PAD) == 0 ) {
+         if ( len != NULL ) { *len = hdr; }
+         return rb->buf + (rd & rb->mask) + XYZ_RBVL_HDR;
+      }
+
+      // Free the pad so the writer can use it.
+      rd += (hdr & ~XYZ_RBVL_PAD);
+      xyz_atomic_st_rel_u64(&rb->rd, rd);
+   }
+
+   return NULL;
+}
+// xyz_rbvl_peek()
+
+
+/**
+ * Reader: free the oldest record.
+ *
+ * Can be called without xyz_rbvl_peek() to drop the oldest record, i.e. to
+ * evict records to make room when the reader and writer are the same.
+ *
+ * @param[in] rb  pointer to the xyz_rbvl structure.
+ *
+ * @return XYZ_TRUE if a record was freed, XYZ_FALSE if the buffer is empty.
+ */
+u32
+xyz_rbvl_consume(xyz_rbvl *rb)
+{
+   u32 len;
+   if ( xyz_rbvl_peek(rb, &len) == NULL ) { return XYZ_FALSE; }
+
+   xyz_atomic_st_rel_u64(&rb->rd, rb->rd + XYZ_RBVL_SIZE(len));
+   return XYZ_TRUE;
+}
+// xyz_rbvl_consume()
+
+
+// ==========================================================================
+//
+// Heap allocation and optional per-call-site tracking
+//
+// ==========================================================================
+
+#if defined(XYZ_MEM_TRACK)
+
+// Every tracked allocation is preceded by a header recording its size and
+// call site, so a free can be charged back to the site that allocated it.
+// The header is 16 bytes to keep the malloc alignment.  Call sites are in a
+// small open-addressed hash table keyed on the file name pointer (the
+// __FILE__ literal is the same pointer for every call in a file) and line.
+//
+// These functions must call libc directly, the xyz_malloc macros point back
+// here.
+
+/// Tracked allocation header.
+typedef struct unused_tag_xyz_mem_hdr {
+   u64   size;    ///< Requested size.
+   u32   site;    ///< Index in the site table.
+   u32   magic;   ///< XYZ_MEM_MAGIC while allocated.
+} xyz_mem_hdr;
+
+#define XYZ_MEM_MAGIC 0x584D454D           ///< "XMEM"
+#define XYZ_MEM_MAGIC_ALIGNED 0x414D454D   ///< "AMEM", from xyz_aligned_malloc().
+
+static xyz_mem_site xyz_mem_sites[XYZ_MEM_SITE_DIM];
+static xyz_mem_site xyz_mem_total;
+static u32 xyz_mem_lock;
+
+
+/**
+ * Take the tracking lock.
+ */
+static void
+xyz_mem_lock_take(void)
+{
+   while ( xyz_atomic_cas_u32(&xyz_mem_lock, 0, 1) == XYZ_FALSE ) {
+      while ( xyz_atomic_ld_rlx_u32(&xyz_mem_lock) != 0 ) { xyz_cpu_relax(); }
+   }
+}
+// xyz_mem_lock_take()
+
+
+/**
+ * Release the tracking lock.
+ */
+static void
+xyz_mem_lock_give(void)
+{
+   xyz_atomic_st_rel_u32(&xyz_mem_lock, 0);
+}
+// xyz_mem_lock_give()
+
+
+/**
+ * Find or add the entry for a call site.  Tracking lock held.
+ *
+ * @param[in] file  source file name.
+ * @param[in] line  source line.
+ *
+ * @return Index of the site entry.
+ */
+static u32
+xyz_mem_site_find(const c8 *file, u32 line)
+{
+   u32 hash = (u32)(((size_t)file >> 3) * 2654435761u) ^ (line * 40503u);
+   u32 probe = XYZ_MEM_SITE_DIM - 1;  // The last entry is the overflow.
+
+   for ( u32 i = 0 ; i < probe ; i++ )
+   {
+      u32 idx = (hash + i) % probe;
+      xyz_mem_site *s = &xyz_mem_sites[idx];
+
+      if ( s->file == NULL ) {
+         s->file = file;
+         s->line = line;
+         return idx;
+      }
+
+      if ( s->file == file && s->line == line ) {
+         return idx;
+      }
+   }
+
+   xyz_mem_sites[XYZ_MEM_SITE_DIM - 1].file = "(other)";
+   return XYZ_MEM_SITE_DIM - 1;
+}
+// xyz_mem_site_find()
+
+
+/**
+ * Charge an allocation to a site and the total.  Tracking lock held.
+ *
+ * @param[in] s   site entry.
+ * @param[in] sz  allocation size.
+ */
+static void
+xyz_mem_charge(xyz_mem_site *s, u64 sz)
+{
+   s->allocs++;
+   s->bytes += sz;
+   s->live++;
+   s->live_bytes += sz;
+   if ( s->live_bytes > s->peak_bytes ) { s->peak_bytes = s->live_bytes; }
+}
+// xyz_mem_charge()
+
+
+/**
+ * Credit a free to a site and the total.  Tracking lock held.
+ *
+ * @param[in] s   site entry.
+ * @param[in] sz  allocation size.
+ */
+static void
+xyz_mem_credit(xyz_mem_site *s, u64 sz)
+{
+   s->frees++;
+   s->live--;
+   s->live_bytes -= sz;
+}
+// xyz_mem_credit()
+
+
+/**
+ * Tracked malloc, use xyz_malloc().
+ *
+ * @param[in] sz    number of bytes.
+ * @param[in] file  call site file.
+ * @param[in] line  call site line.
+ *
+ * @return Pointer to the memory, or NULL on failure.
+ */
+void *
+xyz_mem_malloc(size_t sz, const c8 *file, u32 line)
+{
+   if ( sz > SIZE_MAX - sizeof(xyz_mem_hdr) ) { return NULL; }
+
+   xyz_mem_hdr *hdr = (xyz_mem_hdr *)malloc(sizeof(xyz_mem_hdr) + sz);
+   if ( hdr == NULL ) { return NULL; }
+
+   hdr->size = sz;
+   hdr->magic = XYZ_MEM_MAGIC;
+
+   xyz_mem_lock_take();
+   hdr->site = xyz_mem_site_find(file, line);
+   xyz_mem_charge(&xyz_mem_sites[hdr->site], sz);
+   xyz_mem_charge(&xyz_mem_total, sz);
+   xyz_mem_lock_give();
+
+   return hdr + 1;
+}
+// xyz_mem_malloc()
+
+
+/**
+ * Tracked calloc, use xyz_calloc().
+ *
+ * @param[in] num   number of elements.
+ * @param[in] sz    size of an element.
+ * @param[in] file  call site file.
+ * @param[in] line  call site line.
+ *
+ * @return Pointer to the zeroed memory, or NULL on failure.
+ */
+void *
+xyz_mem_calloc(size_t num, size_t sz, const c8 *file, u32 line)
+{
+   if ( sz != 0 && num > SIZE_MAX / sz ) { return NULL; }
+
+   void *p = xyz_mem_malloc(num * sz, file, line);
+   if ( p != NULL ) { memset(p, 0, num * sz); }
+
+   return p;
+}
+// xyz_mem_calloc()
+
+
+/**
+ * Tracked free, use xyz_free().
+ *
+ * @param[in] ptr  memory from a tracked allocation, can be NULL.
+ */
+void
+xyz_mem_free(void *ptr)
+{
+   if ( ptr == NULL ) { return; }
+
+   xyz_mem_hdr *hdr = (xyz_mem_hdr *)ptr - 1;
+
+   // Catch double frees and pointers that were not tracked.
+   if ( hdr->magic != XYZ_MEM_MAGIC ) {
+      fprintf(stderr, "xyz_mem_free: bad or double free of %p\n", ptr);
+      return;
+   }
+
+   hdr->magic = 0;
+
+   xyz_mem_lock_take();
+   xyz_mem_credit(&xyz_mem_sites[hdr->site], hdr->size);
+   xyz_mem_credit(&xyz_mem_total, hdr->size);
+   xyz_mem_lock_give();
+
+   free(hdr);
+}
+// xyz_mem_free()
+
+
+/**
+ * Tracked realloc, use xyz_realloc().
+ *
+ * The new allocation is charged to the realloc call site.
+ *
+ * @param[in] ptr   memory from a tracked allocation, can be NULL.
+ * @param[in] sz    new size in bytes.
+ * @param[in] file  call site file.
+ * @param[in] line  call site line.
+ *
+ * @return Pointer to the memory, or NULL on failure (ptr is unchanged).
+ */
+void *
+xyz_mem_realloc(void *ptr, size_t sz, const c8 *file, u32 line)
+{
+   if ( ptr == NULL ) { return xyz_mem_malloc(sz, file, line); }
+
+   void *p = xyz_mem_malloc(sz, file, line);
+   if ( p == NULL ) { return NULL; }
+
+   u64 old = ((xyz_mem_hdr *)ptr - 1)->size;
+   memcpy(p, ptr, (size_t)(old < sz ? old : sz));
+   xyz_mem_free(ptr);
+
+   return p;
+}
+// xyz_mem_realloc()
+
+
+/**
+ * Tracked aligned malloc, use xyz_aligned_malloc().
+ *
+ * The block is over-allocated by align - 1 bytes plus the header and a
+ * pointer back to the start of the block, which sits just before the
+ * header.  The padding left over after aligning is charged as waste.
+ *
+ * @param[in] sz     number of bytes.
+ * @param[in] align  alignment, a power of two.
+ * @param[in] file   call site file.
+ * @param[in] line   call site line.
+ *
+ * @return Pointer to the aligned memory, or NULL on failure.
+ */
+void *
+xyz_mem_aligned_malloc(size_t sz, size_t align, const c8 *file, u32 line)
+{
+   const size_t extra = sizeof(void *) + sizeof(xyz_mem_hdr);
+
+   if ( align < sizeof(void *) ) { align = sizeof(void *); }
+   if ( (align & (align - 1)) != 0 || sz > SIZE_MAX - extra - (align - 1) ) { return NULL; }
+
+   u8 *raw = (u8 *)malloc(sz + extra + (align - 1));
+   if ( raw == NULL ) { return NULL; }
+
+   u8 *p = (u8 *)(((size_t)raw + extra + (align - 1)) & ~(align - 1));
+   xyz_mem_hdr *hdr = (xyz_mem_hdr *)p - 1;
+   ((void **)hdr)[-1] = raw;
+
+   hdr->size = sz;
+   hdr->magic = XYZ_MEM_MAGIC_ALIGNED;
+
+   u64 waste = (u64)(p - raw) - extra;
+
+   xyz_mem_lock_take();
+   hdr->site = xyz_mem_site_find(file, line);
+   xyz_mem_charge(&xyz_mem_sites[hdr->site], sz);
+   xyz_mem_charge(&xyz_mem_total, sz);
+   xyz_mem_sites[hdr->site].waste += waste;
+   xyz_mem_total.waste += waste;
+   xyz_mem_lock_give();
+
+   return p;
+}
+// xyz_mem_aligned_malloc()
+
+
+/**
+ * Tracked aligned free, use xyz_aligned_free().
+ *
+ * @param[in] ptr  memory from xyz_aligned_malloc(), can be NULL.
+ */
+void
+xyz_mem_aligned_free(void *ptr)
+{
+   if ( ptr == NULL ) { return; }
+
+   xyz_mem_hdr *hdr = (xyz_mem_hdr *)ptr - 1;
+
+   // Catch double frees and pointers that were not from xyz_aligned_malloc().
+   if ( hdr->magic != XYZ_MEM_MAGIC_ALIGNED ) {
+      fprintf(stderr, "xyz_mem_aligned_free: bad or double free of %p\n", ptr);
+      return;
+   }
+
+   hdr->magic = 0;
+
+   xyz_mem_lock_take();
+   xyz_mem_credit(&xyz_mem_sites[hdr->site], hdr->size);
+   xyz_mem_credit(&xyz_mem_total, hdr->size);
+   xyz_mem_lock_give();
+
+   free(((void **)hdr)[-1]);
+}
+// xyz_mem_aligned_free()
+
+
+/**
+ * Copy the current allocation statistics.
+ *
+ * @param[out] sites  array for the call site entries, can be NULL.
+ * @param[in]  dim    dimension of the sites array.
+ * @param[out] total  the totals for all sites, can be NULL.
+ *
+ * @return The number of entries copied to sites.
+ */
+u32
+xyz_mem_snapshot(xyz_mem_site *sites, u32 dim, xyz_mem_site *total)
+{
+   u32 n = 0;
+
+   xyz_mem_lock_take();
+
+   for ( u32 i = 0 ; i < XYZ_MEM_SITE_DIM && sites != NULL && n < dim ; i++ ) {
+      if ( xyz_mem_sites[i].file != NULL ) { sites[n++] = xyz_mem_sites[i]; }
+   }
+
+   if ( total != NULL ) { *total = xyz_mem_total; }
+
+   xyz_mem_lock_give();
+
+   return n;
+}
+// xyz_mem_snapshot()
+
+
+/**
+ * Write the allocation statistics for every call site to stderr.
+ *
+ * Call at exit, any site with live allocations is leaking.
+ */
+void
+xyz_mem_dump(void)
+{
+   static xyz_mem_site sites[XYZ_MEM_SITE_DIM];
+   xyz_mem_site total;
+   u32 n = xyz_mem_snapshot(sites, XYZ_MEM_SITE_DIM, &total);
+
+   fprintf(stderr, "%-32s %10s %10s %14s %10s %14s %14s %10s\n",
+         "site", "allocs", "frees", "bytes", "live", "live bytes", "peak bytes", "waste");
+
+   for ( u32 i = 0 ; i < n ; i++ )
+   {
+      c8 site[64];
+      snprintf(site, sizeof(site), "%s:%u", sites[i].file, sites[i].line);
+      fprintf(stderr, "%-32s %10llu %10llu %14llu %10llu %14llu %14llu %10llu%s\n", site,
+            (unsigned long long)sites[i].allocs, (unsigned long long)sites[i].frees,
+            (unsigned long long)sites[i].bytes, (unsigned long long)sites[i].live,
+            (unsigned long long)sites[i].live_bytes, (unsigned long long)sites[i].peak_bytes,
+            (unsigned long long)sites[i].waste,
+            (sites[i].live != 0 ? "  LEAK" : ""));
+   }
+
+   fprintf(stderr, "%-32s %10llu %10llu %14llu %10llu %14llu %14llu %10llu\n", "total",
+         (unsigned long long)total.allocs, (unsigned long long)total.frees,
+         (unsigned long long)total.bytes, (unsigned long long)total.live,
+         (unsigned long long)total.live_bytes, (unsigned long long)total.peak_bytes,
+         (unsigned long long)total.waste);
+}
+// xyz_mem_dump()
+
+#else // XYZ_MEM_TRACK
+
+
+/**
+ * Allocate aligned memory, release it with xyz_aligned_free().
+ *
+ * @param[in] sz     number of bytes.
+ * @param[in] align  alignment, a power of two.
+ *
+ * @return Pointer to the aligned memory, or NULL on failure.
+ */
+void *
+xyz_aligned_malloc(size_t sz, size_t align)
+{
+   if ( align < sizeof(void *) ) { align = sizeof(void *); }
+   if ( (align & (align - 1)) != 0 ) { return NULL; }
+
+#if defined(_WIN32)
+   // MSVC and MinGW both use the CRT, which has no posix_memalign().
+   return _aligned_malloc(sz, align);
+#else
+   void *p = NULL;
+   if ( posix_memalign(&p, align, sz) != 0 ) { return NULL; }
+   return p;
+#endif
+}
+// xyz_aligned_malloc()
+
+
+/**
+ * Free memory from xyz_aligned_malloc().
+ *
+ * @param[in] ptr  memory from xyz_aligned_malloc(), can be NULL.
+ */
+void
+xyz_aligned_free(void *ptr)
+{
+#if defined(_WIN32)
+   _aligned_free(ptr);
+#else
+   free(ptr);
+#endif
+}
+// xyz_aligned_free()
+
+#endif // XYZ_MEM_TRACK
+
+
+// ==========================================================================
+//
+// Resident virtual memory for large long-lived buffers
+//
+// ==========================================================================
+
+// Transparent huge pages only back aligned extents of this size, and it is
+// also the default explicit huge page size on x86-64 and ARM64 Linux.
+#define XYZ_VMEM_HUGE_DIM ((u64)2 * 1024 * 1024)
+
+
+#if defined(_WIN32)
+/**
+ * Enable the "Lock pages in memory" privilege in the process token, which
+ * is required for large pages.  The account must already hold it.
+ *
+ * @return XYZ_TRUE if the privilege is enabled, otherwise XYZ_FALSE.
+ */
+static u32
+xyz_vmem_large_privilege(void)
+{
+   HANDLE token;
+   if ( OpenProcessToken(GetCurrentProcess(),
+         TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token) == 0 ) {
+      return XYZ_FALSE;
+   }
+
+   TOKEN_PRIVILEGES tp;
+   tp.PrivilegeCount = 1;
+   tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+   u32 rtn = XYZ_FALSE;
+   if ( LookupPrivilegeValueA(NULL, "SeLockMemoryPrivilege", &tp.Privileges[0].Luid) != 0 &&
+        AdjustTokenPrivileges(token, FALSE, &tp, 0, NULL, NULL) != 0 &&
+        GetLastError() == ERROR_SUCCESS ) {
+      rtn = XYZ_TRUE;
+   }
+
+   CloseHandle(token);
+   return rtn;
+}
+// xyz_vmem_large_privilege()
+#endif
+
+
+/**
+ * Allocate a region directly from the OS.
+ *
+ * @param[in,out] dim    requested size in bytes, rounded up to the page size
+ *                       (or huge page size) on return.
+ * @param[in,out] flags  XYZ_VMEM_F_* options requested, on return the
+ *                       options granted plus XYZ_VMEM_F_MAPPED.  Set to 0 if
+ *                       the allocation fails.
+ *
+ * @return Pointer to the zeroed region, or NULL if it could not be mapped
+ *         (the caller should fall back to a normal allocation).
+ */
+void *
+xyz_vmem_alloc(u64 *dim, u32 *flags)
+{
+   u32 want = *flags;
+   u32 got = XYZ_VMEM_F_MAPPED;
+   *flags = 0;
+
+#if defined(_WIN32)
+   SYSTEM_INFO si;
+   GetSystemInfo(&si);
+   u64 page = si.dwPageSize;
+   u64 size = ((*dim + page - 1) / page) * page;
+   u8 *rtn = NULL;
+
+   // Large pages are physically committed when allocated and can never be
+   // paged out, so they are also populated and locked.
+   u64 large = (u64)GetLargePageMinimum();
+   if ( (want & (XYZ_VMEM_F_HUGE | XYZ_VMEM_F_HUGETLB)) != 0 && large != 0 &&
+        xyz_vmem_large_privilege() == XYZ_TRUE )
+   {
+      u64 lsize = ((*dim + large - 1) / large) * large;
+      rtn = (u8 *)VirtualAlloc(NULL, (SIZE_T)lsize,
+            MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+      if ( rtn != NULL ) {
+         size = lsize;
+         got |= want & (XYZ_VMEM_F_HUGE | XYZ_VMEM_F_HUGETLB | XYZ_VMEM_F_POPULATE | XYZ_VMEM_F_LOCK);
+      }
+   }
+
+   if ( rtn == NULL )
+   {
+      rtn = (u8 *)VirtualAlloc(NULL, (SIZE_T)size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+      if ( rtn == NULL ) { return NULL; }
+   }
+
+#elif defined(__linux__)
+   u64 page = (u64)sysconf(_SC_PAGESIZE);
+   u64 size = ((*dim + page - 1) / page) * page;
+   u64 hsize = ((*dim + XYZ_VMEM_HUGE_DIM - 1) / XYZ_VMEM_HUGE_DIM) * XYZ_VMEM_HUGE_DIM;
+   s32 populate = (want & XYZ_VMEM_F_POPULATE) != 0 ? MAP_POPULATE : 0;
+   u8 *rtn = (u8 *)MAP_FAILED;
+
+#if defined(MAP_HUGETLB)
+   if ( (want & XYZ_VMEM_F_HUGETLB) != 0 )
+   {
+      rtn = (u8 *)mmap(NULL, hsize, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | populate, -1, 0);
+      if ( rtn != MAP_FAILED ) {
+         size = hsize;
+         got |= XYZ_VMEM_F_HUGETLB | (want & XYZ_VMEM_F_POPULATE);
+      }
+   }
+#endif
+
+#if defined(MADV_HUGEPAGE)
+   if ( rtn == MAP_FAILED && (want & XYZ_VMEM_F_HUGE) != 0 )
+   {
+      // Over-map by one huge page and trim, so the region starts on a huge
+      // page boundary.  The advice has to be given before the first touch,
+      // so the region is populated afterward instead of by mmap.
+      u8 *addr = (u8 *)mmap(NULL, hsize + XYZ_VMEM_HUGE_DIM, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if ( addr != MAP_FAILED )
+      {
+         u8 *start = (u8 *)(((uintptr_t)addr + XYZ_VMEM_HUGE_DIM - 1) & ~(uintptr_t)(XYZ_VMEM_HUGE_DIM - 1));
+         u64 head = (u64)(start - addr);
+         if ( head > 0 ) { munmap(addr, head); }
+         if ( head < XYZ_VMEM_HUGE_DIM ) { munmap(start + hsize, XYZ_VMEM_HUGE_DIM - head); }
+
+         rtn = start;
+         size = hsize;
+         if ( madvise(rtn, size, MADV_HUGEPAGE) == 0 ) { got |= XYZ_VMEM_F_HUGE; }
+      }
+   }
+#endif
+
+   if ( rtn == MAP_FAILED )
+   {
+      rtn = (u8 *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | populate, -1, 0);
+      if ( rtn == MAP_FAILED ) { return NULL; }
+      got |= want & XYZ_VMEM_F_POPULATE;
+   }
+
+#else
+   (void)dim;
+   (void)want;
+   (void)got;
+   return NULL;
+#endif
+
+#if defined(_WIN32) || defined(__linux__)
+   // Whatever the mapping did not already take care of.
+   got |= xyz_vmem_resident(rtn, size, want & ~got);
+
+   *dim = size;
+   *flags = got;
+   return rtn;
+#endif
+}
+// xyz_vmem_alloc()
+
+
+/**
+ * Make an existing region resident.
+ *
+ * Pre-faulting reads and writes back each page, so the contents are kept,
+ * but it must be done before the region is shared with other threads.
+ *
+ * @param[in] buf    start of the region, page aligned.
+ * @param[in] dim    size of the region in bytes.
+ * @param[in] flags  XYZ_VMEM_F_POPULATE and / or XYZ_VMEM_F_LOCK, any other
+ *                   flags are ignored.
+ *
+ * @return The flags that were granted.
+ */
+u32
+xyz_vmem_resident(void *buf, u64 dim, u32 flags)
+{
+   u32 got = 0;
+
+   if ( buf == NULL || dim == 0 ) { return got; }
+
+#if defined(_WIN32)
+   SYSTEM_INFO si;
+   GetSystemInfo(&si);
+   u64 page = si.dwPageSize;
+#elif defined(__linux__)
+   u64 page = (u64)sysconf(_SC_PAGESIZE);
+#else
+   u64 page = 4096;
+#endif
+
+   if ( (flags & XYZ_VMEM_F_POPULATE) != 0 )
+   {
+      volatile u8 *p = (volatile u8 *)buf;
+      for ( u64 i = 0 ; i < dim ; i += page ) {
+         p[i] = p[i];
+      }
+      got |= XYZ_VMEM_F_POPULATE;
+   }
+
+   if ( (flags & XYZ_VMEM_F_LOCK) != 0 )
+   {
+#if defined(_WIN32)
+      // The lock limit is the minimum working set, which is small by
+      // default, so grow it by the region and try again.
+      if ( VirtualLock(buf, (SIZE_T)dim) == 0 )
+      {
+         SIZE_T wsmin, wsmax;
+         if ( GetProcessWorkingSetSize(GetCurrentProcess(), &wsmin, &wsmax) != 0 ) {
+            SetProcessWorkingSetSize(GetCurrentProcess(),
+                  wsmin + (SIZE_T)dim, wsmax + (SIZE_T)dim);
+         }
+      }
+      if ( VirtualLock(buf, (SIZE_T)dim) != 0 ) { got |= XYZ_VMEM_F_LOCK; }
+#elif defined(__linux__)
+      if ( mlock(buf, (size_t)dim) == 0 ) { got |= XYZ_VMEM_F_LOCK; }
+#endif
+   }
+
+   return got;
+}
+// xyz_vmem_resident()
+
+
+/**
+ * Free a region from xyz_vmem_alloc().
+ *
+ * @param[in] buf  region from xyz_vmem_alloc(), can be NULL.
+ * @param[in] dim  the dim returned by xyz_vmem_alloc().
+ */
+void
+xyz_vmem_free(void *buf, u64 dim)
+{
+   if ( buf == NULL ) { return; }
+
+#if defined(_WIN32)
+   (void)dim;
+   VirtualFree(buf, 0, MEM_RELEASE);
+#elif defined(__linux__)
+   munmap(buf, (size_t)dim);
+#else
+   (void)dim;
+#endif
+}
+// xyz_vmem_free()
+
+
+// ==========================================================================
+//
+// Arena allocator
+//
+// ==========================================================================
+
+
+/**
+ * Initialize an arena and reserve its region.
+ *
+ * @param[in] ar   pointer to the xyz_arena structure.
+ * @param[in] dim  size of the region in bytes.
+ *
+ * @return XYZ_TRUE if the region was reserved, otherwise XYZ_FALSE.
+ */
+u32
+xyz_arena_init(xyz_arena *ar, u64 dim)
+{
+   memset(ar, 0, sizeof(xyz_arena));
+
+   dim = XYZ_ARENA_SIZE(dim);
+   if ( dim == 0 || dim > (u64)SIZE_MAX ) { return XYZ_FALSE; }
+
+   ar->base = (u8 *)xyz_malloc((size_t)dim);
+   if ( ar->base == NULL ) { return XYZ_FALSE; }
+
+   ar->dim = dim;
+   return XYZ_TRUE;
+}
+// xyz_arena_init()
+
+
+/**
+ * Initialize an arena with a region from xyz_vmem_alloc().
+ *
+ * @param[in] ar     pointer to the xyz_arena structure.
+ * @param[in] dim    size of the region in bytes, rounded up to the page size.
+ * @param[in] flags  XYZ_VMEM_F_* options for the region, the granted options
+ *                   are kept in ar->vmem.
+ *
+ * @return XYZ_TRUE if the region was mapped, otherwise XYZ_FALSE (the caller
+ *         can fall back to xyz_arena_init()).
+ */
+u32
+xyz_arena_init_vmem(xyz_arena *ar, u64 dim, u32 flags)
+{
+   memset(ar, 0, sizeof(xyz_arena));
+
+   dim = XYZ_ARENA_SIZE(dim);
+   if ( dim == 0 ) { return XYZ_FALSE; }
+
+   ar->base = (u8 *)xyz_vmem_alloc(&dim, &flags);
+   if ( ar->base == NULL ) { return XYZ_FALSE; }
+
+   ar->dim = dim;
+   ar->vmem = flags;
+   return XYZ_TRUE;
+}
+// xyz_arena_init_vmem()
+
+
+/**
+ * Allocate from an arena.
+ *
+ * @param[in] ar  pointer to the xyz_arena structure.
+ * @param[in] sz  number of bytes.
+ *
+ * @return Pointer to XYZ_ARENA_ALIGN aligned memory, not initialized, or
+ *         NULL if the arena does not have room.
+ */
+void *
+xyz_arena_alloc(xyz_arena *ar, u64 sz)
+{
+   u64 size = XYZ_ARENA_SIZE(sz);
+
+   if ( size < sz || size > ar->dim - ar->used ) {
+      ar->fails++;
+      return NULL;
+   }
+
+   void *p = ar->base + ar->used;
+   ar->used += size;
+   ar->allocs++;
+   if ( ar->used > ar->peak ) { ar->peak = ar->used; }
+
+   return p;
+}
+// xyz_arena_alloc()
+
+
+/**
+ * Allocate from an arena with a larger alignment.
+ *
+ * @param[in] ar     pointer to the xyz_arena structure.
+ * @param[in] sz     number of bytes.
+ * @param[in] align  alignment, a power of two.  The region start is at
+ *                   least page aligned from xyz_arena_init_vmem(), but only
+ *                   malloc aligned from xyz_arena_init(), the padding is
+ *                   worked out from the actual address.
+ *
+ * @return Pointer to the memory, not initialized, or NULL if it does not fit.
+ */
+void *
+xyz_arena_alloc_aligned(xyz_arena *ar, u64 sz, u64 align)
+{
+   if ( align <= XYZ_ARENA_ALIGN ) { return xyz_arena_alloc(ar, sz); }
+
+   if ( (align & (align - 1)) != 0 ) {
+      ar->fails++;
+      return NULL;
+   }
+
+   u64 at = (u64)(size_t)(ar->base + ar->used);
+   u64 pad = (align - (at & (align - 1))) & (align - 1);
+
+   if ( pad > ar->dim - ar->used ) {
+      ar->fails++;
+      return NULL;
+   }
+
+   ar->used += pad;
+   void *p = xyz_arena_alloc(ar, sz);
+   if ( p == NULL ) {
+      ar->used -= pad;
+      return NULL;
+   }
+
+   ar->waste += pad;
+   return p;
+}
+// xyz_arena_alloc_aligned()
+
+
+/**
+ * Allocate zeroed memory for an array from an arena.
+ *
+ * @param[in] ar   pointer to the xyz_arena structure.
+ * @param[in] num  number of elements.
+ * @param[in] sz   size of an element.
+ *
+ * @return Pointer to XYZ_ARENA_ALIGN aligned zeroed memory, or NULL if the
+ *         arena does not have room.
+ */
+void *
+xyz_arena_calloc(xyz_arena *ar, u64 num, u64 sz)
+{
+   if ( sz != 0 && num > (u64)-1 / sz ) {
+      ar->fails++;
+      return NULL;
+   }
+
+   void *p = xyz_arena_alloc(ar, num * sz);
+   if ( p != NULL ) { memset(p, 0, (size_t)(num * sz)); }
+
+   return p;
+}
+// xyz_arena_calloc()
+
+
+/**
+ * Get the current position of an arena, for xyz_arena_rewind().
+ *
+ * @param[in] ar  pointer to the xyz_arena structure.
+ *
+ * @return The mark.
+ */
+u64
+xyz_arena_mark(xyz_arena *ar)
+{
+   return ar->used;
+}
+// xyz_arena_mark()
+
+
+/**
+ * Release everything allocated since a mark.
+ *
+ * @param[in] ar    pointer to the xyz_arena structure.
+ * @param[in] mark  value from xyz_arena_mark().
+ */
+void
+xyz_arena_rewind(xyz_arena *ar, u64 mark)
+{
+   if ( mark < ar->used ) { ar->used = mark; }
+}
+// xyz_arena_rewind()
+
+
+/**
+ * Release every allocation, the region is kept for reuse.
+ *
+ * @param[in] ar  pointer to the xyz_arena structure.
+ */
+void
+xyz_arena_reset(xyz_arena *ar)
+{
+   ar->used = 0;
+   ar->allocs = 0;
+   ar->waste = 0;
+}
+// xyz_arena_reset()
+
+
+/**
+ * Release every allocation and the region.
+ *
+ * @param[in] ar  pointer to the xyz_arena structure.
+ */
+void
+xyz_arena_free(xyz_arena *ar)
+{
+   if ( ar->vmem != 0 ) {
+      xyz_vmem_free(ar->base, ar->dim);
+   } else if ( ar->base != NULL ) {
+      xyz_free(ar->base);
+   }
+
+   memset(ar, 0, sizeof(xyz_arena));
+}
+// xyz_arena_free()
+
+
+// ==========================================================================
+//
+// Fixed-size block pool allocator
+//
+// ==========================================================================
+
+// The depot is a plain free list under a spin lock.  The lock is only taken
+// once per magazine batch, so it is held for very short times and rarely
+// contended, and a lock-free stack would need ABA protection for no gain.
+
+
+/**
+ * Take the depot lock.
+ *
+ * @param[in] pool  pointer to the xyz_pool structure.
+ */
+static void
+xyz_pool_lock(xyz_pool *pool)
+{
+   if ( xyz_atomic_cas_u32(&pool->lock, 0, 1) == XYZ_TRUE ) { return; }
+
+   while ( xyz_atomic_cas_u32(&pool->lock, 0, 1) == XYZ_FALSE ) {
+      while ( xyz_atomic_ld_rlx_u32(&pool->lock) != 0 ) { xyz_cpu_relax(); }
+   }
+
+   pool->stats.contended++;
+}
+// xyz_pool_lock()
+
+
+/**
+ * Release the depot lock.
+ *
+ * @param[in] pool  pointer to the xyz_pool structure.
+ */
+static void
+xyz_pool_unlock(xyz_pool *pool)
+{
+   xyz_atomic_st_rel_u32(&pool->lock, 0);
+}
+// xyz_pool_unlock()
+
+
+/**
+ * Initialize a pool.
+ *
+ * @param[in] pool    pointer to the xyz_pool structure.
+ * @param[in] mem     caller-owned region, XYZ_POOL_ALIGN aligned.  Use
+ *                    XYZ_POOL_SIZE() to size it.
+ * @param[in] memdim  size of the region in bytes.
+ * @param[in] bsize   block size in bytes.
+ *
+ * @return XYZ_TRUE if initialization succeeded, otherwise XYZ_FALSE.
+ */
+u32
+xyz_pool_init(xyz_pool *pool, void *mem, u64 memdim, u64 bsize)
+{
+   if ( ((size_t)mem & (XYZ_POOL_ALIGN - 1)) != 0 ) {
+      memset(pool, 0, sizeof(xyz_pool));
+      return XYZ_FALSE;
+   }
+
+   return xyz_pool_init_aligned(pool, mem, memdim, bsize, XYZ_POOL_ALIGN);
+}
+// xyz_pool_init()
+
+
+/**
+ * Initialize a pool with blocks aligned to a larger power of two.
+ *
+ * @param[in] pool    pointer to the xyz_pool structure.
+ * @param[in] mem     caller-owned region, any alignment.  Use
+ *                    XYZ_POOL_SIZE_ALIGNED() to size it.
+ * @param[in] memdim  size of the region in bytes.
+ * @param[in] bsize   block size in bytes.
+ * @param[in] align   block alignment, a power of two, at least
+ *                    XYZ_POOL_ALIGN.
+ *
+ * @return XYZ_TRUE if initialization succeeded, otherwise XYZ_FALSE.
+ */
+u32
+xyz_pool_init_aligned(xyz_pool *pool, void *mem, u64 memdim, u64 bsize, u64 align)
+{
+   memset(pool, 0, sizeof(xyz_pool));
+
+   if ( mem == NULL || bsize == 0 || align < XYZ_POOL_ALIGN || (align & (align - 1)) != 0 ) {
+      return XYZ_FALSE;
+   }
+
+   u64 pad = (align - ((u64)(size_t)mem & (align - 1))) & (align - 1);
+   if ( pad >= memdim ) { return XYZ_FALSE; }
+
+   pool->bsize = XYZ_POOL_BLOCK(bsize, align);
+   pool->count = (memdim - pad) / pool->bsize;
+   pool->base = (u8 *)mem + pad;
+   pool->waste = pad + (pool->count * (pool->bsize - bsize));
+
+   return (pool->count > 0 ? XYZ_TRUE : XYZ_FALSE);
+}
+// xyz_pool_init_aligned()
+
+
+/**
+ * Add a magazine's counts to the pool statistics.  Depot lock held.
+ *
+ * @param[in] pool  pointer to the xyz_pool structure.
+ * @param[in] mag   pointer to the magazine.
+ */
+static void
+xyz_pool_tally(xyz_pool *pool, xyz_pool_mag *mag)
+{
+   pool->stats.allocs += mag->allocs;
+   pool->stats.frees += mag->frees;
+   mag->allocs = 0;
+   mag->frees = 0;
+}
+// xyz_pool_tally()
+
+
+/**
+ * Move up to n free blocks from the depot to a magazine.
+ *
+ * Blocks that have never been used are carved from the region only when the
+ * depot free list is empty, so the region is not touched up front.
+ *
+ * @param[in] pool  pointer to the xyz_pool structure.
+ * @param[in] mag   pointer to the magazine.
+ * @param[in] n     number of blocks wanted.
+ * @param[in] take  blocks the caller takes straight out of the magazine,
+ *                  counted as allocations only if the refill got them.
+ */
+static void
+xyz_pool_refill(xyz_pool *pool, xyz_pool_mag *mag, u32 n, u32 take)
+{
+   u32 len = mag->len;
+
+   xyz_pool_lock(pool);
+
+   while ( n > 0 && pool->depot != NULL ) {
+      void *blk = pool->depot;
+      pool->depot = *(void **)blk;
+      pool->depot_len--;
+      mag->blk[mag->len++] = blk;
+      n--;
+   }
+
+   while ( n > 0 && pool->carved < pool->count ) {
+      mag->blk[mag->len++] = pool->base + (pool->carved * pool->bsize);
+      pool->carved++;
+      n--;
+   }
+
+   pool->stats.refills++;
+   pool->stats.out += (mag->len - len);
+   if ( pool->stats.out > pool->stats.peak ) { pool->stats.peak = pool->stats.out; }
+   if ( mag->len == 0 ) { pool->stats.fails++; }
+   if ( mag->len >= take ) { mag->allocs += take; }
+   xyz_pool_tally(pool, mag);
+
+   xyz_pool_unlock(pool);
+}
+// xyz_pool_refill()
+
+
+/**
+ * Move the n newest blocks in a magazine to the depot.
+ *
+ * @param[in] pool  pointer to the xyz_pool structure.
+ * @param[in] mag   pointer to the magazine.
+ * @param[in] n     number of blocks to move, no more than mag->len.
+ */
+static void
+xyz_pool_flush(xyz_pool *pool, xyz_pool_mag *mag, u32 n)
+{
+   void *head = NULL;
+   void *tail = NULL;
+
+   // Link the batch outside of the lock.
+   if ( n > 0 )
+   {
+      head = mag->blk[mag->len - 1];
+      tail = mag->blk[mag->len - n];
+      for ( u32 i = mag->len - 1 ; i > mag->len - n ; i-- ) {
+         *(void **)mag->blk[i] = mag->blk[i - 1];
+      }
+      mag->len -= n;
+   }
+
+   xyz_pool_lock(pool);
+
+   if ( n > 0 ) {
+      *(void **)tail = pool->depot;
+      pool->depot = head;
+      pool->depot_len += n;
+   }
+
+   pool->stats.flushes++;
+   pool->stats.out -= n;
+   xyz_pool_tally(pool, mag);
+
+   xyz_pool_unlock(pool);
+}
+// xyz_pool_flush()
+
+
+/**
+ * Allocate a block.
+ *
+ * @param[in] pool  pointer to the xyz_pool structure.
+ * @param[in] mag   the calling thread's magazine, or NULL.
+ *
+ * @return Pointer to a block of at least bsize bytes, not initialized, or
+ *         NULL if every block is in use.
+ */
+void *
+xyz_pool_alloc(xyz_pool *pool, xyz_pool_mag *mag)
+{
+   if ( mag == NULL )
+   {
+      xyz_pool_mag one;
+      one.len = 0;
+      one.allocs = 0;
+      one.frees = 0;
+      xyz_pool_refill(pool, &one, 1, 1);
+      return (one.len > 0 ? one.blk[0] : NULL);
+   }
+
+   if ( mag->len == 0 ) {
+      xyz_pool_refill(pool, mag, XYZ_POOL_MAG / 2, 0);
+      if ( mag->len == 0 ) { return NULL; }
+   }
+
+   mag->allocs++;
+   return mag->blk[--mag->len];
+}
+// xyz_pool_alloc()
+
+
+/**
+ * Free a block.
+ *
+ * The block can be freed by any thread, not just the one that allocated it.
+ *
+ * @param[in] pool  pointer to the xyz_pool structure.
+ * @param[in] mag   the calling thread's magazine, or NULL.
+ * @param[in] blk   block from xyz_pool_alloc(), can be NULL.
+ */
+void
+xyz_pool_free(xyz_pool *pool, xyz_pool_mag *mag, void *blk)
+{
+   if ( blk == NULL ) { return; }
+
+   if ( mag == NULL )
+   {
+      xyz_pool_mag one;
+      one.len = 1;
+      one.blk[0] = blk;
+      one.allocs = 0;
+      one.frees = 1;
+      xyz_pool_flush(pool, &one, 1);
+      return;
+   }
+
+   if ( mag->len == XYZ_POOL_MAG ) {
+      xyz_pool_flush(pool, mag, XYZ_POOL_MAG / 2);
+   }
+
+   mag->frees++;
+   mag->blk[mag->len++] = blk;
+}
+// xyz_pool_free()
+
+
+/**
+ * Return every block in a magazine to the depot.
+ *
+ * Call before a thread exits, otherwise the blocks cached by the thread are
+ * lost to the pool.  Also brings the pool statistics up to date for the
+ * thread.
+ *
+ * @param[in] pool  pointer to the xyz_pool structure.
+ * @param[in] mag   pointer to the magazine.
+ */
+void
+xyz_pool_mag_flush(xyz_pool *pool, xyz_pool_mag *mag)
+{
+   xyz_pool_flush(pool, mag, mag->len);
+}
+// xyz_pool_mag_flush()
+
+
+// ==========================================================================
+//
+// Per-thread heap
+//
+// ==========================================================================
+
+// Every block is preceded by a 16 byte header, which keeps the payload 16
+// byte aligned.  A free block's first 8 bytes link it into a free list (a
+// payload pointer) or the deferred return list (a payload address in a u64,
+// to use the u64 atomics).  Blocks from xyz_malloc() (large or spilled)
+// are freed directly by any thread, their owner is only the heap that
+// counted the allocation, to count the free.
+
+/// Per-thread heap block header.
+typedef struct unused_tag_xyz_theap_hdr {
+   u64   owner;   ///< Owning heap address, 0 if allocated without a heap.
+   u32   cls;     ///< Size class, XYZ_THEAP_CLASSES for a block from xyz_malloc().
+   u32   magic;   ///< XYZ_THEAP_MAGIC while allocated.
+} xyz_theap_hdr;
+
+#define XYZ_THEAP_MAGIC 0x5448504D   ///< "THPM"
+
+/// Block size of a size class.
+#define XYZ_THEAP_CLASS_SIZE(cls) ((u64)16 << (cls))
+
+/// The heap of the calling thread.
+static XYZ_THREAD_LOCAL xyz_theap *xyz_theap_self;
+
+
+/**
+ * Initialize a per-thread heap, called by the owning thread.
+ *
+ * The heap becomes the thread's current heap.  If the arena cannot be
+ * allocated the heap still works, every allocation goes to xyz_malloc().
+ *
+ * @param[in] th    pointer to the xyz_theap structure.
+ * @param[in] name  name for diagnostics, not copied.
+ * @param[in] dim   size of the thread's arena in bytes.
+ *
+ * @return XYZ_TRUE if the arena was allocated, otherwise XYZ_FALSE.
+ */
+u32
+xyz_theap_init(xyz_theap *th, const c8 *name, u64 dim)
+{
+   memset(th, 0, sizeof(xyz_theap));
+   th->name = name;
+   xyz_theap_self = th;
+
+   return xyz_arena_init(&th->arena, dim);
+}
+// xyz_theap_init()
+
+
+/**
+ * Release a per-thread heap, called by the owning thread before it ends.
+ *
+ * Blocks still allocated are reported to stderr, they are released with the
+ * arena.  The statistics are kept.
+ *
+ * @param[in] th  pointer to the xyz_theap structure.
+ */
+void
+xyz_theap_fini(xyz_theap *th)
+{
+   xyz_theap_collect(th);
+
+   if ( th->stats.live_bytes != 0 ) {
+      fprintf(stderr, "xyz_theap_fini: %s heap still has %llu bytes allocated\n",
+            (th->name != NULL ? th->name : "thread"),
+            (unsigned long long)th->stats.live_bytes);
+   }
+
+   xyz_arena_free(&th->arena);
+   memset(th->free, 0, sizeof(th->free));
+
+   if ( xyz_theap_self == th ) { xyz_theap_self = NULL; }
+}
+// xyz_theap_fini()
+
+
+/**
+ * Get the calling thread's heap.
+ *
+ * @return Pointer to the heap, or NULL if the thread does not have one.
+ */
+xyz_theap *
+xyz_theap_current(void)
+{
+   return xyz_theap_self;
+}
+// xyz_theap_current()
+
+
+/**
+ * Allocate from a per-thread heap, called by the owning thread.
+ *
+ * @param[in] th  the calling thread's heap, or NULL to use xyz_malloc().
+ * @param[in] sz  number of bytes.
+ *
+ * @return Pointer to 16 byte aligned memory, not initialized, or NULL on
+ *         failure.  Release with xyz_theap_free() from any thread.
+ */
+void *
+xyz_theap_alloc(xyz_theap *th, size_t sz)
+{
+   xyz_theap_hdr *hdr = NULL;
+   u32 cls = 0;
+
+   if ( th != NULL && sz <= XYZ_THEAP_MAX )
+   {
+      while ( XYZ_THEAP_CLASS_SIZE(cls) < sz ) { cls++; }
+
+      if ( th->free[cls] == NULL ) { xyz_theap_collect(th); }
+
+      u8 *p = (u8 *)th->free[cls];
+      if ( p != NULL ) {
+         th->free[cls] = *(void **)p;
+         hdr = (xyz_theap_hdr *)p - 1;
+      } else {
+         hdr = (xyz_theap_hdr *)xyz_arena_alloc(&th->arena,
+               sizeof(xyz_theap_hdr) + XYZ_THEAP_CLASS_SIZE(cls));
+         if ( hdr == NULL ) { th->stats.spills++; }
+      }
+   }
+   else if ( th != NULL ) {
+      th->stats.large++;
+   }
+
+   if ( hdr == NULL )
+   {
+      if ( sz > SIZE_MAX - sizeof(xyz_theap_hdr) ) { return NULL; }
+
+      hdr = (xyz_theap_hdr *)xyz_malloc(sizeof(xyz_theap_hdr) + sz);
+      if ( hdr == NULL ) { return NULL; }
+
+      hdr->owner = (u64)(size_t)th;
+      hdr->cls = XYZ_THEAP_CLASSES;
+   }
+   else
+   {
+      hdr->owner = (u64)(size_t)th;
+      hdr->cls = cls;
+
+      th->stats.live_bytes += XYZ_THEAP_CLASS_SIZE(cls);
+      if ( th->stats.live_bytes > th->stats.peak_bytes ) {
+         th->stats.peak_bytes = th->stats.live_bytes;
+      }
+   }
+
+   hdr->magic = XYZ_THEAP_MAGIC;
+   if ( th != NULL ) { th->stats.allocs++; }
+
+   return hdr + 1;
+}
+// xyz_theap_alloc()
+
+
+/**
+ * Free a block from xyz_theap_alloc(), from any thread.
+ *
+ * The owning heap must not have been released with xyz_theap_fini(), and
+ * for a large or spilled block its xyz_theap structure must still exist.
+ *
+ * @param[in] ptr  memory from xyz_theap_alloc(), can be NULL.
+ */
+void
+xyz_theap_free(void *ptr)
+{
+   if ( ptr == NULL ) { return; }
+
+   xyz_theap_hdr *hdr = (xyz_theap_hdr *)ptr - 1;
+
+   // Catch double frees and pointers that were not from xyz_theap_alloc().
+   if ( hdr->magic != XYZ_THEAP_MAGIC ) {
+      fprintf(stderr, "xyz_theap_free: bad or double free of %p\n", ptr);
+      return;
+   }
+
+   hdr->magic = 0;
+
+   xyz_theap *th = (xyz_theap *)(size_t)hdr->owner;
+
+   if ( hdr->cls == XYZ_THEAP_CLASSES ) {
+      xyz_free(hdr);
+      if ( th != NULL ) { xyz_atomic_add_u64(&th->direct_frees, 1); }
+      return;
+   }
+
+   if ( th == xyz_theap_self )
+   {
+      *(void **)ptr = th->free[hdr->cls];
+      th->free[hdr->cls] = ptr;
+      th->stats.frees++;
+      th->stats.live_bytes -= XYZ_THEAP_CLASS_SIZE(hdr->cls);
+      return;
+   }
+
+   // Another thread's block, defer it to the owner.
+   u64 head;
+   do {
+      head = xyz_atomic_ld_rlx_u64(&th->remote);
+      *(u64 *)ptr = head;
+   } while ( xyz_atomic_cas_u64(&th->remote, head, (u64)(size_t)ptr) == XYZ_FALSE );
+
+   xyz_atomic_add_u64(&th->remote_frees, 1);
+}
+// xyz_theap_free()
+
+
+/**
+ * Take back the blocks other threads have freed, called by the owning
+ * thread.  Done automatically when a size class runs out.
+ *
+ * @param[in] th  pointer to the xyz_theap structure.
+ *
+ * @return The number of blocks taken back.
+ */
+u64
+xyz_theap_collect(xyz_theap *th)
+{
+   u64 head;
+   do {
+      head = xyz_atomic_ld_acq_u64(&th->remote);
+   } while ( head != 0 && xyz_atomic_cas_u64(&th->remote, head, 0) == XYZ_FALSE );
+
+   u64 n = 0;
+   while ( head != 0 )
+   {
+      u8 *p = (u8 *)(size_t)head;
+      head = *(u64 *)p;
+
+      xyz_theap_hdr *hdr = (xyz_theap_hdr *)p - 1;
+      *(void **)p = th->free[hdr->cls];
+      th->free[hdr->cls] = p;
+      th->stats.live_bytes -= XYZ_THEAP_CLASS_SIZE(hdr->cls);
+      n++;
+   }
+
+   th->stats.collected += n;
+   return n;
+}
+// xyz_theap_collect()
+
+
+// ==========================================================================
+//
+// Event count, blocking wait and notify (EVC)
+//
+// ==========================================================================
+
+// The lost-wakeup race is closed with the waiters count and two full fences:
+//
+//   waiter:    key = seq; waiters++; FENCE; check condition; park if seq == key
+//   notifier:  publish data;         FENCE; if waiters > 0 { seq++; wake }
+//
+// Either the waiter's check sees the published data, or the notifier sees
+// the waiter and bumps seq, in which case the park returns right away or is
+// woken.  A notifier that sees no waiters skips the system call entirely.
+
+#if !defined(_WIN32) && !defined(__linux__)
+
+// No address wait on this platform, so park on a condition variable picked
+// by hashing the address.  Unrelated words can share a bucket, which only
+// costs a spurious wakeup.
+
+/// Number of park buckets, a power of two.
+#define XYZ_PARK_DIM 64
+
+typedef struct unused_tag_xyz_park_bucket
+{
+   pthread_mutex_t mutex;
+   pthread_cond_t cond;
+} xyz_park_bucket;
+
+static xyz_park_bucket xyz_park_buckets[XYZ_PARK_DIM];
+static pthread_once_t xyz_park_once = PTHREAD_ONCE_INIT;
+
+
+/**
+ * Initialize the park buckets, once.
+ */
+static void
+xyz_park_init(void)
+{
+   for ( u32 i = 0 ; i < XYZ_PARK_DIM ; i++ ) {
+      pthread_mutex_init(&xyz_park_buckets[i].mutex, NULL);
+      pthread_cond_init(&xyz_park_buckets[i].cond, NULL);
+   }
+}
+// xyz_park_init()
+
+
+/**
+ * Get the park bucket for a word.
+ *
+ * @param[in] addr  the word.
+ *
+ * @return Pointer to the bucket.
+ */
+static xyz_park_bucket *
+xyz_park_bucket_get(u32 *addr)
+{
+   pthread_once(&xyz_park_once, xyz_park_init);
+   u32 hash = (u32)(((size_t)addr >> 2) * 2654435761u);
+   return &xyz_park_buckets[(hash >> 16) & (XYZ_PARK_DIM - 1)];
+}
+// xyz_park_bucket_get()
+
+#endif
+
+
+/**
+ * Get a monotonic time stamp.
+ *
+ * @return Time in nanoseconds from an arbitrary starting point.
+ */
+u64
+xyz_time_ns(void)
+{
+#if defined(_WIN32)
+   static LARGE_INTEGER freq;
+   LARGE_INTEGER now;
+   if ( freq.QuadPart == 0 ) { QueryPerformanceFrequency(&freq); }
+   QueryPerformanceCounter(&now);
+   return (u64)((now.QuadPart / freq.QuadPart) * 1000000000) +
+          (u64)(((now.QuadPart % freq.QuadPart) * 1000000000) / freq.QuadPart);
+#else
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ((u64)ts.tv_sec * 1000000000) + (u64)ts.tv_nsec;
+#endif
+}
+// xyz_time_ns()
+
+
+/**
+ * Park the calling thread while a word equals a key.
+ *
+ * May return early (spuriously), the caller must re-check.
+ *
+ * @param[in] addr        the word to park on.
+ * @param[in] key         park only if *addr is still equal to key.
+ * @param[in] timeout_ms  maximum time to park, or XYZ_WAIT_FOREVER.
+ */
+static void
+xyz_os_park(u32 *addr, u32 key, u32 timeout_ms)
+{
+#if defined(_WIN32)
+   WaitOnAddress((volatile VOID *)addr, &key, sizeof(key),
+         timeout_ms == XYZ_WAIT_FOREVER ? INFINITE : timeout_ms);
+#elif defined(__linux__)
+   struct timespec ts;
+   struct timespec *tsp = NULL;
+   if ( timeout_ms != XYZ_WAIT_FOREVER ) {
+      ts.tv_sec = timeout_ms / 1000;
+      ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000;
+      tsp = &ts;
+   }
+   syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, key, tsp, NULL, 0);
+#else
+   // The notifier changes the word before taking the bucket lock to wake,
+   // so checking it under the lock cannot miss a wakeup.
+   xyz_park_bucket *b = xyz_park_bucket_get(addr);
+   pthread_mutex_lock(&b->mutex);
+   if ( xyz_atomic_ld_acq_u32(addr) == key )
+   {
+      if ( timeout_ms == XYZ_WAIT_FOREVER ) {
+         pthread_cond_wait(&b->cond, &b->mutex);
+      } else {
+         // pthread_cond_timedwait takes an absolute CLOCK_REALTIME time.
+         struct timeval now;
+         struct timespec ts;
+         gettimeofday(&now, NULL);
+         u64 ns = (u64)now.tv_usec * 1000 + (u64)(timeout_ms % 1000) * 1000000;
+         ts.tv_sec = now.tv_sec + (time_t)(timeout_ms / 1000) + (time_t)(ns / 1000000000);
+         ts.tv_nsec = (long)(ns % 1000000000);
+         pthread_cond_timedwait(&b->cond, &b->mutex, &ts);
+      }
+   }
+   pthread_mutex_unlock(&b->mutex);
+#endif
+}
+// xyz_os_park()
+
+
+/**
+ * Wake all threads parked on a word.
+ *
+ * @param[in] addr  the word threads are parked on.
+ */
+static void
+xyz_os_wake(u32 *addr)
+{
+#if defined(_WIN32)
+   WakeByAddressAll((PVOID)addr);
+#elif defined(__linux__)
+   syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 0x7FFFFFFF, NULL, NULL, 0);
+#else
+   xyz_park_bucket *b = xyz_park_bucket_get(addr);
+   pthread_mutex_lock(&b->mutex);
+   pthread_cond_broadcast(&b->cond);
+   pthread_mutex_unlock(&b->mutex);
+#endif
+}
+// xyz_os_wake()
+
+
+/**
+ * Initialize an EVC structure for first use.
+ *
+ * @param[in] ev    pointer to the xyz_evc structure.
+ * @param[in] spin  number of spins before a waiter parks, 0 to always park
+ *                  right away, or XYZ_EVC_SPIN for the default.
+ */
+void
+xyz_evc_init(xyz_evc *ev, u32 spin)
+{
+   u8 *p = (u8 *)ev;
+   for ( size_t i = 0 ; i < sizeof(xyz_evc) ; i++ ) { p[i] = 0; }
+   ev->spin = spin;
+   xyz_atomic_fence();
+}
+// xyz_evc_init()
+
+
+/**
+ * Wake any waiters.
+ *
+ * Call after making the data a waiter is waiting for available, i.e. after
+ * xyz_rbam_write().  Only makes a system call if a waiter is parked or about
+ * to park.
+ *
+ * @param[in] ev  pointer to the xyz_evc structure.
+ */
+void
+xyz_evc_notify(xyz_evc *ev)
+{
+   xyz_atomic_fence();
+
+   if ( xyz_atomic_ld_rlx_u32(&ev->waiters) == 0 ) {
+      xyz_atomic_add_u64(&ev->stats.wakes_avoided, 1);
+      return;
+   }
+
+   xyz_atomic_st_rlx_u64(&ev->wake_ns, xyz_time_ns());
+   xyz_atomic_add_u32(&ev->seq, 1);
+   xyz_os_wake(&ev->seq);
+   xyz_atomic_add_u64(&ev->stats.wakes, 1);
+}
+// xyz_evc_notify()
+
+
+/**
+ * Record the notify-to-running latency of a parked waiter.
+ *
+ * @param[in] ev  pointer to the xyz_evc structure.
+ */
+static void
+xyz_evc_latency(xyz_evc *ev)
+{
+   u64 woke = xyz_atomic_ld_rlx_u64(&ev->wake_ns);
+   u64 now = xyz_time_ns();
+   if ( woke == 0 || now < woke ) { return; }
+
+   u64 lat = now - woke;
+   xyz_atomic_add_u64(&ev->stats.wake_ns_total, lat);
+
+   u64 max = xyz_atomic_ld_rlx_u64(&ev->stats.wake_ns_max);
+   while ( lat > max ) {
+      if ( xyz_atomic_cas_u64(&ev->stats.wake_ns_max, max, lat) == XYZ_TRUE ) { break; }
+      max = xyz_atomic_ld_rlx_u64(&ev->stats.wake_ns_max);
+   }
+}
+// xyz_evc_latency()
+
+
+/**
+ * Wait until a condition is met.
+ *
+ * Spins for a while checking the condition, then parks until notified.
+ *
+ * @param[in] ev          pointer to the xyz_evc structure.
+ * @param[in] ready       condition callback, returns XYZ_TRUE when met.
+ * @param[in] arg         argument for the callback.
+ * @param[in] timeout_ms  maximum time to wait, or XYZ_WAIT_FOREVER.
+ *
+ * @return XYZ_TRUE if the condition was met, XYZ_FALSE on timeout.
+ */
+u32
+xyz_evc_await(xyz_evc *ev, xyz_ready_fn *ready, void *arg, u32 timeout_ms)
+{
+   if ( ready(arg) == XYZ_TRUE ) { return XYZ_TRUE; }
+
+   xyz_atomic_add_u64(&ev->stats.waits, 1);
+
+   // Spin first, most hand-offs between busy threads complete here.
+   for ( u32 i = 0 ; i < ev->spin ; i++ )
+   {
+      xyz_cpu_relax();
+      if ( ready(arg) == XYZ_TRUE ) {
+         xyz_atomic_add_u64(&ev->stats.spin_hits, 1);
+         return XYZ_TRUE;
+      }
+   }
+
+   u64 deadline = 0;
+   if ( timeout_ms != XYZ_WAIT_FOREVER ) {
+      deadline = xyz_time_ns() + ((u64)timeout_ms * 1000000);
+   }
+
+   u32 rtn = XYZ_FALSE;
+   u32 parked = XYZ_FALSE;
+
+   while ( 1 )
+   {
+      u32 key = xyz_atomic_ld_acq_u32(&ev->seq);
+      xyz_atomic_add_u32(&ev->waiters, 1);
+      xyz_atomic_fence();
+
+      if ( ready(arg) == XYZ_TRUE ) {
+         xyz_atomic_add_u32(&ev->waiters, (u32)-1);
+         rtn = XYZ_TRUE;
+         break;
+      }
+
+      u32 remain_ms = XYZ_WAIT_FOREVER;
+      if ( deadline != 0 )
+      {
+         u64 now = xyz_time_ns();
+         if ( now >= deadline ) {
+            xyz_atomic_add_u32(&ev->waiters, (u32)-1);
+            xyz_atomic_add_u64(&ev->stats.timeouts, 1);
+            break;
+         }
+         remain_ms = (u32)(((deadline - now) + 999999) / 1000000);
+      }
+
+      xyz_atomic_add_u64(&ev->stats.parks, 1);
+      xyz_os_park(&ev->seq, key, remain_ms);
+      xyz_atomic_add_u32(&ev->waiters, (u32)-1);
+      parked = XYZ_TRUE;
+   }
+
+   if ( rtn == XYZ_TRUE && parked == XYZ_TRUE ) {
+      xyz_evc_latency(ev);
+   }
+
+   return rtn;
+}
+// xyz_evc_await()
+
+
+/**
+ * Condition callback, the RBAM has data to read.
+ *
+ * @param[in] arg  pointer to the xyz_rbam structure.
+ *
+ * @return XYZ_TRUE if the RBAM is not empty.
+ */
+static u32
+xyz_rbam_readable(void *arg)
+{
+   return (xyz_rbam_is_empty((xyz_rbam *)arg) == XYZ_TRUE ? XYZ_FALSE : XYZ_TRUE);
+}
+// xyz_rbam_readable()
+
+
+/**
+ * Condition callback, the RBAM has room to write.
+ *
+ * @param[in] arg  pointer to the xyz_rbam structure.
+ *
+ * @return XYZ_TRUE if the RBAM is not full.
+ */
+static u32
+xyz_rbam_writable(void *arg)
+{
+   return (xyz_rbam_is_full((xyz_rbam *)arg) == XYZ_TRUE ? XYZ_FALSE : XYZ_TRUE);
+}
+// xyz_rbam_writable()
+
+
+/**
+ * Reader: wait until the RBAM is not empty.
+ *
+ * The writer must call xyz_evc_notify() on the same EVC after each
+ * xyz_rbam_write() (or xyz_rbam_commit()).
+ *
+ * @param[in] rbam        pointer to the xyz_rbam structure for the RBAM.
+ * @param[in] ev          EVC notified by the writer.
+ * @param[in] timeout_ms  maximum time to wait, or XYZ_WAIT_FOREVER.
+ *
+ * @return XYZ_TRUE if there is data to read, XYZ_FALSE on timeout.
+ */
+u32
+xyz_rbam_wait_readable(xyz_rbam *rbam, xyz_evc *ev, u32 timeout_ms)
+{
+   return xyz_evc_await(ev, xyz_rbam_readable, rbam, timeout_ms);
+}
+// xyz_rbam_wait_readable()
+
+
+/**
+ * Writer: wait until the RBAM is not full.
+ *
+ * The reader must call xyz_evc_notify() on the same EVC after each
+ * xyz_rbam_read() (or xyz_rbam_consume()).
+ *
+ * @param[in] rbam        pointer to the xyz_rbam structure for the RBAM.
+ * @param[in] ev          EVC notified by the reader.
+ * @param[in] timeout_ms  maximum time to wait, or XYZ_WAIT_FOREVER.
+ *
+ * @return XYZ_TRUE if there is room to write, XYZ_FALSE on timeout.
+ */
+u32
+xyz_rbam_wait_writable(xyz_rbam *rbam, xyz_evc *ev, u32 timeout_ms)
+{
+   return xyz_evc_await(ev, xyz_rbam_writable, rbam, timeout_ms);
+}
+// xyz_rbam_wait_writable()
+
+
+
+// ==========================================================================
+//
+// Unsigned 128-bit integer helpers
+//
+// ==========================================================================
+
+
+/**
+ * Divide a u128 by a u64 in place.
+ *
+ * @param[in,out] n  pointer to the dividend, replaced by the quotient.
+ * @param[in]     d  divisor, not zero.
+ *
+ * @return The remainder.
+ */
+u64
+xyz_u128_divmod_u64(xyz_u128 *n, u64 d)
+{
+   // Two steps of 128 / 64, the high half first so the second step's
+   // high word (the first remainder) is always less than the divisor.
+   u64 qhi = n->hi / d;
+   u64 rem = n->hi % d;
+   u64 qlo;
+
+#if defined(__SIZEOF_INT128__)
+   unsigned __int128 x = ((unsigned __int128)rem << 64) | n->lo;
+   qlo = (u64)(x / d);
+   rem = (u64)(x % d);
+#elif defined(_MSC_VER) && defined(_M_X64) && _MSC_VER >= 1920
+   qlo = _udiv128(rem, n->lo, d, &rem);
+#else
+   // Restoring shift-subtract division, one quotient bit at a time.
+   u64 lo = n->lo;
+   qlo = 0;
+   for ( u32 i = 0 ; i < 64 ; i++ )
+   {
+      u64 top = rem >> 63;
+      rem = (rem << 1) | (lo >> 63);
+      lo <<= 1;
+      qlo <<= 1;
+      if ( top != 0 || rem >= d ) {
+         rem -= d;
+         qlo |= 1;
+      }
+   }
+#endif
+
+   n->hi = qhi;
+   n->lo = qlo;
+   return rem;
+}
+// xyz_u128_divmod_u64()
+
+
+/**
+ * Bit length of a u128.
+ *
+ * @param[in] a  value.
+ *
+ * @return The number of significant bits, 0 for 0.
+ */
+u32
+xyz_u128_bits(xyz_u128 a)
+{
+   u64 v = ( a.hi != 0 ? a.hi : a.lo );
+   u32 base = ( a.hi != 0 ? 64 : 0 );
+
+   if ( v == 0 ) {
+      return 0;
+   }
+
+#if defined(__GNUC__) || defined(__clang__)
+   return base + 64 - (u32)__builtin_clzll(v);
+#elif defined(_MSC_VER) && defined(_M_X64)
+   unsigned long idx;
+   _BitScanReverse64(&idx, v);
+   return base + (u32)idx + 1;
+#else
+   u32 bits = 0;
+   while ( v != 0 ) { bits++; v >>= 1; }
+   return base + bits;
+#endif
+}
+// xyz_u128_bits()
+
+
+
+// ==========================================================================
+//
+// Decimal floating point (IEEE 754 decimal64 and decimal128, BID encoding)
+//
+// ==========================================================================
+
+// Every operation unpacks to a sign, a u128 coefficient and an exponent,
+// works on the integers, and rounds once at the end.  Add aligns the
+// exponents by scaling the larger-exponent coefficient up while it fits in
+// 38 digits; anything left over is shifted off the other operand with a
+// sticky digit, which still rounds correctly because at least two digits
+// beyond the precision are kept.  A decimal128 product is up to 68 digits,
+// so the rounding works on four 64-bit limbs.
+
+#define XYZ_DEC_FINITE  0
+#define XYZ_DEC_INF     1
+#define XYZ_DEC_NAN     2
+
+/// Unpacked decimal value.
+typedef struct unused_tag_xyz_dec {
+   xyz_u128 coef;    ///< Coefficient, not normalized.
+   s32      exp;     ///< Power of ten exponent of the coefficient.
+   u32      sign;    ///< 1 for negative.
+   u32      cls;     ///< XYZ_DEC_FINITE, XYZ_DEC_INF or XYZ_DEC_NAN.
+} xyz_dec;
+
+/// Format parameters.
+typedef struct unused_tag_xyz_dec_fmt {
+   u32      digits;  ///< Precision in digits.
+   s32      emin;    ///< Smallest exponent.
+   s32      emax;    ///< Largest exponent.
+} xyz_dec_fmt;
+
+static const xyz_dec_fmt xyz_dec_fmt64  = { XYZ_D64_DIGITS,  XYZ_D64_EMIN,  XYZ_D64_EMAX };
+static const xyz_dec_fmt xyz_dec_fmt128 = { XYZ_D128_DIGITS, XYZ_D128_EMIN, XYZ_D128_EMAX };
+
+static const u64 xyz_pow10_u64[20] = {
+   1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+   100000000ull, 1000000000ull, 10000000000ull, 100000000000ull,
+   1000000000000ull, 10000000000000ull, 100000000000000ull,
+   1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+   1000000000000000000ull, 10000000000000000000ull };
+
+#define XYZ_D64_SIGN      0x8000000000000000ull
+#define XYZ_D64_LARGE     0x6000000000000000ull   // Bits 62..61, 11 form
+#define XYZ_D64_SPECIAL   0x7800000000000000ull   // Bits 62..59, inf or NaN
+#define XYZ_D64_NANBIT    0x0400000000000000ull   // Bit 58
+#define XYZ_D64_EXP_MASK  0x7FE0000000000000ull   // Bits 62..53, small form
+#define XYZ_D64_COEF_MASK 0x001FFFFFFFFFFFFFull   // Bits 52..0, small form
+#define XYZ_D64_COEF_MAX  9999999999999999ull
+#define XYZ_D64_BIAS      398
+
+#define XYZ_D128_BIAS     6176
+#define XYZ_D128_COEF_HI  0x0001FFFFFFFFFFFFull   // Bits 112..64 of the coefficient
+
+
+/**
+ * Power of ten as a u128.
+ *
+ * @param[in] n  exponent, 0 to 38.
+ *
+ * @return 10^n.
+ */
+static xyz_u128
+xyz_dec_pow10(u32 n)
+{
+   if ( n < 20 ) {
+      return xyz_u128_from_u64(xyz_pow10_u64[n]);
+   }
+
+   return xyz_u128_mul_u64(xyz_u128_from_u64(xyz_pow10_u64[19]), xyz_pow10_u64[n - 19]);
+}
+// xyz_dec_pow10()
+
+
+/**
+ * Number of decimal digits in a u128.
+ *
+ * @param[in] v  value.
+ *
+ * @return The digit count, 1 for 0.
+ */
+static u32
+xyz_dec_digits(xyz_u128 v)
+{
+   // 1233 / 4096 is just under log10(2), so this never overestimates.
+   u32 bits = xyz_u128_bits(v);
+   u32 digits = ( bits == 0 ? 1 : (((bits - 1) * 1233) >> 12) + 1 );
+
+   while ( digits < 39 && xyz_u128_cmp(v, xyz_dec_pow10(digits)) >= 0 ) {
+      digits++;
+   }
+
+   return digits;
+}
+// xyz_dec_digits()
+
+
+/**
+ * Multiply a u128 by a power of ten.  The product must fit.
+ *
+ * @param[in] v  value.
+ * @param[in] n  exponent, 0 to 38.
+ *
+ * @return v * 10^n.
+ */
+static xyz_u128
+xyz_dec_scale(xyz_u128 v, u32 n)
+{
+   if ( n > 19 ) {
+      v = xyz_u128_mul_u64(v, xyz_pow10_u64[19]);
+      n -= 19;
+   }
+
+   return xyz_u128_mul_u64(v, xyz_pow10_u64[n]);
+}
+// xyz_dec_scale()
+
+
+/**
+ * Divide a 256-bit value in four limbs by a u64 in place.
+ *
+ * @param[in,out] limb  least significant limb first.
+ * @param[in]     d     divisor, not zero.
+ *
+ * @return The remainder.
+ */
+static u64
+xyz_dec_limbs_div(u64 limb[4], u64 d)
+{
+   u64 rem = 0;
+
+   for ( s32 i = 3 ; i >= 0 ; i-- )
+   {
+      xyz_u128 x;
+      x.hi = rem;
+      x.lo = limb[i];
+      rem = xyz_u128_divmod_u64(&x, d);
+      limb[i] = x.lo;
+   }
+
+   return rem;
+}
+// xyz_dec_limbs_div()
+
+
+/**
+ * Round an exact result to the format, half-even, and range check it.
+ *
+ * @param[out] r     result, the sign is already set.
+ * @param[in]  limb  exact coefficient, least significant limb first, modified.
+ * @param[in]  exp   exponent of the exact coefficient.
+ * @param[in]  fmt   format parameters.
+ */
+static void
+xyz_dec_round(xyz_dec *r, u64 limb[4], s32 exp, const xyz_dec_fmt *fmt)
+{
+   u32 sticky = 0;
+   u32 round = 0;
+
+   // Shift off whole 19 digit chunks that are certainly beyond the
+   // precision, keeping one spare digit for the round digit below.
+   if ( (limb[2] | limb[3]) != 0 )
+   {
+      u32 bits = ( limb[3] != 0 ? 192 + xyz_u128_bits(xyz_u128_from_u64(limb[3]))
+                                : 128 + xyz_u128_bits(xyz_u128_from_u64(limb[2])) );
+      u32 drop = (((bits - 1) * 1233) >> 12) + 1 - fmt->digits - 1;
+
+      while ( drop > 0 )
+      {
+         u32 n = ( drop > 19 ? 19 : drop );
+         sticky |= ( xyz_dec_limbs_div(limb, xyz_pow10_u64[n]) != 0 ? 1 : 0 );
+         exp += (s32)n;
+         drop -= n;
+      }
+   }
+
+   xyz_u128 q;
+   q.lo = limb[0];
+   q.hi = limb[1];
+
+   // One digit at a time until the coefficient fits and the exponent is in
+   // range, going subnormal rather than below emin.
+   xyz_u128 top = xyz_dec_pow10(fmt->digits);
+   while ( xyz_u128_cmp(q, top) >= 0 || (exp < fmt->emin && (q.lo | q.hi) != 0) )
+   {
+      sticky |= ( round != 0 ? 1 : 0 );
+      round = (u32)xyz_u128_divmod_u64(&q, 10);
+      exp++;
+   }
+
+   if ( exp < fmt->emin ) {
+      // Everything was shifted off and the value is below the smallest
+      // subnormal by more than the round digit.
+      sticky |= ( round != 0 ? 1 : 0 );
+      round = 0;
+      exp = fmt->emin;
+   }
+
+   if ( round > 5 || (round == 5 && (sticky != 0 || (q.lo & 1) != 0)) )
+   {
+      q = xyz_u128_add(q, xyz_u128_from_u64(1));
+      if ( xyz_u128_cmp(q, top) == 0 ) {
+         q = xyz_dec_pow10(fmt->digits - 1);
+         exp++;
+      }
+   }
+
+   // Too large an exponent, use up the spare digits before overflowing.
+   if ( exp > fmt->emax )
+   {
+      if ( (q.lo | q.hi) == 0 ) {
+         exp = fmt->emax;
+      }
+
+      else
+      {
+         u32 room = fmt->digits - xyz_dec_digits(q);
+         if ( (u32)(exp - fmt->emax) <= room ) {
+            q = xyz_dec_scale(q, (u32)(exp - fmt->emax));
+            exp = fmt->emax;
+         } else {
+            r->cls = XYZ_DEC_INF;
+            return;
+         }
+      }
+   }
+
+   r->cls = XYZ_DEC_FINITE;
+   r->coef = q;
+   r->exp = exp;
+}
+// xyz_dec_round()
+
+
+/**
+ * Round a u128 coefficient, see xyz_dec_round().
+ */
+static void
+xyz_dec_round128(xyz_dec *r, xyz_u128 coef, s32 exp, const xyz_dec_fmt *fmt)
+{
+   u64 limb[4] = { coef.lo, coef.hi, 0, 0 };
+   xyz_dec_round(r, limb, exp, fmt);
+}
+// xyz_dec_round128()
+
+
+/**
+ * Add two unpacked values.
+ *
+ * @param[out] r    result.
+ * @param[in]  a    first operand.
+ * @param[in]  b    second operand.
+ * @param[in]  fmt  format parameters.
+ */
+static void
+xyz_dec_add(xyz_dec *r, const xyz_dec *a, const xyz_dec *b, const xyz_dec_fmt *fmt)
+{
+   r->sign = 0;
+
+   if ( a->cls == XYZ_DEC_NAN || b->cls == XYZ_DEC_NAN ) {
+      r->cls = XYZ_DEC_NAN;
+      return;
+   }
+
+   if ( a->cls == XYZ_DEC_INF || b->cls == XYZ_DEC_INF )
+   {
+      if ( a->cls == XYZ_DEC_INF && b->cls == XYZ_DEC_INF && a->sign != b->sign ) {
+         r->cls = XYZ_DEC_NAN;
+      } else {
+         r->cls = XYZ_DEC_INF;
+         r->sign = ( a->cls == XYZ_DEC_INF ? a->sign : b->sign );
+      }
+      return;
+   }
+
+   // Make a the operand with the larger exponent.
+   if ( a->exp < b->exp ) {
+      const xyz_dec *t = a;
+      a = b;
+      b = t;
+   }
+
+   xyz_u128 ca = a->coef;
+   xyz_u128 cb = b->coef;
+   s32 exp = b->exp;
+
+   // Nothing to align against a zero, b is exact at its own exponent.
+   u32 k = (u32)(a->exp - b->exp);
+   if ( k > 0 && (ca.lo | ca.hi) != 0 )
+   {
+      // Scale a up, keeping it under 10^37 so the sum has headroom.
+      u32 da = xyz_dec_digits(ca);
+      u32 s = ( k < 37 - da ? k : 37 - da );
+      ca = xyz_dec_scale(ca, s);
+
+      u32 t = k - s;
+      if ( t > 0 )
+      {
+         // Still apart, a is at least 10^36.  Scale it once more to 38
+         // digits and shift b right to meet it, jamming a nonzero digit in
+         // for anything shifted off so the rounding sees it.
+         ca = xyz_u128_mul_u64(ca, 10);
+         exp = a->exp - (s32)s - 1;
+
+         u64 rem;
+         if ( t - 1 > 38 ) {
+            rem = cb.lo | cb.hi;
+            cb = xyz_u128_from_u64(0);
+         }
+
+         else
+         {
+            u32 n = t - 1;
+            rem = 0;
+            while ( n > 0 ) {
+               u32 m = ( n > 19 ? 19 : n );
+               rem |= xyz_u128_divmod_u64(&cb, xyz_pow10_u64[m]);
+               n -= m;
+            }
+         }
+
+         // The last digit of all 128 bits, cb.lo alone is not it once
+         // cb.hi is set.
+         xyz_u128 last = cb;
+         if ( rem != 0 && xyz_u128_divmod_u64(&last, 10) == 0 ) {
+            cb = xyz_u128_add(cb, xyz_u128_from_u64(1));
+         }
+      }
+   }
+
+   xyz_u128 sum;
+   if ( a->sign == b->sign ) {
+      sum = xyz_u128_add(ca, cb);
+      r->sign = a->sign;
+   } else if ( xyz_u128_cmp(ca, cb) >= 0 ) {
+      sum = xyz_u128_sub(ca, cb);
+      r->sign = a->sign;
+   } else {
+      sum = xyz_u128_sub(cb, ca);
+      r->sign = b->sign;
+   }
+
+   // An exact zero is positive unless both operands were negative.
+   if ( (sum.lo | sum.hi) == 0 ) {
+      r->sign = a->sign & b->sign;
+   }
+
+   xyz_dec_round128(r, sum, exp, fmt);
+}
+// xyz_dec_add()
+
+
+/**
+ * Multiply two unpacked values.
+ *
+ * @param[out] r    result.
+ * @param[in]  a    first operand.
+ * @param[in]  b    second operand.
+ * @param[in]  fmt  format parameters.
+ */
+static void
+xyz_dec_mul(xyz_dec *r, const xyz_dec *a, const xyz_dec *b, const xyz_dec_fmt *fmt)
+{
+   r->sign = a->sign ^ b->sign;
+
+   if ( a->cls == XYZ_DEC_NAN || b->cls == XYZ_DEC_NAN ) {
+      r->cls = XYZ_DEC_NAN;
+      r->sign = 0;
+      return;
+   }
+
+   if ( a->cls == XYZ_DEC_INF || b->cls == XYZ_DEC_INF )
+   {
+      const xyz_dec *other = ( a->cls == XYZ_DEC_INF ? b : a );
+      if ( other->cls == XYZ_DEC_FINITE && (other->coef.lo | other->coef.hi) == 0 ) {
+         r->cls = XYZ_DEC_NAN;
+         r->sign = 0;
+      } else {
+         r->cls = XYZ_DEC_INF;
+      }
+      return;
+   }
+
+   // Schoolbook 128 x 128 -> 256.
+   xyz_u128 ll = xyz_u128_mul64(a->coef.lo, b->coef.lo);
+   xyz_u128 lh = xyz_u128_mul64(a->coef.lo, b->coef.hi);
+   xyz_u128 hl = xyz_u128_mul64(a->coef.hi, b->coef.lo);
+   xyz_u128 hh = xyz_u128_mul64(a->coef.hi, b->coef.hi);
+
+   xyz_u128 mid = xyz_u128_add(xyz_u128_from_u64(ll.hi), xyz_u128_from_u64(lh.lo));
+   mid = xyz_u128_add(mid, xyz_u128_from_u64(hl.lo));
+
+   xyz_u128 upper = xyz_u128_add(hh, xyz_u128_from_u64(lh.hi));
+   upper = xyz_u128_add(upper, xyz_u128_from_u64(hl.hi));
+   upper = xyz_u128_add(upper, xyz_u128_from_u64(mid.hi));
+
+   u64 limb[4] = { ll.lo, mid.lo, upper.lo, upper.hi };
+   xyz_dec_round(r, limb, a->exp + b->exp, fmt);
+}
+// xyz_dec_mul()
+
+
+/**
+ * Compare two unpacked values.
+ *
+ * @param[in] a  first operand.
+ * @param[in] b  second operand.
+ *
+ * @return -1, 0 or 1 as a is less, equal or greater, XYZ_DEC_UNORDERED
+ *         if either is NaN.
+ */
+static s32
+xyz_dec_cmp(const xyz_dec *a, const xyz_dec *b)
+{
+   if ( a->cls == XYZ_DEC_NAN || b->cls == XYZ_DEC_NAN ) {
+      return XYZ_DEC_UNORDERED;
+   }
+
+   u32 za = ( a->cls == XYZ_DEC_FINITE && (a->coef.lo | a->coef.hi) == 0 ? 1 : 0 );
+   u32 zb = ( b->cls == XYZ_DEC_FINITE && (b->coef.lo | b->coef.hi) == 0 ? 1 : 0 );
+
+   if ( za != 0 && zb != 0 ) {
+      return 0;
+   }
+
+   if ( za != 0 ) { return ( b->sign != 0 ? 1 : -1 ); }
+   if ( zb != 0 ) { return ( a->sign != 0 ? -1 : 1 ); }
+
+   if ( a->sign != b->sign ) {
+      return ( a->sign != 0 ? -1 : 1 );
+   }
+
+   // Same sign, compare the magnitudes.
+   s32 mag;
+   if ( a->cls == XYZ_DEC_INF || b->cls == XYZ_DEC_INF ) {
+      mag = (s32)a->cls - (s32)b->cls;
+   }
+
+   else
+   {
+      s32 adja = a->exp + (s32)xyz_dec_digits(a->coef);
+      s32 adjb = b->exp + (s32)xyz_dec_digits(b->coef);
+
+      if ( adja != adjb ) {
+         mag = ( adja < adjb ? -1 : 1 );
+      }
+
+      // Same magnitude, so the exponents are within the precision and the
+      // larger-exponent coefficient can be scaled to meet the other.
+      else if ( a->exp >= b->exp ) {
+         mag = xyz_u128_cmp(xyz_dec_scale(a->coef, (u32)(a->exp - b->exp)), b->coef);
+      } else {
+         mag = xyz_u128_cmp(a->coef, xyz_dec_scale(b->coef, (u32)(b->exp - a->exp)));
+      }
+   }
+
+   if ( mag != 0 ) {
+      mag = ( mag < 0 ? -1 : 1 );
+   }
+
+   return ( a->sign != 0 ? -mag : mag );
+}
+// xyz_dec_cmp()
+
+
+/**
+ * Format an unpacked value as a string.
+ *
+ * The IEEE 754 to-scientific-string form, which keeps the scale: plain
+ * notation when the exponent is at most 0 and the value is not tiny,
+ * "-12.50", otherwise scientific, "1.25E+3", "1E-9".  NaN and infinity
+ * are "NaN", "Inf", "-Inf".
+ *
+ * @param[in]  x    value.
+ * @param[out] buf  output buffer, always terminated when dim > 0.
+ * @param[in]  dim  size of buf, XYZ_DEC_STR_DIM always fits.
+ *
+ * @return The length of the full string, not counting the terminator, like
+ *         snprintf.  The output was truncated if this is dim or more.
+ */
+static u32
+xyz_dec_to_str(const xyz_dec *x, c8 *buf, u32 dim)
+{
+   c8 out[XYZ_DEC_STR_DIM + 64];
+   u32 len = 0;
+
+   if ( x->cls == XYZ_DEC_NAN ) {
+      memcpy(out, "NaN", 3);
+      len = 3;
+   }
+
+   else
+   {
+      if ( x->sign != 0 ) { out[len++] = '-'; }
+
+      if ( x->cls == XYZ_DEC_INF ) {
+         memcpy(out + len, "Inf", 3);
+         len += 3;
+      }
+
+      else
+      {
+         // Coefficient digits, most significant first.
+         c8 dig[40];
+         u32 nd = 0;
+         xyz_u128 c = x->coef;
+         do {
+            dig[39 - nd++] = (c8)('0' + xyz_u128_divmod_u64(&c, 10));
+         } while ( (c.lo | c.hi) != 0 );
+         const c8 *d = dig + 40 - nd;
+
+         s32 exp = x->exp;
+         s32 adj = exp + (s32)nd - 1;
+
+         if ( exp <= 0 && adj >= -6 )
+         {
+            // Plain, with a decimal point if there is a fraction.
+            s32 frac = -exp;
+            if ( frac >= (s32)nd ) {
+               out[len++] = '0';
+               out[len++] = '.';
+               for ( s32 i = (s32)nd ; i < frac ; i++ ) { out[len++] = '0'; }
+               memcpy(out + len, d, nd);
+               len += nd;
+            } else {
+               memcpy(out + len, d, nd - (u32)frac);
+               len += nd - (u32)frac;
+               if ( frac > 0 ) {
+                  out[len++] = '.';
+                  memcpy(out + len, d + nd - (u32)frac, (u32)frac);
+                  len += (u32)frac;
+               }
+            }
+         }
+
+         else
+         {
+            out[len++] = d[0];
+            if ( nd > 1 ) {
+               out[len++] = '.';
+               memcpy(out + len, d + 1, nd - 1);
+               len += nd - 1;
+            }
+
+            out[len++] = 'E';
+            out[len++] = ( adj < 0 ? '-' : '+' );
+            u32 ae = (u32)( adj < 0 ? -adj : adj );
+            c8 edig[8];
+            u32 ne = 0;
+            do { edig[ne++] = (c8)('0' + ae % 10); ae /= 10; } while ( ae != 0 );
+            while ( ne > 0 ) { out[len++] = edig[--ne]; }
+         }
+      }
+   }
+
+   if ( dim > 0 ) {
+      u32 n = ( len < dim ? len : dim - 1 );
+      memcpy(buf, out, n);
+      buf[n] = '\0';
+   }
+
+   return len;
+}
+// xyz_dec_to_str()
+
+
+/**
+ * Convert an unpacked value to the nearest double.
+ *
+ * @param[in] x  value.
+ *
+ * @return The value as a double.
+ */
+static double
+xyz_dec_to_double(const xyz_dec *x)
+{
+   // Let the C library do the correctly rounded conversion, it also
+   // parses "NaN" and "Inf".
+   c8 str[XYZ_DEC_STR_DIM];
+   xyz_dec_to_str(x, str, sizeof(str));
+   return strtod(str, NULL);
+}
+// xyz_dec_to_double()
+
+
+/**
+ * Make an unpacked value from a signed integer coefficient.
+ */
+static void
+xyz_dec_make(xyz_dec *r, s64 coef, s32 exp, const xyz_dec_fmt *fmt)
+{
+   r->sign = ( coef < 0 ? 1 : 0 );
+   u64 mag = ( coef < 0 ? (u64)0 - (u64)coef : (u64)coef );
+   xyz_dec_round128(r, xyz_u128_from_u64(mag), exp, fmt);
+}
+// xyz_dec_make()
+
+
+/**
+ * Unpack a decimal64.
+ *
+ * @param[out] x  unpacked value.
+ * @param[in]  a  decimal64 value.
+ */
+static void
+xyz_d64_unpack(xyz_dec *x, xyz_d64 a)
+{
+   x->sign = ( (a & XYZ_D64_SIGN) != 0 ? 1 : 0 );
+   x->cls = XYZ_DEC_FINITE;
+
+   u64 coef;
+   if ( (a & XYZ_D64_LARGE) != XYZ_D64_LARGE ) {
+      x->exp = (s32)((a >> 53) & 0x3FF) - XYZ_D64_BIAS;
+      coef = a & XYZ_D64_COEF_MASK;
+   }
+
+   else if ( (a & XYZ_D64_SPECIAL) == XYZ_D64_SPECIAL ) {
+      x->cls = ( (a & XYZ_D64_NANBIT) != 0 ? XYZ_DEC_NAN : XYZ_DEC_INF );
+      x->exp = 0;
+      coef = 0;
+   }
+
+   else
+   {
+      // Non-canonical coefficients are zero.
+      x->exp = (s32)((a >> 51) & 0x3FF) - XYZ_D64_BIAS;
+      coef = (a & 0x0007FFFFFFFFFFFFull) | 0x0020000000000000ull;
+      if ( coef > XYZ_D64_COEF_MAX ) { coef = 0; }
+   }
+
+   x->coef = xyz_u128_from_u64(coef);
+}
+// xyz_d64_unpack()
+
+
+/**
+ * Pack a decimal64, the value must already be rounded to the format.
+ *
+ * @param[in] x  unpacked value.
+ *
+ * @return The decimal64 value.
+ */
+static xyz_d64
+xyz_d64_pack(const xyz_dec *x)
+{
+   u64 sign = ( x->sign != 0 ? XYZ_D64_SIGN : 0 );
+
+   if ( x->cls == XYZ_DEC_NAN ) { return XYZ_D64_NAN; }
+   if ( x->cls == XYZ_DEC_INF ) { return sign | XYZ_D64_INF; }
+
+   u64 coef = x->coef.lo;
+   u64 bexp = (u64)(x->exp + XYZ_D64_BIAS);
+
+   if ( coef <= XYZ_D64_COEF_MASK ) {
+      return sign | (bexp << 53) | coef;
+   }
+
+   return sign | XYZ_D64_LARGE | (bexp << 51) | (coef & 0x0007FFFFFFFFFFFFull);
+}
+// xyz_d64_pack()
+
+
+/**
+ * Unpack a decimal128.
+ *
+ * @param[out] x  unpacked value.
+ * @param[in]  a  decimal128 value.
+ */
+static void
+xyz_d128_unpack(xyz_dec *x, xyz_d128 a)
+{
+   x->sign = ( (a.hi & XYZ_D64_SIGN) != 0 ? 1 : 0 );
+   x->cls = XYZ_DEC_FINITE;
+
+   if ( (a.hi & XYZ_D64_LARGE) != XYZ_D64_LARGE )
+   {
+      x->exp = (s32)((a.hi >> 49) & 0x3FFF) - XYZ_D128_BIAS;
+      x->coef.hi = a.hi & XYZ_D128_COEF_HI;
+      x->coef.lo = a.lo;
+
+      // Non-canonical coefficients are zero.
+      if ( xyz_u128_cmp(x->coef, xyz_dec_pow10(XYZ_D128_DIGITS)) >= 0 ) {
+         x->coef = xyz_u128_from_u64(0);
+      }
+   }
+
+   else if ( (a.hi & XYZ_D64_SPECIAL) == XYZ_D64_SPECIAL ) {
+      x->cls = ( (a.hi & XYZ_D64_NANBIT) != 0 ? XYZ_DEC_NAN : XYZ_DEC_INF );
+      x->exp = 0;
+      x->coef = xyz_u128_from_u64(0);
+   }
+
+   else {
+      // The 11 form is always past 10^34, non-canonical.
+      x->exp = (s32)((a.hi >> 47) & 0x3FFF) - XYZ_D128_BIAS;
+      x->coef = xyz_u128_from_u64(0);
+   }
+}
+// xyz_d128_unpack()
+
+
+/**
+ * Pack a decimal128, the value must already be rounded to the format.
+ *
+ * @param[in] x  unpacked value.
+ *
+ * @return The decimal128 value.
+ */
+static xyz_d128
+xyz_d128_pack(const xyz_dec *x)
+{
+   xyz_d128 r;
+   u64 sign = ( x->sign != 0 ? XYZ_D64_SIGN : 0 );
+
+   r.lo = 0;
+   if ( x->cls == XYZ_DEC_NAN ) { r.hi = XYZ_D64_NAN; return r; }
+   if ( x->cls == XYZ_DEC_INF ) { r.hi = sign | XYZ_D64_INF; return r; }
+
+   r.hi = sign | ((u64)(x->exp + XYZ_D128_BIAS) << 49) | x->coef.hi;
+   r.lo = x->coef.lo;
+   return r;
+}
+// xyz_d128_pack()
+
+
+/**
+ * Make a decimal64 from an integer coefficient and power of ten exponent,
+ * coef * 10^exp, rounded to 16 digits.  xyz_d64_make(1999, -2) is 19.99.
+ *
+ * @param[in] coef  signed coefficient.
+ * @param[in] exp   power of ten exponent.
+ *
+ * @return The decimal64 value.
+ */
+xyz_d64
+xyz_d64_make(s64 coef, s32 exp)
+{
+   xyz_dec r;
+   xyz_dec_make(&r, coef, exp, &xyz_dec_fmt64);
+   return xyz_d64_pack(&r);
+}
+// xyz_d64_make()
+
+
+/**
+ * Add two decimal64 values.
+ *
+ * @param[in] a  first operand.
+ * @param[in] b  second operand.
+ *
+ * @return a + b, rounded half-even.
+ */
+xyz_d64
+xyz_d64_add(xyz_d64 a, xyz_d64 b)
+{
+   // Fast path, both in the small coefficient form with the same exponent.
+   // Every small coefficient is canonical (2^53 < 10^16), and a result
+   // still under 2^53 packs in place with no rounding.
+   if ( (a & XYZ_D64_LARGE) != XYZ_D64_LARGE && (b & XYZ_D64_LARGE) != XYZ_D64_LARGE &&
+        ((a ^ b) & XYZ_D64_EXP_MASK) == 0 )
+   {
+      u64 ca = a & XYZ_D64_COEF_MASK;
+      u64 cb = b & XYZ_D64_COEF_MASK;
+      u64 head = a & XYZ_D64_EXP_MASK;
+
+      if ( ((a ^ b) & XYZ_D64_SIGN) == 0 ) {
+         u64 sum = ca + cb;
+         if ( sum <= XYZ_D64_COEF_MASK ) {
+            return (a & XYZ_D64_SIGN) | head | sum;
+         }
+      }
+
+      else if ( ca > cb ) { return (a & XYZ_D64_SIGN) | head | (ca - cb); }
+      else if ( ca < cb ) { return (b & XYZ_D64_SIGN) | head | (cb - ca); }
+      else { return head; }
+   }
+
+   xyz_dec x, y, r;
+   xyz_d64_unpack(&x, a);
+   xyz_d64_unpack(&y, b);
+   xyz_dec_add(&r, &x, &y, &xyz_dec_fmt64);
+   return xyz_d64_pack(&r);
+}
+// xyz_d64_add()
+
+
+/**
+ * Subtract two decimal64 values.
+ *
+ * @param[in] a  first operand.
+ * @param[in] b  second operand.
+ *
+ * @return a - b, rounded half-even.
+ */
+xyz_d64
+xyz_d64_sub(xyz_d64 a, xyz_d64 b)
+{
+   // Flipping the sign of NaN would still be NaN.
+   return xyz_d64_add(a, b ^ XYZ_D64_SIGN);
+}
+// xyz_d64_sub()
+
+
+/**
+ * Multiply two decimal64 values.
+ *
+ * @param[in] a  first operand.
+ * @param[in] b  second operand.
+ *
+ * @return a * b, rounded half-even.
+ */
+xyz_d64
+xyz_d64_mul(xyz_d64 a, xyz_d64 b)
+{
+   // Fast path, both small form with a product that is still small form
+   // and an exponent sum in range.
+   if ( (a & XYZ_D64_LARGE) != XYZ_D64_LARGE && (b & XYZ_D64_LARGE) != XYZ_D64_LARGE )
+   {
+      xyz_u128 p = xyz_u128_mul64(a & XYZ_D64_COEF_MASK, b & XYZ_D64_COEF_MASK);
+      s32 bexp = (s32)((a >> 53) & 0x3FF) + (s32)((b >> 53) & 0x3FF) - XYZ_D64_BIAS;
+
+      if ( p.hi == 0 && p.lo <= XYZ_D64_COEF_MASK && bexp >= 0 &&
+           bexp <= XYZ_D64_EMAX + XYZ_D64_BIAS ) {
+         return ((a ^ b) & XYZ_D64_SIGN) | ((u64)bexp << 53) | p.lo;
+      }
+   }
+
+   xyz_dec x, y, r;
+   xyz_d64_unpack(&x, a);
+   xyz_d64_unpack(&y, b);
+   xyz_dec_mul(&r, &x, &y, &xyz_dec_fmt64);
+   return xyz_d64_pack(&r);
+}
+// xyz_d64_mul()
+
+
+/**
+ * Compare two decimal64 values, numerically, 1.50 equals 1.5.
+ *
+ * @param[in] a  first operand.
+ * @param[in] b  second operand.
+ *
+ * @return -1, 0 or 1 as a is less, equal or greater, XYZ_DEC_UNORDERED
+ *         if either is NaN.
+ */
+s32
+xyz_d64_cmp(xyz_d64 a, xyz_d64 b)
+{
+   // Fast path, both small form with the same exponent.
+   if ( (a & XYZ_D64_LARGE) != XYZ_D64_LARGE && (b & XYZ_D64_LARGE) != XYZ_D64_LARGE &&
+        ((a ^ b) & XYZ_D64_EXP_MASK) == 0 )
+   {
+      s64 va = (s64)(a & XYZ_D64_COEF_MASK);
+      s64 vb = (s64)(b & XYZ_D64_COEF_MASK);
+      if ( (a & XYZ_D64_SIGN) != 0 ) { va = -va; }
+      if ( (b & XYZ_D64_SIGN) != 0 ) { vb = -vb; }
+      return ( va < vb ? -1 : va > vb ? 1 : 0 );
+   }
+
+   xyz_dec x, y;
+   xyz_d64_unpack(&x, a);
+   xyz_d64_unpack(&y, b);
+   return xyz_dec_cmp(&x, &y);
+}
+// xyz_d64_cmp()
+
+
+/**
+ * Convert a decimal64 to the nearest double.
+ *
+ * @param[in] a  value.
+ *
+ * @return The value as a double.
+ */
+double
+xyz_d64_to_double(xyz_d64 a)
+{
+   xyz_dec x;
+   xyz_d64_unpack(&x, a);
+   return xyz_dec_to_double(&x);
+}
+// xyz_d64_to_double()
+
+
+/**
+ * Format a decimal64 as a string, keeping its scale, "19.90".
+ *
+ * @param[in]  a    value.
+ * @param[out] buf  output buffer, always terminated when dim > 0.
+ * @param[in]  dim  size of buf, XYZ_DEC_STR_DIM always fits.
+ *
+ * @return The length of the full string, not counting the terminator, like
+ *         snprintf.  The output was truncated if this is dim or more.
+ */
+u32
+xyz_d64_to_str(xyz_d64 a, c8 *buf, u32 dim)
+{
+   xyz_dec x;
+   xyz_d64_unpack(&x, a);
+   return xyz_dec_to_str(&x, buf, dim);
+}
+// xyz_d64_to_str()
+
+
+/**
+ * Make a decimal128 from an integer coefficient and power of ten exponent,
+ * coef * 10^exp.
+ *
+ * @param[in] coef  signed coefficient.
+ * @param[in] exp   power of ten exponent.
+ *
+ * @return The decimal128 value.
+ */
+xyz_d128
+xyz_d128_make(s64 coef, s32 exp)
+{
+   xyz_dec r;
+   xyz_dec_make(&r, coef, exp, &xyz_dec_fmt128);
+   return xyz_d128_pack(&r);
+}
+// xyz_d128_make()
+
+
+/**
+ * Widen a decimal64 to a decimal128, always exact.
+ *
+ * @param[in] a  decimal64 value.
+ *
+ * @return The decimal128 value.
+ */
+xyz_d128
+xyz_d128_from_d64(xyz_d64 a)
+{
+   xyz_dec x;
+   xyz_d64_unpack(&x, a);
+   return xyz_d128_pack(&x);
+}
+// xyz_d128_from_d64()
+
+
+/**
+ * Add two decimal128 values.
+ *
+ * @param[in] a  first operand.
+ * @param[in] b  second operand.
+ *
+ * @return a + b, rounded half-even.
+ */
+xyz_d128
+xyz_d128_add(xyz_d128 a, xyz_d128 b)
+{
+   xyz_dec x, y, r;
+   xyz_d128_unpack(&x, a);
+   xyz_d128_unpack(&y, b);
+
+   // Fast path, same exponent and an exact integer result.
+   if ( x.cls == XYZ_DEC_FINITE && y.cls == XYZ_DEC_FINITE && x.exp == y.exp )
+   {
+      xyz_u128 top = xyz_dec_pow10(XYZ_D128_DIGITS);
+      r.cls = XYZ_DEC_FINITE;
+      r.exp = x.exp;
+
+      if ( x.sign == y.sign ) {
+         r.coef = xyz_u128_add(x.coef, y.coef);
+         r.sign = x.sign;
+         if ( xyz_u128_cmp(r.coef, top) < 0 ) { return xyz_d128_pack(&r); }
+      } else {
+         s32 c = xyz_u128_cmp(x.coef, y.coef);
+         r.coef = ( c >= 0 ? xyz_u128_sub(x.coef, y.coef) : xyz_u128_sub(y.coef, x.coef) );
+         r.sign = ( c > 0 ? x.sign : c < 0 ? y.sign : 0 );
+         return xyz_d128_pack(&r);
+      }
+   }
+
+   xyz_dec_add(&r, &x, &y, &xyz_dec_fmt128);
+   return xyz_d128_pack(&r);
+}
+// xyz_d128_add()
+
+
+/**
+ * Subtract two decimal128 values.
+ *
+ * @param[in] a  first operand.
+ * @param[in] b  second operand.
+ *
+ * @return a - b, rounded half-even.
+ */
+xyz_d128
+xyz_d128_sub(xyz_d128 a, xyz_d128 b)
+{
+   b.hi ^= XYZ_D64_SIGN;
+   return xyz_d128_add(a, b);
+}
+// xyz_d128_sub()
+
+
+/**
+ * Multiply two decimal128 values.
+ *
+ * @param[in] a  first operand.
+ * @param[in] b  second operand.
+ *
+ * @return a * b, rounded half-even.
+ */
+xyz_d128
+xyz_d128_mul(xyz_d128 a, xyz_d128 b)
+{
+   xyz_dec x, y, r;
+   xyz_d128_unpack(&x, a);
+   xyz_d128_unpack(&y, b);
+
+   // Fast path, both coefficients fit a u64 and so does the product.
+   if ( x.cls == XYZ_DEC_FINITE && y.cls == XYZ_DEC_FINITE &&
+        (x.coef.hi | y.coef.hi) == 0 )
+   {
+      r.coef = xyz_u128_mul64(x.coef.lo, y.coef.lo);
+      r.exp = x.exp + y.exp;
+      r.sign = x.sign ^ y.sign;
+      r.cls = XYZ_DEC_FINITE;
+
+      if ( r.coef.hi == 0 && r.exp >= XYZ_D128_EMIN && r.exp <= XYZ_D128_EMAX ) {
+         return xyz_d128_pack(&r);
+      }
+   }
+
+   xyz_dec_mul(&r, &x, &y, &xyz_dec_fmt128);
+   return xyz_d128_pack(&r);
+}
+// xyz_d128_mul()
+
+
+/**
+ * Compare two decimal128 values, numerically.
+ *
+ * @param[in] a  first operand.
+ * @param[in] b  second operand.
+ *
+ * @return -1, 0 or 1 as a is less, equal or greater, XYZ_DEC_UNORDERED
+ *         if either is NaN.
+ */
+s32
+xyz_d128_cmp(xyz_d128 a, xyz_d128 b)
+{
+   xyz_dec x, y;
+   xyz_d128_unpack(&x, a);
+   xyz_d128_unpack(&y, b);
+
+   // Fast path, same exponent and sign.
+   if ( x.cls == XYZ_DEC_FINITE && y.cls == XYZ_DEC_FINITE && x.exp == y.exp &&
+        x.sign == y.sign ) {
+      s32 c = xyz_u128_cmp(x.coef, y.coef);
+      return ( x.sign != 0 ? -c : c );
+   }
+
+   return xyz_dec_cmp(&x, &y);
+}
+// xyz_d128_cmp()
+
+
+/**
+ * Convert a decimal128 to the nearest double.
+ *
+ * @param[in] a  value.
+ *
+ * @return The value as a double.
+ */
+double
+xyz_d128_to_double(xyz_d128 a)
+{
+   xyz_dec x;
+   xyz_d128_unpack(&x, a);
+   return xyz_dec_to_double(&x);
+}
+// xyz_d128_to_double()
+
+
+/**
+ * Format a decimal128 as a string, keeping its scale.
+ *
+ * @param[in]  a    value.
+ * @param[out] buf  output buffer, always terminated when dim > 0.
+ * @param[in]  dim  size of buf, XYZ_DEC_STR_DIM always fits.
+ *
+ * @return The length of the full string, not counting the terminator, like
+ *         snprintf.  The output was truncated if this is dim or more.
+ */
+u32
+xyz_d128_to_str(xyz_d128 a, c8 *buf, u32 dim)
+{
+   xyz_dec x;
+   xyz_d128_unpack(&x, a);
+   return xyz_dec_to_str(&x, buf, dim);
+}
+// xyz_d128_to_str()
+
+
+
+// ==========================================================================
+//
+// UTF-8 validation and code point counting
+//
+// ==========================================================================
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define XYZ_X86_SIMD 1
+#endif
+
+// The AVX2 functions are compiled for AVX2 regardless of the build flags,
+// and only called when the CPU has it.
+#if defined(XYZ_X86_SIMD) && (defined(__GNUC__) || defined(__clang__))
+#define XYZ_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define XYZ_TARGET_AVX2
+#endif
+
+/// Detected xyz_simd_level(), or not yet detected.
+#define XYZ_SIMD_UNKNOWN 0xFFFFFFFF
+static u32 xyz_simd_detected = XYZ_SIMD_UNKNOWN;
+
+
+/**
+ * The SIMD level to use on this CPU, detected once.
+ *
+ * @return XYZ_SIMD_SCALAR, XYZ_SIMD_SSE2 or XYZ_SIMD_AVX2.
+ */
+u32
+xyz_simd_level(void)
+{
+   // Racing first callers detect the same answer.
+   u32 level = xyz_atomic_ld_rlx_u32(&xyz_simd_detected);
+   if ( level != XYZ_SIMD_UNKNOWN ) {
+      return level;
+   }
+
+   level = XYZ_SIMD_SCALAR;
+
+#if defined(XYZ_X86_SIMD)
+   level = XYZ_SIMD_SSE2;
+
+#if defined(__GNUC__) || defined(__clang__)
+   __builtin_cpu_init();
+   if ( __builtin_cpu_supports("avx2") ) {
+      level = XYZ_SIMD_AVX2;
+   }
+#elif defined(_MSC_VER)
+   // AVX2 needs the CPU flag and the OS saving the YMM registers (XCR0
+   // bits 1 and 2, checked once OSXSAVE says xgetbv is usable).
+   int info[4];
+   __cpuid(info, 0);
+   if ( info[0] >= 7 )
+   {
+      __cpuid(info, 1);
+      u32 osxsave = ((u32)info[2] >> 27) & 1;
+      u32 avx = ((u32)info[2] >> 28) & 1;
+      __cpuidex(info, 7, 0);
+      u32 avx2 = ((u32)info[1] >> 5) & 1;
+      if ( osxsave != 0 && avx != 0 && avx2 != 0 && (_xgetbv(0) & 6) == 6 ) {
+         level = XYZ_SIMD_AVX2;
+      }
+   }
+#endif
+#endif
+
+   xyz_atomic_st_rlx_u32(&xyz_simd_detected, level);
+   return level;
+}
+// xyz_simd_level()
+
+
+/**
+ * Limit the SIMD level, to compare the kernels against each other or to
+ * rule one out.  Not meant to be called while other threads are using the
+ * UTF-8 functions, they may run with either level.
+ *
+ * @param[in] level  highest level to use, a level above what the CPU
+ *                   supports uses what the CPU supports.
+ *
+ * @return The level now in use.
+ */
+u32
+xyz_simd_level_set(u32 level)
+{
+   xyz_atomic_st_rlx_u32(&xyz_simd_detected, XYZ_SIMD_UNKNOWN);
+   u32 max = xyz_simd_level();
+
+   if ( level < max ) {
+      xyz_atomic_st_rlx_u32(&xyz_simd_detected, level);
+      return level;
+   }
+
+   return max;
+}
+// xyz_simd_level_set()
+
+
+/**
+ * Validate one character.
+ *
+ * @param[in] p    string.
+ * @param[in] len  length of the string in bytes.
+ * @param[in] i    offset of the character, less than len.
+ *
+ * @return The length of the character in bytes, 0 if it is not valid.
+ */
+static u32
+xyz_utf8_step(const u8 *p, u64 len, u64 i)
+{
+   u32 c = p[i];
+   u32 need;
+   u32 lo = 0x80;
+   u32 hi = 0xBF;
+
+   if ( c < 0x80 ) { return 1; }
+
+   // The second byte range excludes the overlong forms (E0, F0), the
+   // surrogates (ED) and anything past U+10FFFF (F4).
+   if      ( c >= 0xC2 && c <= 0xDF ) { need = 1; }
+   else if ( c == 0xE0 )              { need = 2; lo = 0xA0; }
+   else if ( c == 0xED )              { need = 2; hi = 0x9F; }
+   else if ( c >= 0xE1 && c <= 0xEF ) { need = 2; }
+   else if ( c == 0xF0 )              { need = 3; lo = 0x90; }
+   else if ( c >= 0xF1 && c <= 0xF3 ) { need = 3; }
+   else if ( c == 0xF4 )              { need = 3; hi = 0x8F; }
+   else { return 0; }
+
+   if ( len - i <= need ) { return 0; }
+   if ( p[i + 1] < lo || p[i + 1] > hi ) { return 0; }
+
+   for ( u32 k = 2 ; k <= need ; k++ ) {
+      if ( (p[i + k] & 0xC0) != 0x80 ) { return 0; }
+   }
+
+   return need + 1;
+}
+// xyz_utf8_step()
+
+
+/**
+ * Count code points, one byte at a time.
+ *
+ * @param[in] p    string.
+ * @param[in] len  length of the string in bytes.
+ *
+ * @return The number of bytes that are not continuation bytes.
+ */
+static u64
+xyz_utf8_count_scalar(const u8 *p, u64 len)
+{
+   u64 conts = 0;
+   for ( u64 i = 0 ; i < len ; i++ ) {
+      conts += ( (p[i] & 0xC0) == 0x80 ? 1 : 0 );
+   }
+   return len - conts;
+}
+// xyz_utf8_count_scalar()
+
+
+/**
+ * Validate and count, one character at a time.
+ *
+ * @param[in]  p      string.
+ * @param[in]  len    length of the string in bytes.
+ * @param[in]  i      offset to start at, on a character boundary.
+ * @param[in]  end    offset to stop at or after, at most len.
+ * @param[out] next   offset of the first character not checked.
+ * @param[out] units  code points checked.
+ *
+ * @return XYZ_TRUE if the characters are valid, otherwise XYZ_FALSE.
+ */
+static u32
+xyz_utf8_check_scalar(const u8 *p, u64 len, u64 i, u64 end, u64 *next, u64 *units)
+{
+   u64 n = 0;
+
+   while ( i < end )
+   {
+      u32 step = xyz_utf8_step(p, len, i);
+      if ( step == 0 ) { return XYZ_FALSE; }
+      i += step;
+      n++;
+   }
+
+   *next = i;
+   *units = n;
+   return XYZ_TRUE;
+}
+// xyz_utf8_check_scalar()
+
+
+#if defined(XYZ_X86_SIMD)
+
+/**
+ * Validate and count, skipping all-ASCII blocks 16 bytes at a time.
+ *
+ * @param[in]  p      string.
+ * @param[in]  len    length of the string in bytes.
+ * @param[out] units  code points.
+ *
+ * @return XYZ_TRUE if the string is valid, otherwise XYZ_FALSE.
+ */
+static u32
+xyz_utf8_check_sse2(const u8 *p, u64 len, u64 *units)
+{
+   u64 n = 0;
+   u64 i = 0;
+
+   while ( i + 16 <= len )
+   {
+      __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+      if ( _mm_movemask_epi8(v) == 0 ) {
+         i += 16;
+         n += 16;
+         continue;
+      }
+
+      // Multibyte characters somewhere in the block, check through the end
+      // of it.  The last character may run into the next block.
+      u64 part;
+      if ( xyz_utf8_check_scalar(p, len, i, i + 16, &i, &part) == XYZ_FALSE ) {
+         return XYZ_FALSE;
+      }
+      n += part;
+   }
+
+   u64 part;
+   if ( xyz_utf8_check_scalar(p, len, i, len, &i, &part) == XYZ_FALSE ) {
+      return XYZ_FALSE;
+   }
+
+   *units = n + part;
+   return XYZ_TRUE;
+}
+// xyz_utf8_check_sse2()
+
+
+/**
+ * Count code points, 16 bytes at a time.
+ *
+ * @param[in] p    string.
+ * @param[in] len  length of the string in bytes.
+ *
+ * @return The number of bytes that are not continuation bytes.
+ */
+static u64
+xyz_utf8_count_sse2(const u8 *p, u64 len)
+{
+   // Continuation bytes are 0x80..0xBF, the signed bytes below -64.  The
+   // compare gives -1 for each, subtracted into byte counters that are
+   // summed before they can wrap.
+   const __m128i limit = _mm_set1_epi8(-64);
+   const __m128i zero = _mm_setzero_si128();
+   __m128i total = zero;
+   u64 i = 0;
+
+   while ( i + 16 <= len )
+   {
+      __m128i acc = zero;
+      for ( u32 k = 0 ; k < 255 && i + 16 <= len ; k++, i += 16 ) {
+         __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+         acc = _mm_sub_epi8(acc, _mm_cmplt_epi8(v, limit));
+      }
+      total = _mm_add_epi64(total, _mm_sad_epu8(acc, zero));
+   }
+
+   u64 conts = (u64)_mm_cvtsi128_si64(total) + (u64)_mm_cvtsi128_si64(_mm_unpackhi_epi64(total, total));
+   for ( ; i < len ; i++ ) {
+      conts += ( (p[i] & 0xC0) == 0x80 ? 1 : 0 );
+   }
+
+   return len - conts;
+}
+// xyz_utf8_count_sse2()
+
+
+/**
+ * Bytes of the previous block shifted in ahead of the current one, the
+ * current block shifted right by n bytes across the 128-bit lanes.
+ */
+#define XYZ_UTF8_PREV(cur, prev, n) \
+   _mm256_alignr_epi8((cur), _mm256_permute2x128_si256((prev), (cur), 0x21), 16 - (n))
+
+// Error classes for the lookup tables, a byte pair is an error when all
+// three lookups share a bit.
+#define XYZ_UTF8_TOO_SHORT   (1 << 0)   // Lead byte not followed by a continuation
+#define XYZ_UTF8_TOO_LONG    (1 << 1)   // ASCII followed by a continuation
+#define XYZ_UTF8_OVERLONG_3  (1 << 2)   // E0 80..9F
+#define XYZ_UTF8_TOO_LARGE   (1 << 3)   // F4 90..BF, F5..FF
+#define XYZ_UTF8_SURROGATE   (1 << 4)   // ED A0..BF
+#define XYZ_UTF8_OVERLONG_2  (1 << 5)   // C0, C1
+#define XYZ_UTF8_TOO_LARGE_1000 (1 << 6) // F5..FF 80..8F
+#define XYZ_UTF8_OVERLONG_4  (1 << 6)   // F0 80..8F
+#define XYZ_UTF8_TWO_CONTS   (1 << 7)   // Continuation after continuation
+#define XYZ_UTF8_CARRY       (XYZ_UTF8_TOO_SHORT | XYZ_UTF8_TOO_LONG | XYZ_UTF8_TWO_CONTS)
+
+
+/**
+ * Check a 32 byte block against the one before it.
+ *
+ * @param[in] cur   current block.
+ * @param[in] prev  previous block.
+ *
+ * @return Nonzero bytes where there are errors.
+ */
+XYZ_TARGET_AVX2 static __m256i
+xyz_utf8_block_avx2(__m256i cur, __m256i prev)
+{
+   const __m256i byte_1_high_tbl = _mm256_setr_epi8(
+      XYZ_UTF8_TOO_LONG, XYZ_UTF8_TOO_LONG, XYZ_UTF8_TOO_LONG, XYZ_UTF8_TOO_LONG,
+      XYZ_UTF8_TOO_LONG, XYZ_UTF8_TOO_LONG, XYZ_UTF8_TOO_LONG, XYZ_UTF8_TOO_LONG,
+      (s8)XYZ_UTF8_TWO_CONTS, (s8)XYZ_UTF8_TWO_CONTS, (s8)XYZ_UTF8_TWO_CONTS, (s8)XYZ_UTF8_TWO_CONTS,
+      XYZ_UTF8_TOO_SHORT | XYZ_UTF8_OVERLONG_2,
+      XYZ_UTF8_TOO_SHORT,
+      XYZ_UTF8_TOO_SHORT | XYZ_UTF8_OVERLONG_3 | XYZ_UTF8_SURROGATE,
+      (s8)(XYZ_UTF8_TOO_SHORT | XYZ_UTF8_TOO_LARGE | XYZ_UTF8_TOO_LARGE_1000 | XYZ_UTF8_OVERLONG_4),
+      XYZ_UTF8_TOO_LONG, XYZ_UTF8_TOO_LONG, XYZ_UTF8_TOO_LONG, XYZ_UTF8_TOO_LONG,
+      XYZ_UTF8_TOO_LONG, XYZ_UTF8_TOO_LONG, XYZ_UTF8_TOO_LONG, XYZ_UTF8_TOO_LONG,
+      (s8)XYZ_UTF8_TWO_CONTS, (s8)XYZ_UTF8_TWO_CONTS, (s8)XYZ_UTF8_TWO_CONTS, (s8)XYZ_UTF8_TWO_CONTS,
+      XYZ_UTF8_TOO_SHORT | XYZ_UTF8_OVERLONG_2,
+      XYZ_UTF8_TOO_SHORT,
+      XYZ_UTF8_TOO_SHORT | XYZ_UTF8_OVERLONG_3 | XYZ_UTF8_SURROGATE,
+      (s8)(XYZ_UTF8_TOO_SHORT | XYZ_UTF8_TOO_LARGE | XYZ_UTF8_TOO_LARGE_1000 | XYZ_UTF8_OVERLONG_4));
+
+#define XYZ_UTF8_LOW_ROW \
+      (s8)(XYZ_UTF8_CARRY | XYZ_UTF8_OVERLONG_3 | XYZ_UTF8_OVERLONG_2 | XYZ_UTF8_OVERLONG_4), \
+      (s8)(XYZ_UTF8_CARRY | XYZ_UTF8_OVERLONG_2), \
+      (s8)XYZ_UTF8_CARRY, \
+      (s8)XYZ_UTF8_CARRY, \
+      (s8)(XYZ_UTF8_CARRY | XYZ_UTF8_TOO_LARGE), \
+      (s8)(XYZ_UTF8_CARRY | XYZ_UTF8_TOO_LARGE | XYZ_UTF8_TOO_LARGE_1000), \
+      (s8)(XYZ_UTF8_CARRY | XYZ_UTF8_TOO_LARGE | XYZ_UTF8_TOO_LARGE_1000), \
+      (s8)(XYZ_UTF8_CARRY | XYZ_UTF8_TOO_LARGE | XYZ_UTF8_TOO_LARGE_1000), \
+      (s8)(XYZ_UTF8_CARRY | XYZ_UTF8_TOO_LARGE | XYZ_UTF8_TOO_LARGE_1000), \
+      (s8)(XYZ_UTF8_CARRY | XYZ_UTF8_TOO_LARGE | XYZ_UTF8_TOO_LARGE_1000), \
+      (s8)(XYZ_UTF8_CARRY | XYZ_UTF8_TOO_LARGE | XYZ_UTF8_TOO_LARGE_1000), \
+      (s8)(XYZ_UTF8_CARRY | XYZ_UTF8_TOO_LARGE | XYZ_UTF8_TOO_LARGE_1000), \
+      (s8)(XYZ_UTF8_CARRY | XYZ_UTF8_TOO_LARGE | XYZ_UTF8_TOO_LARGE_1000), \
+      (s8)(XYZ_UTF8_CARRY | XYZ_UTF8_TOO_LARGE | XYZ_UTF8_TOO_LARGE_1000 | XYZ_UTF8_SURROGATE), \
+      (s8)(XYZ_UTF8_CARRY | XYZ_UTF8_TOO_LARGE | XYZ_UTF8_TOO_LARGE_1000), \
+      (s8)(XYZ_UTF8_CARRY | XYZ_UTF8_TOO_LARGE | XYZ_UTF8_TOO_LARGE_1000)
+
+   const __m256i byte_1_low_tbl = _mm256_setr_epi8(XYZ_UTF8_LOW_ROW, XYZ_UTF8_LOW_ROW);
+#undef XYZ_UTF8_LOW_ROW
+
+#define XYZ_UTF8_HIGH_ROW \
+      XYZ_UTF8_TOO_SHORT, XYZ_UTF8_TOO_SHORT, XYZ_UTF8_TOO_SHORT, XYZ_UTF8_TOO_SHORT, \
+      XYZ_UTF8_TOO_SHORT, XYZ_UTF8_TOO_SHORT, XYZ_UTF8_TOO_SHORT, XYZ_UTF8_TOO_SHORT, \
+      (s8)(XYZ_UTF8_TOO_LONG | XYZ_UTF8_OVERLONG_2 | XYZ_UTF8_TWO_CONTS | XYZ_UTF8_OVERLONG_3 | \
+           XYZ_UTF8_TOO_LARGE_1000 | XYZ_UTF8_OVERLONG_4), \
+      (s8)(XYZ_UTF8_TOO_LONG | XYZ_UTF8_OVERLONG_2 | XYZ_UTF8_TWO_CONTS | XYZ_UTF8_OVERLONG_3 | \
+           XYZ_UTF8_TOO_LARGE), \
+      (s8)(XYZ_UTF8_TOO_LONG | XYZ_UTF8_OVERLONG_2 | XYZ_UTF8_TWO_CONTS | XYZ_UTF8_SURROGATE | \
+           XYZ_UTF8_TOO_LARGE), \
+      (s8)(XYZ_UTF8_TOO_LONG | XYZ_UTF8_OVERLONG_2 | XYZ_UTF8_TWO_CONTS | XYZ_UTF8_SURROGATE | \
+           XYZ_UTF8_TOO_LARGE), \
+      XYZ_UTF8_TOO_SHORT, XYZ_UTF8_TOO_SHORT, XYZ_UTF8_TOO_SHORT, XYZ_UTF8_TOO_SHORT
+
+   const __m256i byte_2_high_tbl = _mm256_setr_epi8(XYZ_UTF8_HIGH_ROW, XYZ_UTF8_HIGH_ROW);
+#undef XYZ_UTF8_HIGH_ROW
+
+   const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+   __m256i prev1 = XYZ_UTF8_PREV(cur, prev, 1);
+   __m256i b1h = _mm256_shuffle_epi8(byte_1_high_tbl, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+   __m256i b1l = _mm256_shuffle_epi8(byte_1_low_tbl, _mm256_and_si256(prev1, nibble));
+   __m256i b2h = _mm256_shuffle_epi8(byte_2_high_tbl, _mm256_and_si256(_mm256_srli_epi16(cur, 4), nibble));
+   __m256i special = _mm256_and_si256(_mm256_and_si256(b1h, b1l), b2h);
+
+   // The lookups flag every continuation that is not directly after a lead
+   // byte as TWO_CONTS.  The third and fourth bytes of a sequence are
+   // allowed, and required, exactly where a lead two or three back says so.
+   __m256i prev2 = XYZ_UTF8_PREV(cur, prev, 2);
+   __m256i prev3 = XYZ_UTF8_PREV(cur, prev, 3);
+   __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8((s8)(0xE0 - 0x80)));
+   __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8((s8)(0xF0 - 0x80)));
+   __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((s8)0x80));
+
+   return _mm256_xor_si256(must23, special);
+}
+// xyz_utf8_block_avx2()
+
+
+/**
+ * Validate and count, 32 bytes at a time.
+ *
+ * @param[in]  p      string.
+ * @param[in]  len    length of the string in bytes.
+ * @param[out] units  code points.
+ *
+ * @return XYZ_TRUE if the string is valid, otherwise XYZ_FALSE.
+ */
+XYZ_TARGET_AVX2 static u32
+xyz_utf8_check_avx2(const u8 *p, u64 len, u64 *units)
+{
+   // A block ending in the middle of a sequence is only an error if the
+   // next block does not finish it, so the check is carried in incomplete.
+   const __m256i incomplete_max = _mm256_setr_epi8(
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      (s8)(0xF0 - 1), (s8)(0xE0 - 1), (s8)(0xC0 - 1));
+   const __m256i limit = _mm256_set1_epi8(-64);
+   const __m256i zero = _mm256_setzero_si256();
+
+   __m256i prev = zero;
+   __m256i incomplete = zero;
+   __m256i error = zero;
+   __m256i acc = zero;
+   __m256i total = zero;
+   u32 pending = 0;
+   u64 i = 0;
+
+   while ( i < len )
+   {
+      __m256i cur;
+      if ( i + 32 <= len ) {
+         cur = _mm256_loadu_si256((const __m256i *)(p + i));
+      } else {
+         // Zero padding is ASCII, valid and not counted as continuations.
+         u8 tail[32] = { 0 };
+         memcpy(tail, p + i, (size_t)(len - i));
+         cur = _mm256_loadu_si256((const __m256i *)tail);
+      }
+      i += 32;
+
+      if ( _mm256_movemask_epi8(cur) == 0 ) {
+         error = _mm256_or_si256(error, incomplete);
+         incomplete = zero;
+      } else {
+         error = _mm256_or_si256(error, xyz_utf8_block_avx2(cur, prev));
+         incomplete = _mm256_subs_epu8(cur, incomplete_max);
+         acc = _mm256_sub_epi8(acc, _mm256_cmpgt_epi8(limit, cur));
+         if ( ++pending == 255 ) {
+            total = _mm256_add_epi64(total, _mm256_sad_epu8(acc, zero));
+            acc = zero;
+            pending = 0;
+         }
+      }
+      prev = cur;
+   }
+
+   error = _mm256_or_si256(error, incomplete);
+   if ( _mm256_testz_si256(error, error) == 0 ) {
+      return XYZ_FALSE;
+   }
+
+   total = _mm256_add_epi64(total, _mm256_sad_epu8(acc, zero));
+   __m128i t = _mm_add_epi64(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+   u64 conts = (u64)_mm_cvtsi128_si64(t) + (u64)_mm_cvtsi128_si64(_mm_unpackhi_epi64(t, t));
+
+   *units = len - conts;
+   return XYZ_TRUE;
+}
+// xyz_utf8_check_avx2()
+
+
+/**
+ * Count code points, 32 bytes at a time.
+ *
+ * @param[in] p    string.
+ * @param[in] len  length of the string in bytes.
+ *
+ * @return The number of bytes that are not continuation bytes.
+ */
+XYZ_TARGET_AVX2 static u64
+xyz_utf8_count_avx2(const u8 *p, u64 len)
+{
+   const __m256i limit = _mm256_set1_epi8(-64);
+   const __m256i zero = _mm256_setzero_si256();
+   __m256i total = zero;
+   u64 i = 0;
+
+   while ( i + 32 <= len )
+   {
+      __m256i acc = zero;
+      for ( u32 k = 0 ; k < 255 && i + 32 <= len ; k++, i += 32 ) {
+         __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+         acc = _mm256_sub_epi8(acc, _mm256_cmpgt_epi8(limit, v));
+      }
+      total = _mm256_add_epi64(total, _mm256_sad_epu8(acc, zero));
+   }
+
+   __m128i t = _mm_add_epi64(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+   u64 conts = (u64)_mm_cvtsi128_si64(t) + (u64)_mm_cvtsi128_si64(_mm_unpackhi_epi64(t, t));
+   for ( ; i < len ; i++ ) {
+      conts += ( (p[i] & 0xC0) == 0x80 ? 1 : 0 );
+   }
+
+   return len - conts;
+}
+// xyz_utf8_count_avx2()
+
+#endif // XYZ_X86_SIMD
+
+
+/**
+ * Validate and count the code points in a UTF-8 string in one pass.
+ *
+ * @param[in]  str    string, need not be terminated.
+ * @param[in]  len    length of the string in bytes.
+ * @param[out] units  number of code points, only set when the string is
+ *                    valid.
+ *
+ * @return XYZ_OK if the string is valid UTF-8, otherwise XYZ_ERR.
+ */
+s32
+xyz_utf8_units(const void *str, u64 len, u64 *units)
+{
+   const u8 *p = (const u8 *)str;
+   u32 valid;
+   u64 n = 0;
+
+#if defined(XYZ_X86_SIMD)
+   u32 level = xyz_simd_level();
+   if ( level == XYZ_SIMD_AVX2 ) {
+      valid = xyz_utf8_check_avx2(p, len, &n);
+   } else if ( level == XYZ_SIMD_SSE2 ) {
+      valid = xyz_utf8_check_sse2(p, len, &n);
+   } else
+#endif
+   {
+      u64 next;
+      valid = xyz_utf8_check_scalar(p, len, 0, len, &next, &n);
+   }
+
+   if ( valid == XYZ_FALSE ) {
+      return XYZ_ERR;
+   }
+
+   *units = n;
+   return XYZ_OK;
+}
+// xyz_utf8_units()
+
+
+/**
+ * Test for well-formed UTF-8.
+ *
+ * @param[in] str  string, need not be terminated.
+ * @param[in] len  length of the string in bytes.
+ *
+ * @return XYZ_TRUE if the string is valid UTF-8, otherwise XYZ_FALSE.
+ */
+u32
+xyz_utf8_valid(const void *str, u64 len)
+{
+   u64 units;
+   return ( xyz_utf8_units(str, len, &units) == XYZ_OK ? XYZ_TRUE : XYZ_FALSE );
+}
+// xyz_utf8_valid()
+
+
+/**
+ * Count the code points in a UTF-8 string, without validating it.
+ *
+ * @param[in] str  string, need not be terminated.
+ * @param[in] len  length of the string in bytes.
+ *
+ * @return The number of bytes that are not continuation bytes, which is
+ *         the number of code points when the string is valid.
+ */
+u64
+xyz_utf8_count(const void *str, u64 len)
+{
+   const u8 *p = (const u8 *)str;
+
+#if defined(XYZ_X86_SIMD)
+   u32 level = xyz_simd_level();
+   if ( level == XYZ_SIMD_AVX2 ) {
+      return xyz_utf8_count_avx2(p, len);
+   }
+   if ( level == XYZ_SIMD_SSE2 ) {
+      return xyz_utf8_count_sse2(p, len);
+   }
+#endif
+
+   return xyz_utf8_count_scalar(p, len);
+}
+// xyz_utf8_count()
+
+
+
+// ==========================================================================
+//
+// Integer formatting and parsing
+//
+// ==========================================================================
+
+
+/// "00" to "99", two digits per lookup.
+static const c8 xyz_digits2[201] =
+   "00010203040506070809" "10111213141516171819" "20212223242526272829"
+   "30313233343536373839" "40414243444546474849" "50515253545556575859"
+   "60616263646566676869" "70717273747576777879" "80818283848586878889"
+   "90919293949596979899";
+
+
+/**
+ * Number of decimal digits in a u64.
+ *
+ * @param[in] v  value.
+ *
+ * @return The digit count, 1 for 0.
+ */
+static u32
+xyz_u64_digits(u64 v)
+{
+   // Estimate from the bit length, 1233 / 4096 is just under log10(2), then
+   // one compare to correct it.
+   if ( v < 10 ) { return 1; }
+
+   u32 bits = xyz_u128_bits(xyz_u128_from_u64(v));
+   u32 digits = ((bits * 1233) >> 12);
+   return digits + ( v >= xyz_pow10_u64[digits] ? 1 : 0 );
+}
+// xyz_u64_digits()
+
+
+/**
+ * Format a u64 into buf, right to left from the end of the digits.
+ *
+ * @param[in]  v    value.
+ * @param[out] buf  output, at least 21 bytes, terminated.
+ *
+ * @return The number of digits.
+ */
+static u32
+xyz_fmt_u64(u64 v, c8 *buf)
+{
+   u32 len = xyz_u64_digits(v);
+   c8 *p = buf + len;
+   *p = XYZ_NTERM;
+
+   // 64-bit divides only while the value needs them.
+   while ( v > 0xFFFFFFFF ) {
+      u32 r = (u32)(v % 100);
+      v /= 100;
+      p -= 2;
+      memcpy(p, xyz_digits2 + r * 2, 2);
+   }
+
+   u32 w = (u32)v;
+   while ( w >= 100 ) {
+      u32 r = w % 100;
+      w /= 100;
+      p -= 2;
+      memcpy(p, xyz_digits2 + r * 2, 2);
+   }
+
+   if ( w >= 10 ) {
+      p -= 2;
+      memcpy(p, xyz_digits2 + w * 2, 2);
+   } else {
+      *--p = (c8)('0' + w);
+   }
+
+   return len;
+}
+// xyz_fmt_u64()
+
+
+/**
+ * Format a signed value within a limit.
+ *
+ * @param[in]  v    value.
+ * @param[in]  max  largest magnitude.
+ * @param[out] buf  output, at least XYZ_INT_STR_DIM bytes, terminated.
+ *
+ * @return The length of the string, 0 (and an empty string) if the value
+ *         is out of range.
+ */
+static u32
+xyz_fmt_s64(s64 v, u64 max, c8 *buf)
+{
+   u64 mag = ( v < 0 ? (u64)0 - (u64)v : (u64)v );
+
+   if ( mag > max ) {
+      buf[0] = XYZ_NTERM;
+      return 0;
+   }
+
+   if ( v < 0 ) {
+      buf[0] = '-';
+      return xyz_fmt_u64(mag, buf + 1) + 1;
+   }
+
+   return xyz_fmt_u64(mag, buf);
+}
+// xyz_fmt_s64()
+
+
+/**
+ * Format an unsigned integer.
+ *
+ * @param[in]  v    value.
+ * @param[out] buf  output, at least XYZ_INT_STR_DIM bytes, terminated.
+ *
+ * @return The length of the string.
+ */
+u32
+xyz_u64_to_str(u64 v, c8 *buf)
+{
+   return xyz_fmt_u64(v, buf);
+}
+// xyz_u64_to_str()
+
+
+/**
+ * Format an unsigned integer with a separator between groups of three
+ * digits, 1,234,567.
+ *
+ * @param[in]  v    value.
+ * @param[out] buf  output, at least XYZ_INT_STR_DIM bytes, terminated.
+ * @param[in]  sep  separator character, or 0 for none.
+ *
+ * @return The length of the string.
+ */
+u32
+xyz_u64_to_str_sep(u64 v, c8 *buf, c8 sep)
+{
+   c8 digits[XYZ_INT_STR_DIM];
+   u32 nd = xyz_fmt_u64(v, digits);
+
+   if ( sep == 0 || nd <= 3 ) {
+      memcpy(buf, digits, nd + 1);
+      return nd;
+   }
+
+   // The first group takes the odd digits, every later group is three.
+   u32 head = nd % 3;
+   if ( head == 0 ) { head = 3; }
+
+   u32 len = head;
+   memcpy(buf, digits, head);
+   for ( u32 i = head ; i < nd ; i += 3 ) {
+      buf[len] = sep;
+      memcpy(buf + len + 1, digits + i, 3);
+      len += 4;
+   }
+
+   buf[len] = XYZ_NTERM;
+   return len;
+}
+// xyz_u64_to_str_sep()
+
+
+/**
+ * Format a signed integer, the full s64 range.
+ *
+ * @param[in]  v    value.
+ * @param[out] buf  output, at least XYZ_INT_STR_DIM bytes, terminated.
+ *
+ * @return The length of the string.
+ */
+u32
+xyz_s64_to_str(s64 v, c8 *buf)
+{
+   return xyz_fmt_s64(v, (u64)INT64_MAX + 1, buf);
+}
+// xyz_s64_to_str()
+
+
+/**
+ * Format an XYZ_META_T_INTEGER_S4 value.
+ *
+ * @param[in]  v    value, -9999 to 9999.
+ * @param[out] buf  output, at least XYZ_INT_STR_DIM bytes, terminated.
+ *
+ * @return The length of the string, 0 if v is out of range.
+ */
+u32
+xyz_s4_to_str(s32 v, c8 *buf)
+{
+   return xyz_fmt_s64(v, XYZ_S4_MAX, buf);
+}
+// xyz_s4_to_str()
+
+
+/**
+ * Format an XYZ_META_T_INTEGER_S9 value.
+ *
+ * @param[in]  v    value, -999999999 to 999999999.
+ * @param[out] buf  output, at least XYZ_INT_STR_DIM bytes, terminated.
+ *
+ * @return The length of the string, 0 if v is out of range.
+ */
+u32
+xyz_s9_to_str(s32 v, c8 *buf)
+{
+   return xyz_fmt_s64(v, XYZ_S9_MAX, buf);
+}
+// xyz_s9_to_str()
+
+
+/**
+ * Format an XYZ_META_T_INTEGER_S19 value.
+ *
+ * @param[in]  v    value, -INT64_MAX to INT64_MAX.
+ * @param[out] buf  output, at least XYZ_INT_STR_DIM bytes, terminated.
+ *
+ * @return The length of the string, 0 if v is out of range.
+ */
+u32
+xyz_s19_to_str(s64 v, c8 *buf)
+{
+   return xyz_fmt_s64(v, XYZ_S19_MAX, buf);
+}
+// xyz_s19_to_str()
+
+
+/**
+ * Load eight characters as a u64, the first in the low byte.
+ */
+static u64
+xyz_load8(const c8 *str)
+{
+   u64 chunk;
+   memcpy(&chunk, str, sizeof(chunk));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+   chunk = __builtin_bswap64(chunk);
+#endif
+   return chunk;
+}
+// xyz_load8()
+
+
+/**
+ * Parse text within a digit limit.
+ *
+ * @param[in]  str     text, need not be terminated.
+ * @param[in]  len     length of the text.
+ * @param[in]  digits  most significant digits allowed.
+ * @param[in]  max     largest magnitude allowed.
+ * @param[out] v       value, only set on success.
+ *
+ * @return XYZ_OK on success, otherwise XYZ_ERR.
+ */
+static s32
+xyz_parse_s64(const c8 *str, u32 len, u32 digits, u64 max, s64 *v)
+{
+   u32 i = 0;
+   u32 neg = 0;
+
+   if ( len > 0 && (str[0] == '-' || str[0] == '+') ) {
+      neg = ( str[0] == '-' ? 1 : 0 );
+      i = 1;
+   }
+
+   if ( i == len ) { return XYZ_ERR; }
+
+   // Leading zeros, keeping the last digit.
+   while ( i + 1 < len && str[i] == '0' ) { i++; }
+
+   // Too many digits is out of range whatever they are, and limits the
+   // accumulator to 19 digits, which cannot overflow a u64.
+   if ( len - i > digits ) { return XYZ_ERR; }
+
+   u64 acc = 0;
+
+   // Eight digits at a time: check all eight are '0'..'9', then combine
+   // them pairwise with three multiplies (the SWAR method of Lemire).
+   while ( len - i >= 8 )
+   {
+      u64 chunk = xyz_load8(str + i);
+      if ( (((chunk & 0xF0F0F0F0F0F0F0F0ull) |
+            (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4))) !=
+            0x3333333333333333ull ) {
+         return XYZ_ERR;
+      }
+
+      chunk -= 0x3030303030303030ull;
+      chunk = (chunk * 10) + (chunk >> 8);
+      chunk = (((chunk & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+               (((chunk >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+
+      acc = (acc * 100000000) + (u32)chunk;
+      i += 8;
+   }
+
+   for ( ; i < len ; i++ )
+   {
+      u32 d = (u32)((u8)str[i] - '0');
+      if ( d > 9 ) { return XYZ_ERR; }
+      acc = (acc * 10) + d;
+   }
+
+   if ( acc > max ) { return XYZ_ERR; }
+
+   *v = ( neg != 0 ? -(s64)acc : (s64)acc );
+   return XYZ_OK;
+}
+// xyz_parse_s64()
+
+
+/**
+ * Parse an XYZ_META_T_INTEGER_S4 value.
+ *
+ * @param[in]  str  text, an optional sign and 1 to 4 significant digits.
+ * @param[in]  len  length of the text.
+ * @param[out] v    value, only set on success.
+ *
+ * @return XYZ_OK on success, otherwise XYZ_ERR.
+ */
+s32
+xyz_str_to_s4(const c8 *str, u32 len, s32 *v)
+{
+   s64 r;
+   if ( xyz_parse_s64(str, len, 4, XYZ_S4_MAX, &r) != XYZ_OK ) { return XYZ_ERR; }
+   *v = (s32)r;
+   return XYZ_OK;
+}
+// xyz_str_to_s4()
+
+
+/**
+ * Parse an XYZ_META_T_INTEGER_S9 value.
+ *
+ * @param[in]  str  text, an optional sign and 1 to 9 significant digits.
+ * @param[in]  len  length of the text.
+ * @param[out] v    value, only set on success.
+ *
+ * @return XYZ_OK on success, otherwise XYZ_ERR.
+ */
+s32
+xyz_str_to_s9(const c8 *str, u32 len, s32 *v)
+{
+   s64 r;
+   if ( xyz_parse_s64(str, len, 9, XYZ_S9_MAX, &r) != XYZ_OK ) { return XYZ_ERR; }
+   *v = (s32)r;
+   return XYZ_OK;
+}
+// xyz_str_to_s9()
+
+
+/**
+ * Parse an XYZ_META_T_INTEGER_S19 value.
+ *
+ * @param[in]  str  text, an optional sign and 1 to 19 significant digits,
+ *                  at most INT64_MAX in magnitude.
+ * @param[in]  len  length of the text.
+ * @param[out] v    value, only set on success.
+ *
+ * @return XYZ_OK on success, otherwise XYZ_ERR.
+ */
+s32
+xyz_str_to_s19(const c8 *str, u32 len, s64 *v)
+{
+   return xyz_parse_s64(str, len, 19, XYZ_S19_MAX, v);
+}
+// xyz_str_to_s19()
+
+
+
+// ==========================================================================
+//
+// Metadata values (xyz_meta)
+//
+// ==========================================================================
+
+
+/**
+ * Test for a string type.
+ *
+ * @param[in] type  XYZ_META_T_* type.
+ *
+ * @return XYZ_TRUE if the type is a string, otherwise XYZ_FALSE.
+ */
+static u32
+xyz_meta_is_str(u16 type)
+{
+   return ( type == XYZ_META_T_ASCII_CHAR || type == XYZ_META_T_ASCII_VARCHAR ||
+            type == XYZ_META_T_UTF8_CHAR  || type == XYZ_META_T_UTF8_VARCHAR )
+          ? XYZ_TRUE : XYZ_FALSE;
+}
+// xyz_meta_is_str()
+
+
+/**
+ * Largest magnitude of an integer type.
+ *
+ * @param[in] type  XYZ_META_T_INTEGER_* type.
+ *
+ * @return The limit for the type's digits.
+ */
+static u64
+xyz_meta_int_max(u16 type)
+{
+   return ( type == XYZ_META_T_INTEGER_S4 ? XYZ_S4_MAX
+          : type == XYZ_META_T_INTEGER_S9 ? XYZ_S9_MAX : (u64)XYZ_S19_MAX );
+}
+// xyz_meta_int_max()
+
+
+/**
+ * Count the units (characters) in a string value, validating UTF-8.
+ *
+ * @param[in]  type   XYZ_META_T_* string type.
+ * @param[in]  str    string.
+ * @param[in]  len    length of the string in bytes.
+ * @param[out] units  number of units.
+ *
+ * @return XYZ_OK on success, XYZ_ERR if a UTF-8 string is not valid.
+ */
+static s32
+xyz_meta_units(u16 type, const void *str, u32 len, u32 *units)
+{
+   if ( type == XYZ_META_T_ASCII_CHAR || type == XYZ_META_T_ASCII_VARCHAR ) {
+      *units = len;
+      return XYZ_OK;
+   }
+
+   u64 n;
+   if ( xyz_utf8_units(str, len, &n) != XYZ_OK ) {
+      return XYZ_ERR;
+   }
+
+   *units = (u32)n;
+   return XYZ_OK;
+}
+// xyz_meta_units()
+
+
+/**
+ * Initialize a meta value.
+ *
+ * Strings (the ASCII and UTF8 types):
+ *
+ *   XYZ_META_P_STATIC   value is a terminated read-only string, which is
+ *                       referenced, not copied.  dim is ignored.
+ *   XYZ_META_P_DYNAMIC  value is a terminated string to copy, or NULL for
+ *                       an empty string.  dim is the size of the storage in
+ *                       bytes including the terminator, raised to fit the
+ *                       value, so 0 sizes it to the value.  Storage is
+ *                       inline when dim is at most XYZ_META_INLINE.
+ *   XYZ_META_P_FIXED    value is a writable buffer of dim bytes, which is
+ *                       referenced and set to an empty string.
+ *
+ * A UTF8 value must be well-formed UTF-8, and unit_len is its number of code
+ * points.
+ *
+ * Numbers (XYZ_META_T_INTEGER_*, XYZ_META_T_BINFP, XYZ_META_T_DECIMAL_64
+ * and XYZ_META_T_DECIMAL_128) are stored in the buf union from an s64,
+ * double, xyz_d64 or xyz_d128 pointed to by value, 0 if value is NULL.  The
+ * alloc mode and dim are ignored.  An integer must fit its type's digits,
+ * an S4 is at most 9999 in magnitude.  For an integer unit_dim is the
+ * type's digit limit and unit_len the digits in the value (without the
+ * sign), for the floating types both are the type's precision in digits.
+ *
+ * The other decimal types are not supported yet.
+ *
+ * @param[out] mt     pointer to the meta value, overwritten.
+ * @param[in]  type   XYZ_META_T_* type.
+ * @param[in]  alloc  XYZ_META_P_* allocation mode for strings.
+ * @param[in]  dim    storage dimension in bytes for strings.
+ * @param[in]  value  initial value, see above.
+ *
+ * @return XYZ_OK on success, otherwise XYZ_ERR and mt is not valid.
+ */
+s32
+xyz_meta_init(xyz_meta *mt, u16 type, u16 alloc, u32 dim, const void *value)
+{
+   s32 rtn = XYZ_ERR;
+
+   memset(mt, 0, sizeof(xyz_meta));
+
+   XYZ_BLOCK
+
+   if ( xyz_meta_is_str(type) == XYZ_TRUE )
+   {
+      u32 len = 0;
+      u32 units = 0;
+
+      if ( alloc == XYZ_META_P_STATIC )
+      {
+         if ( value == NULL ) { XYZ_BREAK }
+
+         len = (u32)strlen((const c8 *)value);
+         if ( xyz_meta_units(type, value, len, &units) != XYZ_OK ) { XYZ_BREAK }
+         dim = len + 1;
+         mt->format = XYZ_META_F_POINTER;
+         mt->buf.vp = (void *)value;
+      }
+
+      else if ( alloc == XYZ_META_P_DYNAMIC )
+      {
+         len = (value != NULL ? (u32)strlen((const c8 *)value) : 0);
+         if ( len > 0 && xyz_meta_units(type, value, len, &units) != XYZ_OK ) { XYZ_BREAK }
+         if ( dim < len + 1 ) { dim = len + 1; }
+
+         c8 *p;
+         if ( dim <= XYZ_META_INLINE ) {
+            mt->format = XYZ_META_F_INLINE;
+            p = mt->buf.inl;
+         } else {
+            p = (c8 *)xyz_malloc(dim);
+            if ( p == NULL ) { XYZ_BREAK }
+            mt->format = XYZ_META_F_POINTER;
+            mt->buf.vp = p;
+         }
+
+         if ( len > 0 ) { memcpy(p, value, len); }
+         p[len] = XYZ_NTERM;
+      }
+
+      else if ( alloc == XYZ_META_P_FIXED )
+      {
+         if ( value == NULL || dim == 0 ) { XYZ_BREAK }
+
+         mt->format = XYZ_META_F_POINTER;
+         mt->buf.vp = (void *)value;
+         ((c8 *)value)[0] = XYZ_NTERM;
+      }
+
+      else { XYZ_BREAK }
+
+      mt->type = type;
+      mt->alloc = alloc;
+      mt->byte_dim = dim;
+      mt->byte_len = len;
+      mt->unit_dim = dim - 1;
+      mt->unit_len = units;
+      rtn = XYZ_OK;
+      XYZ_BREAK
+   }
+
+   u32 bytes = sizeof(s64);
+
+   switch ( type )
+   {
+   case XYZ_META_T_INTEGER_S4 :
+   case XYZ_META_T_INTEGER_S9 :
+   case XYZ_META_T_INTEGER_S19 :
+   {
+      // The value must fit the type's digits.
+      s64 si = (value != NULL ? *(const s64 *)value : 0);
+      u64 mag = (si < 0 ? (u64)0 - (u64)si : (u64)si);
+      if ( mag > xyz_meta_int_max(type) ) { break; }
+
+      mt->format = XYZ_META_F_SINT;
+      mt->buf.si = si;
+      mt->unit_dim = (type == XYZ_META_T_INTEGER_S4 ? 4 : type == XYZ_META_T_INTEGER_S9 ? 9 : 19);
+      mt->unit_len = xyz_u64_digits(mag);
+      rtn = XYZ_OK;
+      break;
+   }
+
+   case XYZ_META_T_BINFP :
+
+      mt->format = XYZ_META_F_BINFP;
+      mt->buf.bfp = (value != NULL ? *(const double *)value : 0.0);
+      mt->unit_dim = 16;
+      rtn = XYZ_OK;
+      break;
+
+   case XYZ_META_T_DECIMAL_64 :
+
+      mt->format = XYZ_META_F_DECFP;
+      mt->buf.d64 = (value != NULL ? *(const xyz_d64 *)value : xyz_d64_make(0, 0));
+      mt->unit_dim = XYZ_D64_DIGITS;
+      bytes = sizeof(xyz_d64);
+      rtn = XYZ_OK;
+      break;
+
+   case XYZ_META_T_DECIMAL_128 :
+
+      mt->format = XYZ_META_F_DECFP;
+      mt->buf.d128 = (value != NULL ? *(const xyz_d128 *)value : xyz_d128_make(0, 0));
+      mt->unit_dim = XYZ_D128_DIGITS;
+      bytes = sizeof(xyz_d128);
+      rtn = XYZ_OK;
+      break;
+
+   default :
+      break;
+   }
+
+   if ( rtn == XYZ_OK )
+   {
+      mt->type = type;
+      mt->byte_dim = bytes;
+      mt->byte_len = bytes;
+      if ( mt->format != XYZ_META_F_SINT ) { mt->unit_len = mt->unit_dim; }
+   }
+
+   XYZ_END
+
+   if ( rtn != XYZ_OK ) { memset(mt, 0, sizeof(xyz_meta)); }
+
+   return rtn;
+}
+// xyz_meta_init()
+
+
+/**
+ * Copy a meta value.
+ *
+ * A STATIC string and numbers are copied as is.  Into a FIXED destination
+ * the string is copied into the destination's buffer, and must fit.  Any
+ * other string becomes a DYNAMIC copy with the same dimension (inline when
+ * it fits), and the destination's old value is freed.
+ *
+ * @param[in,out] dst  initialized (or zeroed) destination meta value.
+ * @param[in]     src  source meta value.
+ *
+ * @return XYZ_OK on success, otherwise XYZ_ERR and dst is unchanged.
+ */
+s32
+xyz_meta_copy(xyz_meta *dst, const xyz_meta *src)
+{
+   if ( dst == src ) { return XYZ_OK; }
+
+   u32 src_str = xyz_meta_is_str(src->type);
+
+   if ( dst->alloc == XYZ_META_P_FIXED && dst->format == XYZ_META_F_POINTER &&
+        xyz_meta_is_str(dst->type) == XYZ_TRUE && src_str == XYZ_TRUE )
+   {
+      if ( src->byte_len >= dst->byte_dim ) { return XYZ_ERR; }
+
+      memcpy(dst->buf.vp, xyz_meta_ptr(src), src->byte_len);
+      ((c8 *)dst->buf.vp)[src->byte_len] = XYZ_NTERM;
+      dst->type = src->type;
+      dst->byte_len = src->byte_len;
+      dst->unit_dim = dst->byte_dim - 1;
+      dst->unit_len = src->unit_len;
+      return XYZ_OK;
+   }
+
+   if ( src_str == XYZ_FALSE || src->alloc == XYZ_META_P_STATIC )
+   {
+      xyz_meta_free(dst);
+      *dst = *src;
+      return XYZ_OK;
+   }
+
+   xyz_meta tmp;
+   if ( xyz_meta_init(&tmp, src->type, XYZ_META_P_DYNAMIC, src->byte_dim,
+         xyz_meta_ptr(src)) != XYZ_OK ) {
+      return XYZ_ERR;
+   }
+
+   xyz_meta_free(dst);
+   xyz_meta_move(dst, &tmp);
+   return XYZ_OK;
+}
+// xyz_meta_copy()
+
+
+/**
+ * Move a meta value, the source is left empty (not valid).
+ *
+ * @param[in,out] dst  initialized (or zeroed) destination, its old value
+ *                     is freed.
+ * @param[in,out] src  source meta value.
+ */
+void
+xyz_meta_move(xyz_meta *dst, xyz_meta *src)
+{
+   if ( dst == src ) { return; }
+
+   xyz_meta_free(dst);
+   *dst = *src;
+   memset(src, 0, sizeof(xyz_meta));
+}
+// xyz_meta_move()
+
+
+/**
+ * Free a meta value, only DYNAMIC heap storage is released.  The value is
+ * left empty (not valid).
+ *
+ * @param[in,out] mt  initialized (or zeroed) meta value.
+ */
+void
+xyz_meta_free(xyz_meta *mt)
+{
+   if ( mt->alloc == XYZ_META_P_DYNAMIC && mt->format == XYZ_META_F_POINTER &&
+        mt->buf.vp != NULL ) {
+      xyz_free(mt->buf.vp);
+   }
+
+   memset(mt, 0, sizeof(xyz_meta));
+}
+// xyz_meta_free()
+
+
+/**
+ * Initialize an integer meta value from text, checked against the type's
+ * digit limit, see xyz_str_to_s19().
+ *
+ * @param[out] mt    pointer to the meta value, overwritten.
+ * @param[in]  type  XYZ_META_T_INTEGER_* type.
+ * @param[in]  str   text, an optional sign and digits.
+ * @param[in]  len   length of the text.
+ *
+ * @return XYZ_OK on success, otherwise XYZ_ERR and mt is not valid.
+ */
+s32
+xyz_meta_int_parse(xyz_meta *mt, u16 type, const c8 *str, u32 len)
+{
+   s64 si = 0;
+
+   if ( type != XYZ_META_T_INTEGER_S4 && type != XYZ_META_T_INTEGER_S9 &&
+        type != XYZ_META_T_INTEGER_S19 ) {
+      memset(mt, 0, sizeof(xyz_meta));
+      return XYZ_ERR;
+   }
+
+   u32 digits = ( type == XYZ_META_T_INTEGER_S4 ? 4 : type == XYZ_META_T_INTEGER_S9 ? 9 : 19 );
+   if ( xyz_parse_s64(str, len, digits, xyz_meta_int_max(type), &si) != XYZ_OK ) {
+      memset(mt, 0, sizeof(xyz_meta));
+      return XYZ_ERR;
+   }
+
+   return xyz_meta_init(mt, type, XYZ_META_P_STATIC, 0, &si);
+}
+// xyz_meta_int_parse()
+
+
+/**
+ * Format an integer meta value.
+ *
+ * @param[in]  mt   pointer to an XYZ_META_T_INTEGER_* meta value.
+ * @param[out] buf  output, at least XYZ_INT_STR_DIM bytes, terminated.
+ *
+ * @return The length of the string, 0 (and an empty string) if mt is not
+ *         an integer.
+ */
+u32
+xyz_meta_int_format(const xyz_meta *mt, c8 *buf)
+{
+   if ( mt->format != XYZ_META_F_SINT ) {
+      buf[0] = XYZ_NTERM;
+      return 0;
+   }
+
+   return xyz_fmt_s64(mt->buf.si, xyz_meta_int_max(mt->type), buf);
+}
+// xyz_meta_int_format()
 
 
 /*
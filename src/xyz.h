@@ -12,6 +12,10 @@
 #include <stdlib.h>     // malloc, calloc, realloc, free
 #include <stdint.h>		// uintXX_t, intXX_t, UINTXX_MAX, INTXX_MAX, etc.
 
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>     // _Interlocked*, _ReadWriteBarrier, _mm_pause, __ldar64, __stlr64
+#endif
+
 // Avoid C++ name-mangling for C functions.
 #ifdef __cplusplus
 extern "C" {
@@ -84,14 +88,696 @@ extern "C" {
 #endif
 
 
-/// TODO placeholder, replace with allocator wrapper functions.
+/// Cache line size used to keep data written by different threads apart.
+#define XYZ_CACHE_LINE 64
+
+/// Minimum alignment of a structure member or variable.
+#if defined(_MSC_VER)
+#define XYZ_ALIGN(n) __declspec(align(n))
+#else
+#define XYZ_ALIGN(n) __attribute__((aligned(n)))
+#endif
+
+/// Inline helper functions defined in this header.
+#if defined(_MSC_VER) && !defined(__cplusplus)
+#define XYZ_INLINE static __inline
+#else
+#define XYZ_INLINE static inline
+#endif
+
+
+// ==========================================================================
+//
+// Atomic access helpers
+//
+// The C11 <stdatomic.h> and C++ <atomic> types cannot be shared by the C and
+// C++ code that both include this header, and MSVC does not provide the C11
+// header at all.  These helpers work on plain aligned u32 and u64 fields so
+// the structures stay the same in both languages.
+//
+// acq = acquire, rel = release, rlx = relaxed.
+//
+// ==========================================================================
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+// The read-modify-write operations are the _Interlocked* intrinsics, which
+// are full barriers on every MSVC target.
+
+XYZ_INLINE u32 xyz_atomic_add_u32(u32 *p, u32 v) { return (u32)_InterlockedExchangeAdd((volatile long *)p, (long)v); }
+XYZ_INLINE u32 xyz_atomic_cas_u32(u32 *p, u32 expected, u32 desired) {
+   return (u32)_InterlockedCompareExchange((volatile long *)p, (long)desired, (long)expected) == expected ? XYZ_TRUE : XYZ_FALSE; }
+XYZ_INLINE u64 xyz_atomic_add_u64(u64 *p, u64 v) { return (u64)_InterlockedExchangeAdd64((volatile __int64 *)p, (__int64)v); }
+XYZ_INLINE u32 xyz_atomic_cas_u64(u64 *p, u64 expected, u64 desired) {
+   return (u64)_InterlockedCompareExchange64((volatile __int64 *)p, (__int64)desired, (__int64)expected) == expected ? XYZ_TRUE : XYZ_FALSE; }
+
+#if defined(_M_X64) || defined(_M_IX86)
+
+// x86/x64 loads have acquire and stores have release semantics in hardware,
+// so only the compiler needs to be kept from reordering the access.
+
+XYZ_INLINE u32 xyz_atomic_ld_rlx_u32(const u32 *p) { return *(volatile const u32 *)p; }
+XYZ_INLINE u32 xyz_atomic_ld_acq_u32(const u32 *p) { u32 v = *(volatile const u32 *)p; _ReadWriteBarrier(); return v; }
+XYZ_INLINE void xyz_atomic_st_rlx_u32(u32 *p, u32 v) { *(volatile u32 *)p = v; }
+XYZ_INLINE void xyz_atomic_st_rel_u32(u32 *p, u32 v) { _ReadWriteBarrier(); *(volatile u32 *)p = v; }
+
+#if defined(_M_X64)
+XYZ_INLINE u64 xyz_atomic_ld_rlx_u64(const u64 *p) { return *(volatile const u64 *)p; }
+XYZ_INLINE u64 xyz_atomic_ld_acq_u64(const u64 *p) { u64 v = *(volatile const u64 *)p; _ReadWriteBarrier(); return v; }
+XYZ_INLINE void xyz_atomic_st_rlx_u64(u64 *p, u64 v) { *(volatile u64 *)p = v; }
+XYZ_INLINE void xyz_atomic_st_rel_u64(u64 *p, u64 v) { _ReadWriteBarrier(); *(volatile u64 *)p = v; }
+#else
+// A plain u64 access is two 32-bit accesses on 32-bit x86 and can tear, so
+// go through the locked 64-bit compare-exchange (cmpxchg8b).
+XYZ_INLINE u64 xyz_atomic_ld_rlx_u64(const u64 *p) { return (u64)_InterlockedCompareExchange64((volatile __int64 *)p, 0, 0); }
+XYZ_INLINE u64 xyz_atomic_ld_acq_u64(const u64 *p) { return (u64)_InterlockedCompareExchange64((volatile __int64 *)p, 0, 0); }
+XYZ_INLINE void xyz_atomic_st_rlx_u64(u64 *p, u64 v) { _InterlockedExchange64((volatile __int64 *)p, (__int64)v); }
+XYZ_INLINE void xyz_atomic_st_rel_u64(u64 *p, u64 v) { _InterlockedExchange64((volatile __int64 *)p, (__int64)v); }
+#endif
+
+XYZ_INLINE void xyz_atomic_fence(void) { _mm_mfence(); }
+XYZ_INLINE void xyz_cpu_relax(void) { _mm_pause(); }
+
+#elif defined(_M_ARM64)
+
+// ARM64 is weakly ordered, acquire and release need the ldar/stlr
+// instructions.  __iso_volatile_* are plain accesses without the barriers
+// /volatile:ms would add.
+
+XYZ_INLINE u32 xyz_atomic_ld_rlx_u32(const u32 *p) { return (u32)__iso_volatile_load32((const volatile __int32 *)p); }
+XYZ_INLINE u32 xyz_atomic_ld_acq_u32(const u32 *p) { return (u32)__ldar32((volatile unsigned __int32 *)p); }
+XYZ_INLINE void xyz_atomic_st_rlx_u32(u32 *p, u32 v) { __iso_volatile_store32((volatile __int32 *)p, (__int32)v); }
+XYZ_INLINE void xyz_atomic_st_rel_u32(u32 *p, u32 v) { __stlr32((volatile unsigned __int32 *)p, (unsigned __int32)v); }
+
+XYZ_INLINE u64 xyz_atomic_ld_rlx_u64(const u64 *p) { return (u64)__iso_volatile_load64((const volatile __int64 *)p); }
+XYZ_INLINE u64 xyz_atomic_ld_acq_u64(const u64 *p) { return (u64)__ldar64((volatile unsigned __int64 *)p); }
+XYZ_INLINE void xyz_atomic_st_rlx_u64(u64 *p, u64 v) { __iso_volatile_store64((volatile __int64 *)p, (__int64)v); }
+XYZ_INLINE void xyz_atomic_st_rel_u64(u64 *p, u64 v) { __stlr64((volatile unsigned __int64 *)p, (unsigned __int64)v); }
+
+XYZ_INLINE void xyz_atomic_fence(void) { __dmb(_ARM64_BARRIER_ISH); }
+XYZ_INLINE void xyz_cpu_relax(void) { __yield(); }
+
+#else
+#error "xyz atomic helpers: unsupported MSVC target, need x86, x64 or ARM64."
+#endif
+
+#else
+
+XYZ_INLINE u32 xyz_atomic_ld_rlx_u32(const u32 *p) { return __atomic_load_n(p, __ATOMIC_RELAXED); }
+XYZ_INLINE u32 xyz_atomic_ld_acq_u32(const u32 *p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+XYZ_INLINE void xyz_atomic_st_rlx_u32(u32 *p, u32 v) { __atomic_store_n(p, v, __ATOMIC_RELAXED); }
+XYZ_INLINE void xyz_atomic_st_rel_u32(u32 *p, u32 v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+XYZ_INLINE u32 xyz_atomic_add_u32(u32 *p, u32 v) { return __atomic_fetch_add(p, v, __ATOMIC_ACQ_REL); }
+XYZ_INLINE u32 xyz_atomic_cas_u32(u32 *p, u32 expected, u32 desired) {
+   return __atomic_compare_exchange_n(p, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ? XYZ_TRUE : XYZ_FALSE; }
+
+XYZ_INLINE u64 xyz_atomic_ld_rlx_u64(const u64 *p) { return __atomic_load_n(p, __ATOMIC_RELAXED); }
+XYZ_INLINE u64 xyz_atomic_ld_acq_u64(const u64 *p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+XYZ_INLINE void xyz_atomic_st_rlx_u64(u64 *p, u64 v) { __atomic_store_n(p, v, __ATOMIC_RELAXED); }
+XYZ_INLINE void xyz_atomic_st_rel_u64(u64 *p, u64 v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+XYZ_INLINE u64 xyz_atomic_add_u64(u64 *p, u64 v) { return __atomic_fetch_add(p, v, __ATOMIC_ACQ_REL); }
+XYZ_INLINE u32 xyz_atomic_cas_u64(u64 *p, u64 expected, u64 desired) {
+   return __atomic_compare_exchange_n(p, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ? XYZ_TRUE : XYZ_FALSE; }
+
+XYZ_INLINE void xyz_atomic_fence(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+
+#if defined(__x86_64__) || defined(__i386__)
+XYZ_INLINE void xyz_cpu_relax(void) { __builtin_ia32_pause(); }
+#elif defined(__aarch64__) || defined(__arm__)
+XYZ_INLINE void xyz_cpu_relax(void) { __asm__ __volatile__("yield"); }
+#else
+XYZ_INLINE void xyz_cpu_relax(void) { }
+#endif
+
+#endif
+
+
+// ==========================================================================
+//
+// Heap allocation and optional per-call-site tracking
+//
+// Normally the xyz_malloc family are plain libc calls with no overhead.
+// Build with XYZ_MEM_TRACK defined (the CMake XYZ_MEM_TRACK option) to
+// record, for every call site (XYZ_CFL), the number of allocations and
+// frees, bytes allocated, live allocations and bytes, and the peak live
+// bytes.  Each tracked allocation has a small header and takes a spin lock,
+// so tracking is for diagnostics, not release builds.
+//
+// xyz_aligned_malloc() returns memory aligned to any power of two (for SIMD
+// loads or a cache line, XYZ_CACHE_LINE), and must be released with
+// xyz_aligned_free(), never xyz_free().  Tracked aligned allocations also
+// record the padding spent on alignment.
+//
+// ==========================================================================
+
+#if defined(XYZ_MEM_TRACK)
+
+/// Maximum number of call sites tracked, any more share the last entry.
+#define XYZ_MEM_SITE_DIM 512
+
+/// Allocation statistics for one call site (or the total).
+typedef struct unused_tag_xyz_mem_site {
+   const c8 *file;         ///< Source file name, NULL for an unused entry.
+   u32   line;             ///< Source line.
+   u32   reserved;         ///< Reserved for future use.
+   u64   allocs;           ///< Number of allocations.
+   u64   frees;            ///< Number of frees.
+   u64   bytes;            ///< Total bytes allocated.
+   u64   live;             ///< Allocations not freed yet.
+   u64   live_bytes;       ///< Bytes not freed yet.
+   u64   peak_bytes;       ///< Highest live_bytes.
+   u64   waste;            ///< Total bytes of alignment padding.
+} xyz_mem_site;
+
+void *xyz_mem_malloc(size_t sz, const c8 *file, u32 line);
+void *xyz_mem_calloc(size_t num, size_t sz, const c8 *file, u32 line);
+void *xyz_mem_realloc(void *ptr, size_t sz, const c8 *file, u32 line);
+void xyz_mem_free(void *ptr);
+void *xyz_mem_aligned_malloc(size_t sz, size_t align, const c8 *file, u32 line);
+void xyz_mem_aligned_free(void *ptr);
+u32 xyz_mem_snapshot(xyz_mem_site *sites, u32 dim, xyz_mem_site *total);
+void xyz_mem_dump(void);
+
+#define xyz_malloc(sz) xyz_mem_malloc((sz), XYZ_CFL)
+#define xyz_calloc(num,sz) xyz_mem_calloc((num), (sz), XYZ_CFL)
+#define xyz_realloc(ptr,sz) xyz_mem_realloc((ptr), (sz), XYZ_CFL)
+#define xyz_free(ptr) xyz_mem_free(ptr)
+#define xyz_aligned_malloc(sz,align) xyz_mem_aligned_malloc((sz), (align), XYZ_CFL)
+#define xyz_aligned_free(ptr) xyz_mem_aligned_free(ptr)
+
+#else
+
 #define xyz_malloc(sz) malloc(sz)
 #define xyz_calloc(num,sz) calloc(num,sz)
 #define xyz_realloc(ptr,sz) realloc(ptr,sz)
 #define xyz_free(ptr) free(ptr)
 
-// TODO comments for meta, and initializer.
-// TODO finish the currently incomplete metadata system.
+void *xyz_aligned_malloc(size_t sz, size_t align);
+void xyz_aligned_free(void *ptr);
+
+#endif
+
+
+
+// ==========================================================================
+//
+// Resident virtual memory for large long-lived buffers
+//
+// A heap buffer is only backed by memory when each page is first touched,
+// so the first burst of use through a large buffer takes a page fault per
+// page.  xyz_vmem_alloc() maps the region directly from the OS and can
+// pre-fault every page, back the region with huge pages (fewer TLB misses),
+// and lock it in memory so it is never paged out.
+//
+// Every option is a request, the flags actually granted are returned, and
+// a refused option never fails the allocation.  Linux uses mmap with
+// MAP_POPULATE, madvise(MADV_HUGEPAGE) or MAP_HUGETLB, and mlock.  Windows
+// uses VirtualAlloc with MEM_LARGE_PAGES (needs the "Lock pages in memory"
+// privilege), touches each page to pre-fault, and VirtualLock.
+//
+// ==========================================================================
+
+
+/// Pre-fault every page when the region is allocated.
+#define XYZ_VMEM_F_POPULATE 0x01
+
+/// Transparent huge pages.  On Windows the same as XYZ_VMEM_F_HUGETLB.
+#define XYZ_VMEM_F_HUGE 0x02
+
+/// Explicit huge pages from the reserved pool (Linux MAP_HUGETLB, Windows
+/// large pages).  Falls back to normal pages if none are available.
+#define XYZ_VMEM_F_HUGETLB 0x04
+
+/// Lock the region in memory, subject to the process lock limit.
+#define XYZ_VMEM_F_LOCK 0x08
+
+/// Returned by xyz_vmem_alloc() for every region it maps.
+#define XYZ_VMEM_F_MAPPED 0x80
+
+
+void *xyz_vmem_alloc(u64 *dim, u32 *flags);
+u32 xyz_vmem_resident(void *buf, u64 dim, u32 flags);
+void xyz_vmem_free(void *buf, u64 dim);
+
+
+
+// ==========================================================================
+//
+// Arena allocator
+//
+// One region is reserved up front, and allocations are carved from it by
+// bumping an offset, so an allocation is a few instructions with no lock and
+// no per-allocation header.  Individual allocations are never freed, the
+// whole arena is released at once with xyz_arena_reset() (keep the region)
+// or xyz_arena_free() (release the region).  xyz_arena_init_vmem() backs the
+// region with xyz_vmem_alloc() instead of the heap.  xyz_arena_mark() and
+// xyz_arena_rewind() release everything allocated after a point, like a
+// stack.  Allocations are XYZ_ARENA_ALIGN aligned, xyz_arena_alloc_aligned()
+// skips ahead to a larger power of two and counts the bytes skipped.
+//
+// Not thread-safe, an arena belongs to one thread at a time.
+//
+// ==========================================================================
+
+
+/// Alignment of every arena allocation.
+#define XYZ_ARENA_ALIGN 16
+
+/// Size to reserve for an allocation of sz bytes, including alignment.
+#define XYZ_ARENA_SIZE(sz) ((((u64)(sz)) + (XYZ_ARENA_ALIGN - 1)) & ~(u64)(XYZ_ARENA_ALIGN - 1))
+
+
+/// Arena structure.
+typedef struct unused_tag_xyz_arena {
+   u8   *base;    ///< Start of the region.
+   u64   dim;     ///< Size of the region in bytes.
+   u64   used;    ///< Bytes allocated, the bump offset.
+   u64   peak;    ///< Highest used since the arena was initialized.
+   u64   allocs;  ///< Number of allocations since the last reset.
+   u64   fails;   ///< Number of allocations that did not fit.
+   u64   waste;   ///< Bytes skipped for alignment since the last reset.
+   u32   vmem;    ///< XYZ_VMEM_F_* flags granted, 0 for a heap region.
+} xyz_arena;
+
+
+u32 xyz_arena_init(xyz_arena *ar, u64 dim);
+u32 xyz_arena_init_vmem(xyz_arena *ar, u64 dim, u32 flags);
+void *xyz_arena_alloc(xyz_arena *ar, u64 sz);
+void *xyz_arena_alloc_aligned(xyz_arena *ar, u64 sz, u64 align);
+void *xyz_arena_calloc(xyz_arena *ar, u64 num, u64 sz);
+u64 xyz_arena_mark(xyz_arena *ar);
+void xyz_arena_rewind(xyz_arena *ar, u64 mark);
+void xyz_arena_reset(xyz_arena *ar);
+void xyz_arena_free(xyz_arena *ar);
+
+
+
+// ==========================================================================
+//
+// Fixed-size block pool allocator
+//
+// Blocks of one size are carved from a caller-owned region.  A free block
+// holds the pointer to the next free block (an intrusive free list), so
+// there is no per-block overhead.
+//
+// Each thread keeps a small magazine (cache) of free blocks, so most
+// allocations and frees touch only the thread's own magazine.  When a
+// magazine is empty it is refilled with a batch from the shared depot, and
+// when it is full half of it is flushed back, so the depot lock is taken
+// once per batch rather than once per block.  A block may be freed by any
+// thread, it just goes to that thread's magazine.
+//
+// Declare the magazine thread local, one per thread per pool, and flush it
+// before the thread exits:
+//
+//    static XYZ_THREAD_LOCAL xyz_pool_mag mag;
+//    void *p = xyz_pool_alloc(&pool, &mag);
+//    xyz_pool_free(&pool, &mag, p);
+//    xyz_pool_mag_flush(&pool, &mag);   // at thread exit
+//
+// A NULL magazine goes straight to the depot.
+//
+// Blocks are XYZ_POOL_ALIGN aligned, xyz_pool_init_aligned() aligns the
+// first block and rounds the block size to a larger power of two, so every
+// block starts on, for example, its own cache line.
+//
+// ==========================================================================
+
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define XYZ_THREAD_LOCAL __declspec(thread)
+#else
+#define XYZ_THREAD_LOCAL __thread
+#endif
+
+/// Number of blocks a magazine can cache.
+#define XYZ_POOL_MAG 32
+
+/// Alignment of every pool block.
+#define XYZ_POOL_ALIGN 16
+
+/// Size of one block of sz bytes aligned to align, a power of two.
+#define XYZ_POOL_BLOCK(sz, align) ((((u64)(sz) < sizeof(void *) ? sizeof(void *) : (u64)(sz)) + ((u64)(align) - 1)) & ~(u64)((align) - 1))
+
+/// Size of a region for count blocks of sz bytes.
+#define XYZ_POOL_SIZE(sz, count) ((u64)(count) * XYZ_POOL_BLOCK(sz, XYZ_POOL_ALIGN))
+
+/// Size of a region for count blocks of sz bytes aligned to align, including
+/// the worst case padding to align the first block in an XYZ_POOL_ALIGN
+/// aligned region.
+#define XYZ_POOL_SIZE_ALIGNED(sz, count, align) (((u64)(count) * XYZ_POOL_BLOCK(sz, align)) + ((u64)(align) - XYZ_POOL_ALIGN))
+
+
+/// Pool structure.
+typedef struct unused_tag_xyz_pool {
+   u64   bsize;      ///< Block size, rounded up to the block alignment.
+   u64   count;      ///< Total number of blocks in the region.
+   u8   *base;       ///< Caller-owned region.
+   u32   lock;       ///< Depot spin lock.
+   u32   reserved;   ///< Reserved for future use.
+   void *depot;      ///< Depot free list head.
+   u64   depot_len;  ///< Blocks in the depot free list.
+   u64   carved;     ///< Blocks carved from the region so far.
+   u64   waste;      ///< Bytes of the region lost to alignment, the padding
+                     ///< before the first block and rounding of every block.
+
+   // Statistics, updated under the depot lock, so they are per batch and
+   // may lag by up to a magazine per thread.
+   struct {
+   u64   out;        ///< Blocks outside the depot (in use or cached by a thread).
+   u64   peak;       ///< Highest out, the number of blocks the pool needs.
+   u64   allocs;     ///< Total allocations.
+   u64   frees;      ///< Total frees.
+   u64   fails;      ///< Allocations that failed, the pool was exhausted.
+   u64   refills;    ///< Magazine refills from the depot.
+   u64   flushes;    ///< Magazine flushes to the depot.
+   u64   contended;  ///< Times the depot lock was busy.
+   } stats;          ///< Statistics.
+} xyz_pool;
+
+/// Per-thread pool magazine.
+typedef struct unused_tag_xyz_pool_mag {
+   u32   len;                   ///< Number of cached blocks.
+   u32   reserved;              ///< Reserved for future use.
+   void *blk[XYZ_POOL_MAG];     ///< Cached free blocks.
+   u64   allocs;                ///< Allocations not yet added to the pool stats.
+   u64   frees;                 ///< Frees not yet added to the pool stats.
+} xyz_pool_mag;
+
+
+u32 xyz_pool_init(xyz_pool *pool, void *mem, u64 memdim, u64 bsize);
+u32 xyz_pool_init_aligned(xyz_pool *pool, void *mem, u64 memdim, u64 bsize, u64 align);
+void *xyz_pool_alloc(xyz_pool *pool, xyz_pool_mag *mag);
+void xyz_pool_free(xyz_pool *pool, xyz_pool_mag *mag, void *blk);
+void xyz_pool_mag_flush(xyz_pool *pool, xyz_pool_mag *mag);
+
+
+
+// ==========================================================================
+//
+// Per-thread heap
+//
+// A heap owned by one thread, so allocation never contends with any other
+// thread.  Blocks are carved from the thread's own arena in power-of-two
+// size classes from 16 to XYZ_THEAP_MAX bytes, and freed blocks go on a
+// free list per class for reuse.  Larger requests, and requests after the
+// arena is used up, go to xyz_malloc().
+//
+// Every block has a 16 byte header naming its owner, so xyz_theap_free()
+// works from any thread.  A block freed by its owner goes straight back on
+// the owner's free list.  A block freed by any other thread is pushed on
+// the owner's deferred return list (a lock-free stack), and the owner takes
+// the whole list back the next time a size class runs dry, or with
+// xyz_theap_collect().
+//
+// The owning thread calls xyz_theap_init() when it starts, which also makes
+// the heap the thread's current heap (xyz_theap_current()), and
+// xyz_theap_fini() before it ends.  Every block should be freed by then.
+//
+// The statistics are written by the owner only and can be read from any
+// thread for display.  Frees that do not return to the owner's lists, by
+// other threads and of large or spilled blocks, are counted atomically
+// outside the statistics.
+//
+// ==========================================================================
+
+
+/// Number of size classes, 16 bytes doubling to XYZ_THEAP_MAX.
+#define XYZ_THEAP_CLASSES 9
+
+/// Largest block served from the thread's arena.
+#define XYZ_THEAP_MAX 4096
+
+
+/// Per-thread heap structure.
+typedef struct unused_tag_xyz_theap {
+   const c8  *name;                       ///< Name for diagnostics.
+   xyz_arena  arena;                      ///< Region the blocks are carved from.
+   void      *free[XYZ_THEAP_CLASSES];    ///< Free list per size class, owner only.
+
+   u8    pad_remote[XYZ_CACHE_LINE];    ///< Keeps remote off the owner's lines.
+   u64   remote;        ///< Deferred return list head (a block address), any thread.
+   u64   remote_frees;  ///< Frees by other threads, deferred to the owner.
+   u64   direct_frees;  ///< Frees of large and spilled blocks, any thread.
+   u8    pad_stats[XYZ_CACHE_LINE];     ///< Keeps remote off the statistics.
+
+   struct {
+   u64   allocs;        ///< Total allocations.
+   u64   frees;         ///< Frees by the owner.
+   u64   collected;     ///< Deferred blocks taken back by the owner.
+   u64   large;         ///< Allocations larger than XYZ_THEAP_MAX.
+   u64   spills;        ///< Allocations that did not fit in the arena.
+   u64   live_bytes;    ///< Bytes in blocks not freed yet (class sizes).
+   u64   peak_bytes;    ///< Highest live_bytes.
+   } stats;             ///< Statistics.
+} xyz_theap;
+
+
+u32 xyz_theap_init(xyz_theap *th, const c8 *name, u64 dim);
+void xyz_theap_fini(xyz_theap *th);
+xyz_theap *xyz_theap_current(void);
+void *xyz_theap_alloc(xyz_theap *th, size_t sz);
+void xyz_theap_free(void *ptr);
+u64 xyz_theap_collect(xyz_theap *th);
+
+
+
+// ==========================================================================
+//
+// Unsigned 128-bit integer helpers
+//
+// Portable, a struct of two u64 halves.  GCC and Clang use unsigned
+// __int128 for the multiply, MSVC on x64 uses _umul128, anything else
+// splits into 32-bit halves.
+//
+// ==========================================================================
+
+
+/// Unsigned 128-bit integer.
+typedef struct unused_tag_xyz_u128 {
+   u64   lo;      ///< Low 64 bits.
+   u64   hi;      ///< High 64 bits.
+} xyz_u128;
+
+
+/// Make a u128 from a u64.
+XYZ_INLINE xyz_u128 xyz_u128_from_u64(u64 v) { xyz_u128 r; r.lo = v; r.hi = 0; return r; }
+
+/// a + b, modulo 2^128.
+XYZ_INLINE xyz_u128 xyz_u128_add(xyz_u128 a, xyz_u128 b) {
+   xyz_u128 r; r.lo = a.lo + b.lo; r.hi = a.hi + b.hi + (r.lo < a.lo ? 1 : 0); return r; }
+
+/// a - b, modulo 2^128.
+XYZ_INLINE xyz_u128 xyz_u128_sub(xyz_u128 a, xyz_u128 b) {
+   xyz_u128 r; r.lo = a.lo - b.lo; r.hi = a.hi - b.hi - (a.lo < b.lo ? 1 : 0); return r; }
+
+/// Compare, -1 if a < b, 0 if a == b, 1 if a > b.
+XYZ_INLINE s32 xyz_u128_cmp(xyz_u128 a, xyz_u128 b) {
+   return ( a.hi != b.hi ? (a.hi < b.hi ? -1 : 1) : a.lo != b.lo ? (a.lo < b.lo ? -1 : 1) : 0 ); }
+
+/// Full 128-bit product of two u64.
+XYZ_INLINE xyz_u128 xyz_u128_mul64(u64 a, u64 b) {
+   xyz_u128 r;
+#if defined(__SIZEOF_INT128__)
+   unsigned __int128 p = (unsigned __int128)a * b;
+   r.lo = (u64)p; r.hi = (u64)(p >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+   r.lo = _umul128(a, b, &r.hi);
+#else
+   u64 al = a & 0xFFFFFFFF, ah = a >> 32, bl = b & 0xFFFFFFFF, bh = b >> 32;
+   u64 ll = al * bl, lh = al * bh, hl = ah * bl, hh = ah * bh;
+   u64 mid = (ll >> 32) + (lh & 0xFFFFFFFF) + (hl & 0xFFFFFFFF);
+   r.lo = (mid << 32) | (ll & 0xFFFFFFFF);
+   r.hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+   return r; }
+
+/// a * b, modulo 2^128.
+XYZ_INLINE xyz_u128 xyz_u128_mul_u64(xyz_u128 a, u64 b) {
+   xyz_u128 r = xyz_u128_mul64(a.lo, b); r.hi += a.hi * b; return r; }
+
+u64 xyz_u128_divmod_u64(xyz_u128 *n, u64 d);
+u32 xyz_u128_bits(xyz_u128 a);
+
+
+
+// ==========================================================================
+//
+// Decimal floating point (IEEE 754 decimal64 and decimal128, BID encoding)
+//
+// Exact decimal arithmetic for values like money, where binary floating
+// point cannot represent 0.10 exactly.  A value is an integer coefficient
+// and a power of ten exponent, packed in the binary integer decimal (BID)
+// encoding, so a value can be stored and exchanged as a u64 (or two).
+//
+//   decimal64:   16 digits, exponent -398 .. 369 (of the coefficient).
+//   decimal128:  34 digits, exponent -6176 .. 6111.
+//
+// Results are rounded half-even to the precision.  Overflow gives infinity,
+// invalid operations (inf - inf, 0 * inf) give NaN, and NaN compares as
+// unordered.  Values keep their exponent (scale), 1.50 + 1.25 = 2.75 and
+// 1.5 + 1.25 = 2.75 but 1.50 + 1.50 = 3.00.
+//
+// When both operands have the same exponent (the common case for money),
+// add, subtract and compare are a single integer operation on the
+// coefficients, and a multiply whose product fits is a single integer
+// multiply.
+//
+// ==========================================================================
+
+
+/// IEEE 754 decimal64, BID encoding.
+typedef u64 xyz_d64;
+
+/// IEEE 754 decimal128, BID encoding.
+typedef xyz_u128 xyz_d128;
+
+
+#define XYZ_D64_DIGITS   16        ///< decimal64 precision in digits.
+#define XYZ_D64_EMIN     (-398)    ///< decimal64 smallest coefficient exponent.
+#define XYZ_D64_EMAX     369       ///< decimal64 largest coefficient exponent.
+#define XYZ_D128_DIGITS  34        ///< decimal128 precision in digits.
+#define XYZ_D128_EMIN    (-6176)   ///< decimal128 smallest coefficient exponent.
+#define XYZ_D128_EMAX    6111      ///< decimal128 largest coefficient exponent.
+
+#define XYZ_D64_INF  ((xyz_d64)0x7800000000000000ull)  ///< decimal64 +infinity.
+#define XYZ_D64_NAN  ((xyz_d64)0x7C00000000000000ull)  ///< decimal64 quiet NaN.
+
+/// Compare result when either value is NaN.
+#define XYZ_DEC_UNORDERED 2
+
+/// Buffer size for any decimal value as a string, including the terminator.
+#define XYZ_DEC_STR_DIM 64
+
+
+xyz_d64 xyz_d64_make(s64 coef, s32 exp);
+xyz_d64 xyz_d64_add(xyz_d64 a, xyz_d64 b);
+xyz_d64 xyz_d64_sub(xyz_d64 a, xyz_d64 b);
+xyz_d64 xyz_d64_mul(xyz_d64 a, xyz_d64 b);
+s32 xyz_d64_cmp(xyz_d64 a, xyz_d64 b);
+double xyz_d64_to_double(xyz_d64 a);
+u32 xyz_d64_to_str(xyz_d64 a, c8 *buf, u32 dim);
+
+xyz_d128 xyz_d128_make(s64 coef, s32 exp);
+xyz_d128 xyz_d128_from_d64(xyz_d64 a);
+xyz_d128 xyz_d128_add(xyz_d128 a, xyz_d128 b);
+xyz_d128 xyz_d128_sub(xyz_d128 a, xyz_d128 b);
+xyz_d128 xyz_d128_mul(xyz_d128 a, xyz_d128 b);
+s32 xyz_d128_cmp(xyz_d128 a, xyz_d128 b);
+double xyz_d128_to_double(xyz_d128 a);
+u32 xyz_d128_to_str(xyz_d128 a, c8 *buf, u32 dim);
+
+
+
+// ==========================================================================
+//
+// UTF-8 validation and code point counting
+//
+// Validation follows the Unicode definition of well-formed UTF-8: no
+// overlong forms, no surrogates (U+D800..U+DFFF), nothing above U+10FFFF,
+// and no truncated sequences.  The code point count is the number of bytes
+// that are not continuation bytes.
+//
+// The kernel is chosen at run time from what the CPU supports, see
+// xyz_simd_level(), and xyz_simd_level_set() can hold it to a lower level:
+//
+//   AVX2    32 bytes at a time, validated with three nibble table lookups
+//           per byte (the lookup algorithm of Keiser and Lemire) and counted
+//           in the same pass.
+//   SSE2    16 bytes at a time, all-ASCII blocks are counted and skipped,
+//           blocks with multibyte characters are checked one character at
+//           a time.
+//   scalar  one character at a time.
+//
+// ==========================================================================
+
+
+#define XYZ_SIMD_SCALAR 0     ///< No usable SIMD.
+#define XYZ_SIMD_SSE2   1     ///< x86 SSE2, always present on x86-64.
+#define XYZ_SIMD_AVX2   2     ///< x86 AVX2, with OS support for the YMM state.
+
+
+u32 xyz_simd_level(void);
+u32 xyz_simd_level_set(u32 level);
+u32 xyz_utf8_valid(const void *str, u64 len);
+u64 xyz_utf8_count(const void *str, u64 len);
+s32 xyz_utf8_units(const void *str, u64 len, u64 *units);
+
+
+
+// ==========================================================================
+//
+// Integer formatting and parsing
+//
+// Decimal text for the digit-bounded integer classes of the meta types,
+// without going through printf.  Formatting writes two digits per table
+// lookup, right to left from a computed digit count.  Parsing converts
+// eight digits at a time when there are that many, and checks the value
+// against the class's digit limit rather than the width of the C type:
+//
+//   S4    -9999 .. 9999
+//   S9    -999999999 .. 999999999
+//   S19   -9223372036854775807 .. 9223372036854775807 (the s64 range,
+//         without INT64_MIN so the class is symmetric)
+//
+// Text for parsing is an optional sign and one or more digits, nothing
+// else, leading zeros do not count toward the digit limit.
+//
+// ==========================================================================
+
+
+#define XYZ_S4_MAX   9999                 ///< Largest XYZ_META_T_INTEGER_S4.
+#define XYZ_S9_MAX   999999999            ///< Largest XYZ_META_T_INTEGER_S9.
+#define XYZ_S19_MAX  INT64_MAX            ///< Largest XYZ_META_T_INTEGER_S19.
+
+/// Buffer size for any formatted integer, sign, digits, separators, and the
+/// terminator.
+#define XYZ_INT_STR_DIM 28
+
+
+u32 xyz_u64_to_str(u64 v, c8 *buf);
+u32 xyz_u64_to_str_sep(u64 v, c8 *buf, c8 sep);
+u32 xyz_s64_to_str(s64 v, c8 *buf);
+u32 xyz_s4_to_str(s32 v, c8 *buf);
+u32 xyz_s9_to_str(s32 v, c8 *buf);
+u32 xyz_s19_to_str(s64 v, c8 *buf);
+
+s32 xyz_str_to_s4(const c8 *str, u32 len, s32 *v);
+s32 xyz_str_to_s9(const c8 *str, u32 len, s32 *v);
+s32 xyz_str_to_s19(const c8 *str, u32 len, s64 *v);
+
+
+
+// ==========================================================================
+//
+// Metadata values (xyz_meta)
+//
+// A value with its type, storage format, and length, initialized with
+// xyz_meta_init() and released with xyz_meta_free().
+//
+// Numbers, including decimal64 and decimal128, are stored in the buf union.
+// Strings are stored in one of three ways, chosen by the allocation mode:
+//
+//   XYZ_META_P_STATIC   points at read-only data owned by the caller.
+//   XYZ_META_P_DYNAMIC  owned by the meta, kept inline in buf (no heap
+//                       allocation) when the dimension fits in
+//                       XYZ_META_INLINE bytes, otherwise from xyz_malloc().
+//   XYZ_META_P_FIXED    a writable fixed-size buffer owned by the caller.
+//
+// Strings are always terminated, the terminator counts in byte_dim but not
+// in byte_len.  Use xyz_meta_ptr() to get at the data in any format.
+//
+// xyz_meta_copy() makes an independent copy, except that a STATIC value is
+// shared (it is read-only), and copying into a FIXED destination stays in
+// the destination's buffer.  xyz_meta_move() transfers the storage and
+// leaves the source empty.
+//
+// ==========================================================================
+
+
+/// Bytes of inline storage in the buf union, the largest string (including
+/// the terminator) a DYNAMIC value keeps without a heap allocation.
+#define XYZ_META_INLINE 24
 
 /// Data-format of the buffer.
 enum XYZ_META_FORMAT
@@ -99,6 +785,8 @@ enum XYZ_META_FORMAT
    , XYZ_META_F_POINTER  = 1<<0  ///< Pointer to the data.
    , XYZ_META_F_SINT     = 1<<1  ///< Signed integer data.
    , XYZ_META_F_BINFP    = 1<<2  ///< Binary FP data.
+   , XYZ_META_F_INLINE   = 1<<3  ///< Data in the inline buffer.
+   , XYZ_META_F_DECFP    = 1<<4  ///< Decimal FP data, BID encoding.
 };
 
 
@@ -122,30 +810,34 @@ enum XYZ_META_TYPE
    , XYZ_META_T_INTEGER_S19   ///< Signed integer with 10..19 digits.
    , XYZ_META_T_DECIMAL       ///< Decimal FP, unlimited digits.
    , XYZ_META_T_DECIMAL_128   ///< Decimal FP, 34-digits.
-   , XYZ_META_T_DECIMAL_64    ///< Decimal FP, ??-digits.
-   , XYZ_META_T_DECIMAL_32    ///< Decimal FP, ??-digits.
+   , XYZ_META_T_DECIMAL_64    ///< Decimal FP, 16-digits.
+   , XYZ_META_T_DECIMAL_32    ///< Decimal FP, 7-digits.
    , XYZ_META_T_DECFP_QUAD    ///< Decimal FP, compact format, 34-digits.
-   , XYZ_META_T_DECFP_DBL     ///< Decimal FP, compact format, ??-digits.
-   , XYZ_META_T_DECFP_SNGL    ///< Decimal FP, compact format, ??-digits.
+   , XYZ_META_T_DECFP_DBL     ///< Decimal FP, compact format, 16-digits.
+   , XYZ_META_T_DECFP_SNGL    ///< Decimal FP, compact format, 7-digits.
    , XYZ_META_T_DECFP_BCD     ///< Decimal FP, BCD.
    , XYZ_META_T_DECFP_BCDP    ///< Decimal FP, Packed BCD.
    , XYZ_META_T_BINFP         ///< Binary FP, double, 16-digits.
 };
 
 
+/// Metadata value.
 typedef struct xyz_meta_unused_tag
 {
-   union {              ///< Local storage for types that fit in 64-bits.
+   union {              ///< Local storage for numbers and short strings.
    void    *vp;         ///< Pointer to the data.
    s64      si;         ///< Signed integer data.
    double   bfp;        ///< Binary floating point, 16-digits.
+   xyz_d64  d64;        ///< Decimal floating point, 16-digits.
+   xyz_d128 d128;       ///< Decimal floating point, 34-digits.
+   c8       inl[XYZ_META_INLINE];  ///< Inline data.
    }        buf;        ///< Data buffer.
    u16      format;     ///< Buffer format.
    u16      alloc;      ///< Buffer memory-allocation for the pointer-format.
    u16      type;       ///< Meta-data type.
    u16      reserved;   ///< Reserved for future use.
    u32      unit_dim;   ///< Dimension in units.
-   u32      unit_len;   ///< Length in units.
+   u32      unit_len;   ///< Length in units, digits for an integer.
    u32      byte_dim;   ///< Dimension in bytes.
    u32      byte_len;   ///< Length in bytes.
 } xyz_meta;
@@ -155,8 +847,18 @@ typedef struct xyz_meta_unused_tag
 const c8 * xyz_str_lastseg(const c8 *filepath, c8 sep);
 const c8 * xyz_path_lastpart(const c8 *filepath);
 
-/// TODO Implement.
-//s32 xyz_meta_init(xyz_meta *mt, u32 type, u32 alloc);
+s32 xyz_meta_init(xyz_meta *mt, u16 type, u16 alloc, u32 dim, const void *value);
+s32 xyz_meta_copy(xyz_meta *dst, const xyz_meta *src);
+void xyz_meta_move(xyz_meta *dst, xyz_meta *src);
+void xyz_meta_free(xyz_meta *mt);
+s32 xyz_meta_int_parse(xyz_meta *mt, u16 type, const c8 *str, u32 len);
+u32 xyz_meta_int_format(const xyz_meta *mt, c8 *buf);
+
+/// Pointer to the data of a meta value in any format, NULL if not valid.
+XYZ_INLINE void *xyz_meta_ptr(const xyz_meta *mt) {
+   return ( (mt->format & XYZ_META_F_INLINE) != 0 ? (void *)mt->buf.inl
+          : (mt->format & XYZ_META_F_POINTER) != 0 ? mt->buf.vp
+          : mt->format != XYZ_META_F_NOTVALID ? (void *)&(mt->buf) : NULL ); }
 
 
 
@@ -164,8 +866,13 @@ const c8 * xyz_path_lastpart(const c8 *filepath);
 //
 // Single reader-writer lock-free ring buffer access manager (RBAM)
 //
-// Note: The 'used' and 'free' fields are for informational status only and may
-// be inaccurate if the reader and writer use different threads.
+// The reader and writer may be on different threads.  The writer publishes
+// 'wr' with release ordering after the element is written, and the reader
+// publishes 'rd' with release ordering after the element has been used, so
+// neither side can see an index before the data it protects.
+//
+// Note: The 'used' and 'free' fields are for informational status only and are
+// a snapshot taken by whichever side updated them last.
 //
 // ==========================================================================
 
@@ -181,6 +888,21 @@ typedef struct unused_tag_xyz_rbam {
 } xyz_rbam;
 
 
+/// Up to two contiguous runs of buffer indexes, for batch access.  The
+/// second run is only used when the first one reaches the end of the buffer
+/// and wraps to index 0, otherwise len[1] is 0.
+typedef struct unused_tag_xyz_rbam_span {
+   u32   idx[2];  ///< Starting index of each run.
+   u32   len[2];  ///< Number of elements in each run.
+} xyz_rbam_span;
+
+
+/// Buffer index of the n'th element from the reader (0 is the oldest).
+/// Reader function, n must be less than the number of used elements.
+XYZ_INLINE u32 xyz_rbam_at(const xyz_rbam *rbam, u32 n) {
+   u32 idx = rbam->rd + n;
+   return (idx >= rbam->dim ? idx - rbam->dim : idx); }
+
 u32 xyz_rbam_init(xyz_rbam *rbam, u32 dim);
 u32 xyz_rbam_next(xyz_rbam *rbam, u32 index);
 u32 xyz_rbam_prev(xyz_rbam *rbam, u32 index);
@@ -189,6 +911,345 @@ u32 xyz_rbam_write(xyz_rbam *rbam);
 u32 xyz_rbam_is_empty(xyz_rbam *rbam);
 u32 xyz_rbam_read(xyz_rbam *rbam);
 u32 xyz_rbam_drain(xyz_rbam *rbam);
+u32 xyz_rbam_reserve(xyz_rbam *rbam, u32 n, xyz_rbam_span *span);
+u32 xyz_rbam_commit(xyz_rbam *rbam, u32 n);
+u32 xyz_rbam_peek(xyz_rbam *rbam, u32 n, xyz_rbam_span *span);
+u32 xyz_rbam_peek_at(xyz_rbam *rbam, u32 first, u32 n, xyz_rbam_span *span);
+u32 xyz_rbam_consume(xyz_rbam *rbam, u32 n);
+
+
+
+// ==========================================================================
+//
+// Power-of-two ring buffer access manager (RBAM-P2)
+//
+// Same single reader-writer rules as the RBAM, but the dimension must be a
+// power of two and rd/wr are free-running 64-bit counters.  The buffer index
+// is the counter masked with (dim - 1), so next/used/free are branch-free and
+// the buffer is full when (wr - rd) == dim, i.e. every element can be used.
+//
+// Use the RBAM-P2 in place of the RBAM when the buffer dimension can be a
+// power of two.  The counters never wrap in practice (2^64 operations).
+//
+// ==========================================================================
+
+
+/// Power-of-two Ring Buffer Access Manager (RBAM-P2) structure.
+typedef struct unused_tag_xyz_rbam_p2 {
+   u64   dim;     ///< Dimension (total number) of elements, a power of two.
+   u64   mask;    ///< Index mask, dim - 1.
+   u64   rd;      ///< Free-running read counter.
+   u64   wr;      ///< Free-running write counter.
+} xyz_rbam_p2;
+
+
+/// Buffer index for reading, only valid when the buffer is not empty.
+XYZ_INLINE u64 xyz_rbam_p2_rd_idx(const xyz_rbam_p2 *rb) { return rb->rd & rb->mask; }
+
+/// Buffer index for writing, only valid when the buffer is not full.
+XYZ_INLINE u64 xyz_rbam_p2_wr_idx(const xyz_rbam_p2 *rb) { return rb->wr & rb->mask; }
+
+u32 xyz_rbam_p2_init(xyz_rbam_p2 *rb, u64 dim);
+u64 xyz_rbam_p2_used(xyz_rbam_p2 *rb);
+u64 xyz_rbam_p2_free(xyz_rbam_p2 *rb);
+u32 xyz_rbam_p2_is_full(xyz_rbam_p2 *rb);
+u32 xyz_rbam_p2_write(xyz_rbam_p2 *rb);
+u32 xyz_rbam_p2_is_empty(xyz_rbam_p2 *rb);
+u32 xyz_rbam_p2_read(xyz_rbam_p2 *rb);
+u64 xyz_rbam_p2_drain(xyz_rbam_p2 *rb);
+
+
+
+// ==========================================================================
+//
+// Cache-line isolated ring buffer access manager (RBAM-CL)
+//
+// An RBAM-P2 for a reader and writer on different cores.  The writer's and
+// reader's counters are on separate cache lines so updating one does not
+// invalidate the other, and each side keeps a cached copy of the opposite
+// counter and only re-reads the real one when the buffer looks full (writer)
+// or empty (reader).  In steady state each operation touches only the cache
+// line owned by the calling side.
+//
+// The structure must be XYZ_CACHE_LINE aligned to get the benefit, so use a
+// static or cache-line aligned allocation.
+//
+// ==========================================================================
+
+
+/// Cache-line isolated Ring Buffer Access Manager (RBAM-CL) structure.
+typedef struct unused_tag_xyz_rbam_cl {
+   XYZ_ALIGN(XYZ_CACHE_LINE)
+   u64   dim;        ///< Dimension (total number) of elements, a power of two.
+   u64   mask;       ///< Index mask, dim - 1.
+
+   XYZ_ALIGN(XYZ_CACHE_LINE)
+   u64   wr;         ///< Writer: free-running write counter.
+   u64   rd_cache;   ///< Writer: last read counter seen.
+
+   XYZ_ALIGN(XYZ_CACHE_LINE)
+   u64   rd;         ///< Reader: free-running read counter.
+   u64   wr_cache;   ///< Reader: last write counter seen.
+} xyz_rbam_cl;
+
+
+/// Buffer index for reading, only valid when the buffer is not empty.
+XYZ_INLINE u64 xyz_rbam_cl_rd_idx(const xyz_rbam_cl *rb) { return rb->rd & rb->mask; }
+
+/// Buffer index for writing, only valid when the buffer is not full.
+XYZ_INLINE u64 xyz_rbam_cl_wr_idx(const xyz_rbam_cl *rb) { return rb->wr & rb->mask; }
+
+u32 xyz_rbam_cl_init(xyz_rbam_cl *rb, u64 dim);
+u64 xyz_rbam_cl_used(xyz_rbam_cl *rb);
+u32 xyz_rbam_cl_is_full(xyz_rbam_cl *rb);
+u32 xyz_rbam_cl_write(xyz_rbam_cl *rb);
+u32 xyz_rbam_cl_is_empty(xyz_rbam_cl *rb);
+u32 xyz_rbam_cl_read(xyz_rbam_cl *rb);
+u64 xyz_rbam_cl_drain(xyz_rbam_cl *rb);
+
+
+
+// ==========================================================================
+//
+// Multi-producer multi-consumer lock-free queue access manager (MPAM)
+//
+// Any number of threads can write, and any number of threads can read.  Like
+// the RBAM, the data buffer is owned by the caller, and so is an array of u32
+// sequence numbers with one entry per buffer element.  The sequence number of
+// an element tells whether it is free for the producer that claimed it or
+// ready for a consumer, so nobody waits on anybody else and no lock is needed.
+//
+// Producers get a ticket from xyz_mpam_reserve(), write the element at
+// xyz_mpam_idx(ticket), then call xyz_mpam_commit(ticket).
+//
+// A single consumer gets the oldest ready ticket from xyz_mpam_peek(), reads
+// the element, then calls xyz_mpam_consume(ticket).
+//
+// Multiple consumers get a ticket from xyz_mpam_claim(), read the element,
+// then call xyz_mpam_release(ticket).  Do not mix the single and multiple
+// consumer functions on the same queue.
+//
+// A thread that reserved or claimed a ticket must commit or release it, the
+// queue will not move past that element until it does.
+//
+// ==========================================================================
+
+
+/// Multi-producer Access Manager (MPAM) structure.
+typedef struct unused_tag_xyz_mpam {
+   u32   dim;     ///< Dimension (total number) of elements, a power of two.
+   u32   mask;    ///< Index mask, dim - 1.
+   u32  *seq;     ///< Caller-owned sequence numbers, one per element.
+   u8    pad_wr[XYZ_CACHE_LINE];    ///< Keeps wr off the read-only line.
+   u32   wr;      ///< Producers: next ticket to hand out.
+   u8    pad_rd[XYZ_CACHE_LINE];    ///< Keeps rd off the producers' line.
+   u32   rd;      ///< Consumers: next ticket to read.
+   u8    pad_end[XYZ_CACHE_LINE];   ///< Keeps rd off any following data.
+} xyz_mpam;
+
+
+/// Buffer index for a ticket.
+XYZ_INLINE u32 xyz_mpam_idx(const xyz_mpam *mp, u32 ticket) { return ticket & mp->mask; }
+
+u32 xyz_mpam_init(xyz_mpam *mp, u32 dim, u32 *seq);
+u32 xyz_mpam_used(xyz_mpam *mp);
+u32 xyz_mpam_reserve(xyz_mpam *mp, u32 *ticket);
+void xyz_mpam_commit(xyz_mpam *mp, u32 ticket);
+u32 xyz_mpam_peek(xyz_mpam *mp, u32 *ticket);
+void xyz_mpam_consume(xyz_mpam *mp, u32 ticket);
+u32 xyz_mpam_claim(xyz_mpam *mp, u32 *ticket);
+void xyz_mpam_release(xyz_mpam *mp, u32 ticket);
+
+
+
+// ==========================================================================
+//
+// Overwrite-oldest ring buffer access manager (RBOW)
+//
+// For high-rate telemetry (mouse samples, frame times, etc.) where the
+// writer must never block and the newest data matters most.  There is one
+// writer and any number of readers, and the writer always advances, writing
+// over the oldest element when the buffer is full.  Readers never slow the
+// writer down.
+//
+// Like the MPAM, the data buffer and an array of u64 sequence numbers (one
+// per element) are owned by the caller.  Each element is protected by a
+// sequence lock: the sequence is odd while the writer is storing the element,
+// and 2 * (pos + 1) once element pos is complete.  A reader copies the
+// element and then checks the sequence did not change, so it can tell when
+// the writer lapped it in the middle of the copy.
+//
+// The writer gets a position from xyz_rbow_reserve(), writes the element at
+// xyz_rbow_idx(pos), then calls xyz_rbow_commit(pos).
+//
+// Each reader has its own xyz_rbow_rd cursor.  xyz_rbow_peek() gives the
+// next position (skipping anything already overwritten), the reader copies
+// the element, then xyz_rbow_consume() says if the copy is good.  Always
+// copy the element out, do not use it in place.
+//
+// ==========================================================================
+
+
+/// Overwrite-oldest Ring Buffer (RBOW) structure.
+typedef struct unused_tag_xyz_rbow {
+   u64   dim;     ///< Dimension (total number) of elements, a power of two.
+   u64   mask;    ///< Index mask, dim - 1.
+   u64  *seq;     ///< Caller-owned sequence numbers, one per element.
+   u8    pad_wr[XYZ_CACHE_LINE];    ///< Keeps wr off the read-only line.
+   u64   wr;      ///< Writer: next position to write, free-running.
+   u8    pad_end[XYZ_CACHE_LINE];   ///< Keeps wr off any following data.
+} xyz_rbow;
+
+/// RBOW reader cursor, one per reader.
+typedef struct unused_tag_xyz_rbow_rd {
+   u64   pos;     ///< Next position to read.
+   u64   reads;   ///< Elements read successfully.
+   u64   lost;    ///< Elements overwritten before they were read.
+   u64   torn;    ///< Elements overwritten while they were being copied.
+} xyz_rbow_rd;
+
+
+/// Buffer index for a position.
+XYZ_INLINE u64 xyz_rbow_idx(const xyz_rbow *rb, u64 pos) { return pos & rb->mask; }
+
+u32 xyz_rbow_init(xyz_rbow *rb, u64 dim, u64 *seq);
+u64 xyz_rbow_reserve(xyz_rbow *rb);
+void xyz_rbow_commit(xyz_rbow *rb, u64 pos);
+void xyz_rbow_rd_init(xyz_rbow *rb, xyz_rbow_rd *rd, u64 back);
+u32 xyz_rbow_peek(xyz_rbow *rb, xyz_rbow_rd *rd, u64 *pos);
+u32 xyz_rbow_consume(xyz_rbow *rb, xyz_rbow_rd *rd, u64 pos);
+
+
+
+// ==========================================================================
+//
+// Variable-length record ring buffer access manager (RBVL)
+//
+// A single reader and single writer byte ring for records of any size, so
+// variable sized payloads (console lines, captured events, etc.) can be
+// streamed without a malloc per record.  The byte buffer is owned by the
+// caller, and the dimension must be a power of two.
+//
+// Each record is a header with the payload length followed by the payload,
+// rounded up to XYZ_RBVL_ALIGN bytes.  A record is always contiguous in the
+// buffer; when it does not fit in the space left before the end of the
+// buffer, the writer fills that space with a pad record and starts the
+// record at the beginning.  Readers skip pad records automatically.
+//
+// The writer gets a pointer to len contiguous bytes from xyz_rbvl_reserve(),
+// writes the payload, then calls xyz_rbvl_commit() with the actual length
+// (which may be less than reserved).
+//
+// The reader gets a pointer to the oldest payload from xyz_rbvl_peek(), and
+// frees it with xyz_rbvl_consume().
+//
+// When the reader and writer are the same thread, eviction is simply
+// calling xyz_rbvl_consume() until xyz_rbvl_reserve() succeeds.
+//
+// Payloads up to (dim / 2) - XYZ_RBVL_HDR bytes always fit in an empty
+// buffer, larger payloads may never fit.
+//
+// With a mirrored buffer from xyz_vmirror_alloc() and the XYZ_RBVL_F_MIRROR
+// flag, the buffer appears twice back-to-back in memory, so a record that
+// runs past the end of the buffer is still contiguous.  No pad records are
+// needed, no tail space is wasted, and any payload up to
+// dim - XYZ_RBVL_HDR bytes fits in an empty buffer.
+//
+// ==========================================================================
+
+
+/// Record header size, also the payload alignment.
+#define XYZ_RBVL_HDR 8
+
+/// Record alignment in the buffer.
+#define XYZ_RBVL_ALIGN 8
+
+/// Header length flag for a pad record.
+#define XYZ_RBVL_PAD 0x80000000
+
+/// Init flag, the buffer is mirrored (see xyz_vmirror_alloc()).
+#define XYZ_RBVL_F_MIRROR 0x01
+
+
+/// Variable-length Record Ring Buffer (RBVL) structure.
+typedef struct unused_tag_xyz_rbvl {
+   u64   dim;     ///< Dimension of the byte buffer, a power of two.
+   u64   mask;    ///< Index mask, dim - 1.
+   u8   *buf;     ///< Caller-owned byte buffer.
+   u64   rd;      ///< Free-running byte counter of the oldest record.
+   u64   wr;      ///< Free-running byte counter of the next record.
+   u64   rsv;     ///< Writer only: counter of the reserved record header.
+   u32   flags;   ///< XYZ_RBVL_F_* init flags.
+} xyz_rbvl;
+
+
+u8 *xyz_vmirror_alloc(u64 *dim);
+void xyz_vmirror_free(u8 *buf, u64 dim);
+u32 xyz_rbvl_init(xyz_rbvl *rb, u8 *buf, u64 dim, u32 flags);
+u64 xyz_rbvl_used(xyz_rbvl *rb);
+u64 xyz_rbvl_free(xyz_rbvl *rb);
+u8 *xyz_rbvl_reserve(xyz_rbvl *rb, u32 len);
+void xyz_rbvl_commit(xyz_rbvl *rb, u32 len);
+u8 *xyz_rbvl_peek(xyz_rbvl *rb, u32 *len);
+u32 xyz_rbvl_consume(xyz_rbvl *rb);
+
+
+
+// ==========================================================================
+//
+// Event count, blocking wait and notify (EVC)
+//
+// Lets a thread sleep until a ring buffer (or anything else) has something
+// for it, instead of polling with a delay.  A waiter first spins for a short
+// time checking its condition, which catches most hand-offs without a system
+// call, then parks in the OS (futex on Linux, WaitOnAddress on Windows, a
+// pthread condition variable elsewhere).  A notifier only makes the wake
+// system call when a waiter is actually parked or about to park.
+//
+// One EVC per direction is typical, i.e. the writer notifies a "readable"
+// EVC after xyz_rbam_write(), and the reader waits on it with
+// xyz_rbam_wait_readable().
+//
+// ==========================================================================
+
+
+/// Wait without a timeout.
+#define XYZ_WAIT_FOREVER 0xFFFFFFFF
+
+/// Default number of spins before a waiter parks.
+#define XYZ_EVC_SPIN 1000
+
+
+/// Event count structure.
+typedef struct unused_tag_xyz_evc {
+   u32   seq;              ///< Notification counter, the word parked on.
+   u32   waiters;          ///< Threads parked or about to park.
+   u32   spin;             ///< Spins before parking.
+   u32   reserved;         ///< Reserved for future use.
+   u64   wake_ns;          ///< Time stamp of the last wake call.
+
+   struct {
+   u64   waits;            ///< Waits that did not find the condition met.
+   u64   spin_hits;        ///< Waits satisfied while spinning, no system call.
+   u64   parks;            ///< Times a waiter parked in the OS.
+   u64   timeouts;         ///< Waits that timed out.
+   u64   wakes;            ///< Wake system calls made by notifiers.
+   u64   wakes_avoided;    ///< Notifies that skipped the system call.
+   u64   wake_ns_total;    ///< Total notify-to-running latency of parked waiters.
+   u64   wake_ns_max;      ///< Maximum notify-to-running latency.
+   } stats;                ///< Statistics, updated atomically.
+} xyz_evc;
+
+
+/// Condition callback for xyz_evc_await(), returns XYZ_TRUE when met.
+typedef u32 (xyz_ready_fn)(void *arg);
+
+u64 xyz_time_ns(void);
+void xyz_evc_init(xyz_evc *ev, u32 spin);
+void xyz_evc_notify(xyz_evc *ev);
+u32 xyz_evc_await(xyz_evc *ev, xyz_ready_fn *ready, void *arg, u32 timeout_ms);
+u32 xyz_rbam_wait_readable(xyz_rbam *rbam, xyz_evc *ev, u32 timeout_ms);
+u32 xyz_rbam_wait_writable(xyz_rbam *rbam, xyz_evc *ev, u32 timeout_ms);
 
 
 
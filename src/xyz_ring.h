@@ -0,0 +1,249 @@
+/**
+ * Typed ring buffer template for the C++ side.
+ *
+ * Header-only, C++11.  xyz::ring<T, N> is an RBAM-P2 with the element array
+ * built in and the capacity fixed at compile time, so the index mask is a
+ * constant the compiler folds into every access, and walking the used
+ * elements is a plain loop it can unroll or vectorize.
+ *
+ * Like the RBAM-P2 the read and write counters are free-running and only
+ * masked when indexing, so all N elements are usable.
+ *
+ * Elements are constructed in place by emplace() and destroyed by pop(), so
+ * T does not need a default constructor.
+ *
+ * The counters are published with the same ordering as the RBAM, so one
+ * writer thread and one reader thread can share a ring: the writer calls
+ * emplace() and back(), the reader calls pop(), front(), operator[] and
+ * iterates.  emplace() publishes the write counter with release after the
+ * element is constructed and pop() reads it with acquire, and pop()
+ * publishes the read counter with release after the element is destroyed
+ * and emplace() reads it with acquire.  clear() and the destructor are
+ * reader calls, and the destructor needs the writer to be done.
+ *
+ * Example:
+ *
+ *    xyz::ring<pos_s, 64> pts;
+ *    pts.emplace(x, y);
+ *    for ( pos_s &pt : pts ) { draw(pt); }
+ *    pts.pop();
+ *
+ * @file   xyz_ring.h
+ * @date   Oct 16, 2026
+ */
+
+#ifndef XYZ_RING_H_
+#define XYZ_RING_H_
+
+#include <new>          // placement new
+#include <utility>      // std::forward
+
+#include "xyz.h"
+
+
+namespace xyz {
+
+
+/**
+ * Fixed capacity ring buffer of T.
+ *
+ * @tparam T  element type.
+ * @tparam N  capacity, must be a power of two.
+ */
+template <typename T, u32 N>
+class ring
+{
+   static_assert(N >= 2 && (N & (N - 1)) == 0, "xyz::ring capacity must be a power of two");
+
+public:
+
+   static constexpr u32 dim = N;          ///< Capacity.
+   static constexpr u32 mask = N - 1;     ///< Index mask.
+
+
+   /// Forward iterator over the used elements, oldest to newest.
+   template <typename R, typename V>
+   class iter
+   {
+   public:
+      iter(R *rg, u32 pos) : rg_(rg), pos_(pos) {}
+      V &operator*() const { return rg_->slot(pos_); }
+      V *operator->() const { return &(rg_->slot(pos_)); }
+      iter &operator++() { pos_++; return *this; }
+      bool operator==(const iter &o) const { return pos_ == o.pos_; }
+      bool operator!=(const iter &o) const { return pos_ != o.pos_; }
+
+   private:
+      R  *rg_;
+      u32 pos_;
+   };
+
+   typedef iter<ring, T> iterator;
+   typedef iter<const ring, const T> const_iterator;
+
+
+   ring() : rd_(0), wr_(0) {}
+   ~ring() { clear(); }
+
+   ring(const ring &) = delete;
+   ring &operator=(const ring &) = delete;
+
+
+   /// @return The capacity.
+   static constexpr u32 capacity() { return N; }
+
+   /// @return The number of used elements.
+   u32 used() const { return wr_acq() - rd_acq(); }
+
+   /// @return The number of free elements.
+   u32 free() const { return N - used(); }
+
+   /// @return true if there are no elements (reader side).
+   bool is_empty() const { return wr_acq() == rd_; }
+
+   /// @return true if there is no room for another element (writer side).
+   bool is_full() const { return wr_ - rd_acq() == N; }
+
+
+   /**
+    * Construct an element in place at the write position.
+    *
+    * @param[in] args  constructor arguments for T.
+    *
+    * @return Pointer to the new element, or NULL if the ring is full.
+    */
+   template <typename... Args>
+   T *emplace(Args &&... args)
+   {
+      if ( is_full() ) { return NULL; }
+      T *p = new (&storage_[wr_ & mask]) T(std::forward<Args>(args)...);
+
+      // Publishing wr makes the element readable.
+      xyz_atomic_st_rel_u32(&wr_, wr_ + 1);
+      return p;
+   }
+   // emplace()
+
+
+   /**
+    * Destroy the oldest element.
+    *
+    * @return true if an element was removed, false if the ring was empty.
+    */
+   bool pop()
+   {
+      if ( is_empty() ) { return false; }
+      slot(rd_).~T();
+
+      // Publishing rd gives the element back to the writer.
+      xyz_atomic_st_rel_u32(&rd_, rd_ + 1);
+      return true;
+   }
+   // pop()
+
+
+   /**
+    * Destroy up to n of the oldest elements.
+    *
+    * @param[in] n  number of elements to remove.
+    *
+    * @return The number of elements removed.
+    */
+   u32 pop(u32 n)
+   {
+      u32 avail = wr_acq() - rd_;
+      if ( n > avail ) { n = avail; }
+      for ( u32 i = 0 ; i < n ; i++ ) { slot(rd_ + i).~T(); }
+      xyz_atomic_st_rel_u32(&rd_, rd_ + n);
+      return n;
+   }
+   // pop()
+
+
+   /// Destroy all elements.
+   void clear() { pop(N); }
+
+
+   /// @return The oldest element, the ring must not be empty.
+   T &front() { return slot(rd_); }
+   const T &front() const { return slot(rd_); }
+
+   /// @return The newest element, the ring must not be empty.
+   T &back() { return slot(wr_ - 1); }
+   const T &back() const { return slot(wr_ - 1); }
+
+   /// @return The i'th element from the oldest, i must be less than used().
+   T &operator[](u32 i) { return slot(rd_ + i); }
+   const T &operator[](u32 i) const { return slot(rd_ + i); }
+
+
+   iterator begin() { return iterator(this, rd_); }
+   iterator end() { return iterator(this, wr_acq()); }
+   const_iterator begin() const { return const_iterator(this, rd_); }
+   const_iterator end() const { return const_iterator(this, wr_acq()); }
+
+
+private:
+
+   template <typename R, typename V> friend class iter;
+
+   /// Raw storage for one element, constructed on demand.
+   struct alignas(T) cell { u8 b[sizeof(T)]; };
+
+   T &slot(u32 pos) { return *reinterpret_cast<T *>(&storage_[pos & mask]); }
+   const T &slot(u32 pos) const { return *reinterpret_cast<const T *>(&storage_[pos & mask]); }
+
+   /// The other thread's counter, with the ordering the RBAM uses.
+   u32 wr_acq() const { return xyz_atomic_ld_acq_u32(&wr_); }
+   u32 rd_acq() const { return xyz_atomic_ld_acq_u32(&rd_); }
+
+   u32  rd_;            ///< Free-running read counter.
+   u32  wr_;            ///< Free-running write counter.
+   cell storage_[N];    ///< Element storage.
+};
+
+
+} // namespace xyz
+
+#endif /* XYZ_RING_H_ */
+/*
+------------------------------------------------------------------------------
+This software is available under 2 licenses -- choose whichever you prefer.
+------------------------------------------------------------------------------
+ALTERNATIVE A - MIT License
+Copyright (c) 2020 Matthew Hagerty
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+------------------------------------------------------------------------------
+ALTERNATIVE B - Public Domain (www.unlicense.org)
+This is free and unencumbered software released into the public domain.
+Anyone is free to copy, modify, publish, use, compile, sell, or distribute this
+software, either in source code form or as a compiled binary, for any purpose,
+commercial or non-commercial, and by any means.
+In jurisdictions that recognize copyright laws, the author or authors of this
+software dedicate any and all copyright interest in the software to the public
+domain. We make this dedication for the benefit of the public at large and to
+the detriment of our heirs and successors. We intend this dedication to be an
+overt act of relinquishment in perpetuity of all present and future rights to
+this software under copyright law.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+------------------------------------------------------------------------------
+*/